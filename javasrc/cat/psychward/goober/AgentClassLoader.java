@@ -0,0 +1,78 @@
+package cat.psychward.goober;
+
+import java.io.Closeable;
+import java.io.File;
+import java.io.IOException;
+import java.net.MalformedURLException;
+import java.net.URL;
+import java.net.URLClassLoader;
+import java.util.Enumeration;
+
+/**
+ * Loader of one agent jar. The native side reads the jar itself and defines
+ * every class in it before the agent starts, resources are the only thing
+ * that still goes through a {@link URLClassLoader}, created the first time
+ * the agent asks for one.
+ */
+final class AgentClassLoader extends ClassLoader implements Closeable {
+
+    static {
+        registerAsParallelCapable();
+    }
+
+    private final String path;
+
+    // native jar, only set while the classes are being defined
+    private long jar;
+
+    private URLClassLoader resources;
+
+    AgentClassLoader(ClassLoader parent, String path) {
+        super(parent);
+        this.path = path;
+    }
+
+    @Override
+    protected Class<?> findClass(String name) throws ClassNotFoundException {
+        final long jar = this.jar;
+        final Class<?> clazz = jar != 0 ? defineJarClass(jar, name) : null;
+        if (clazz == null) throw new ClassNotFoundException(name);
+
+        return clazz;
+    }
+
+    @Override
+    protected URL findResource(String name) {
+        return resources().findResource(name);
+    }
+
+    @Override
+    protected Enumeration<URL> findResources(String name) throws IOException {
+        return resources().findResources(name);
+    }
+
+    @Override
+    public synchronized void close() throws IOException {
+        if (resources != null) resources.close();
+    }
+
+    private synchronized URLClassLoader resources() {
+        if (resources == null) {
+            try {
+                // no parent, this one already delegates before getting here
+                resources = new URLClassLoader(new URL[] { new File(path).toURI().toURL() }, null);
+            } catch (MalformedURLException e) {
+                throw new IllegalStateException(e);
+            }
+        }
+
+        return resources;
+    }
+
+    /**
+     * Defines the class of that name from the jar in this loader, or returns
+     * null if the jar has no such class.
+     */
+    private native Class<?> defineJarClass(long jar, String name);
+
+}
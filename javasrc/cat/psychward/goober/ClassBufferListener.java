@@ -0,0 +1,16 @@
+package cat.psychward.goober;
+
+import java.nio.ByteBuffer;
+
+@FunctionalInterface
+public interface ClassBufferListener {
+
+    /**
+     * {@code bytes} is a read-only view of the JVM's own class data and is only
+     * valid for the duration of the call. Return null to leave the class alone,
+     * or a buffer from {@link Utility#allocateClassBuffer(int)} holding the new
+     * class file up to its limit, which is handed to the JVM without copying.
+     */
+    public ByteBuffer onLoad(String name, ByteBuffer bytes);
+
+}
@@ -0,0 +1,32 @@
+package cat.psychward.goober;
+
+/**
+ * Loader of the embedded classes. Nothing is defined up front, the class file
+ * stays in the native library until the JVM first asks this loader for it.
+ * Everything else goes to the system class loader as usual.
+ */
+final class EmbeddedClassLoader extends ClassLoader {
+
+    static {
+        registerAsParallelCapable();
+    }
+
+    EmbeddedClassLoader(ClassLoader parent) {
+        super(parent);
+    }
+
+    @Override
+    protected Class<?> findClass(String name) throws ClassNotFoundException {
+        final Class<?> clazz = defineEmbedded(name);
+        if (clazz == null) throw new ClassNotFoundException(name);
+
+        return clazz;
+    }
+
+    /**
+     * Defines the embedded class of that name in this loader, or returns null
+     * if there is none.
+     */
+    private native Class<?> defineEmbedded(String name);
+
+}
@@ -0,0 +1,18 @@
+package cat.psychward.goober;
+
+/**
+ * Call target for the timing probes injected by the native side. Defined in
+ * the bootstrap loader so instrumented classes can see it no matter which
+ * loader they come from.
+ */
+public final class Probes {
+
+    private Probes() {}
+
+    /**
+     * Adds one call taking {@code nanos} to the probe's counters for the
+     * current thread.
+     */
+    public static native void record(int id, long nanos);
+
+}
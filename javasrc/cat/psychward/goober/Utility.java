@@ -1,5 +1,6 @@
 package cat.psychward.goober;
 
+import java.io.Closeable;
 import java.io.File;
 import java.io.FileNotFoundException;
 import java.io.IOException;
@@ -7,16 +8,15 @@ import java.lang.reflect.Constructor;
 import java.lang.reflect.Method;
 import java.net.URL;
 import java.net.URLClassLoader;
-import java.util.List;
-import java.util.concurrent.CopyOnWriteArrayList;
+import java.nio.ByteBuffer;
+import java.util.concurrent.CompletableFuture;
 
+import cat.psychward.goober.ClassBufferListener;
 import cat.psychward.goober.ClassLoadListener;
 
 public final class Utility {
 
-    private static final List<ClassLoadListener> loadListeners = new CopyOnWriteArrayList<>();
-
-    private static void loadAgent(String path, String agentClass)
+    private static Object loadAgent(String path, String agentClass)
         throws IOException, ReflectiveOperationException {
         final File file = new File(path);
 
@@ -24,20 +24,57 @@ public final class Utility {
             "Path " + path + " does not exist!"
         );
 
-        try (
-            final URLClassLoader classLoader = new URLClassLoader(
-                new URL[] { file.toURI().toURL() }
-            )
-        ) {
-            final Class<?> agentClazz = classLoader.loadClass(agentClass);
-            final Method onAgentLoad = agentClazz.getDeclaredMethod(
-                "onAgentLoad"
-            );
-            final Constructor<?> constructor =
-                agentClazz.getDeclaredConstructor();
-            constructor.setAccessible(true);
+        // agents link against this class, which only the embedded loader knows
+        // about. kept open for classes the agent loads later, stopAgent closes it
+        final URLClassLoader classLoader = new URLClassLoader(
+            new URL[] { file.toURI().toURL() },
+            Utility.class.getClassLoader()
+        );
+
+        try {
+            return startAgent(classLoader, agentClass);
+        } catch (Throwable t) {
+            classLoader.close();
+            throw t;
+        }
+    }
+
+    private static Object startAgent(ClassLoader classLoader, String agentClass)
+        throws ReflectiveOperationException {
+        final Class<?> agentClazz = classLoader.loadClass(agentClass);
+        final Method onAgentLoad = agentClazz.getDeclaredMethod(
+            "onAgentLoad"
+        );
+        final Constructor<?> constructor =
+            agentClazz.getDeclaredConstructor();
+        constructor.setAccessible(true);
+
+        final Object agent = constructor.newInstance();
+        onAgentLoad.invoke(agent);
 
-            onAgentLoad.invoke(constructor.newInstance());
+        return agent;
+    }
+
+    /**
+     * Calls the agent's {@code onAgentUnload}, if it has one, and closes its
+     * loader. Its listeners are already gone by then, so this is the place to
+     * retransform whatever it changed back to the original.
+     */
+    private static void stopAgent(Object agent)
+        throws IOException, ReflectiveOperationException {
+        final ClassLoader classLoader = agent.getClass().getClassLoader();
+
+        try {
+            final Method onAgentUnload = agent.getClass().getDeclaredMethod(
+                "onAgentUnload"
+            );
+            onAgentUnload.invoke(agent);
+        } catch (NoSuchMethodException ignored) {
+            // optional, most agents have nothing to clean up
+        } finally {
+            if (classLoader instanceof Closeable) {
+                ((Closeable) classLoader).close();
+            }
         }
     }
 
@@ -49,7 +86,92 @@ public final class Utility {
 
     public static native int retransformClass(Class<?> clazz);
 
+    /**
+     * Redefines all classes in a single JVMTI call, so the whole batch costs
+     * one safepoint. {@code data[i]} is the new class file for
+     * {@code classes[i]}; nothing is redefined if any of them is rejected.
+     */
+    public static native int redefineClasses(Class<?>[] classes, byte[][] data);
+
+    /**
+     * Retransforms all classes in a single JVMTI call.
+     */
+    public static native int retransformClasses(Class<?>... classes);
+
+    /**
+     * Queues a retransform instead of running it right away. Requests arriving
+     * within a short window are deduplicated and submitted together, and the
+     * future completes with the JVMTI error code for this class (0 on
+     * success).
+     */
+    public static CompletableFuture<Integer> retransformClassAsync(Class<?> clazz) {
+        final CompletableFuture<Integer> future = new CompletableFuture<>();
+        queueRetransform(clazz, future);
+        return future;
+    }
+
+    private static native void queueRetransform(Class<?> clazz, CompletableFuture<Integer> future);
+
+    /**
+     * Finds loaded classes by name. A pattern without wildcards is a prefix
+     * ("com.acme."), otherwise {@code *} matches within a package segment,
+     * {@code **} across segments and {@code ?} a single character.
+     */
+    public static native Class<?>[] findClasses(String pattern);
+
+    private static native void addLoadListener(ClassLoadListener listener, int priority, String cacheKey, String[] patterns);
+
+    private static native void addBufferListener(ClassBufferListener listener, int priority, String cacheKey, String[] patterns);
+
+    /**
+     * Allocates an output buffer for a {@link ClassBufferListener}. Only valid
+     * while a listener is running, anything not returned is freed afterwards.
+     */
+    public static native ByteBuffer allocateClassBuffer(int size);
+
     public static void onClassLoad(ClassLoadListener listener) {
-        loadListeners.add(listener);
+        addLoadListener(listener, 0, null, new String[0]);
+    }
+
+    /**
+     * Only calls the listener for classes matching one of the patterns (see
+     * {@link #findClasses(String)}). Filtering happens natively, so classes no
+     * listener is interested in never get copied into the heap.
+     */
+    public static void onClassLoad(ClassLoadListener listener, String... patterns) {
+        addLoadListener(listener, 0, null, patterns);
+    }
+
+    /**
+     * Listeners form a chain in ascending priority order (registration order
+     * among equals), each one getting the previous listener's output. Returning
+     * null or the input unchanged passes the class on as-is.
+     */
+    public static void onClassLoad(ClassLoadListener listener, int priority, String... patterns) {
+        addLoadListener(listener, priority, null, patterns);
+    }
+
+    // separate name so implicitly typed lambdas don't become ambiguous
+    public static void onClassLoadBuffer(ClassBufferListener listener, String... patterns) {
+        addBufferListener(listener, 0, null, patterns);
+    }
+
+    public static void onClassLoadBuffer(ClassBufferListener listener, int priority, String... patterns) {
+        addBufferListener(listener, priority, null, patterns);
+    }
+
+    /**
+     * Results are kept in the persistent transform cache, if one is open,
+     * keyed by {@code cacheKey} and a hash of the input bytes, and replayed on
+     * later runs without calling the listener at all. The key has to change
+     * whenever the listener would transform a class differently, e.g.
+     * "my-agent/1.4".
+     */
+    public static void onClassLoadCached(String cacheKey, ClassLoadListener listener, int priority, String... patterns) {
+        addLoadListener(listener, priority, cacheKey, patterns);
+    }
+
+    public static void onClassLoadBufferCached(String cacheKey, ClassBufferListener listener, int priority, String... patterns) {
+        addBufferListener(listener, priority, cacheKey, patterns);
     }
 }
@@ -0,0 +1,492 @@
+#include "classfile.hpp"
+#include "code.hpp"
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace classfile {
+
+reader::reader(std::span<const uint8_t> data) : data(data), pos(0), failed(false) {}
+
+uint8_t reader::u1() {
+    if (pos + 1 > data.size()) {
+        failed = true;
+        return 0;
+    }
+
+    return data[pos++];
+}
+
+uint16_t reader::u2() {
+    if (pos + 2 > data.size()) {
+        failed = true;
+        return 0;
+    }
+
+    uint16_t value = (data[pos] << 8) | data[pos + 1];
+    pos += 2;
+    return value;
+}
+
+uint32_t reader::u4() {
+    if (pos + 4 > data.size()) {
+        failed = true;
+        return 0;
+    }
+
+    uint32_t value = (uint32_t(data[pos]) << 24) | (uint32_t(data[pos + 1]) << 16) | (uint32_t(data[pos + 2]) << 8) | data[pos + 3];
+    pos += 4;
+    return value;
+}
+
+std::span<const uint8_t> reader::bytes(size_t count) {
+    if (count > data.size() - pos) {
+        failed = true;
+        return {};
+    }
+
+    auto value = data.subspan(pos, count);
+    pos += count;
+    return value;
+}
+
+size_t reader::offset() const {
+    return pos;
+}
+
+bool reader::ok() const {
+    return !failed;
+}
+
+writer::writer(std::vector<uint8_t>& out) : out(out) {}
+
+void writer::u1(uint8_t value) {
+    out.push_back(value);
+}
+
+void writer::u2(uint16_t value) {
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+void writer::u4(uint32_t value) {
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+void writer::bytes(std::span<const uint8_t> data) {
+    out.insert(out.end(), data.begin(), data.end());
+}
+
+size_t writer::offset() const {
+    return out.size();
+}
+
+void writer::patch_u2(size_t at, uint16_t value) {
+    out[at] = value >> 8;
+    out[at + 1] = value;
+}
+
+void writer::patch_u4(size_t at, uint32_t value) {
+    out[at] = value >> 24;
+    out[at + 1] = value >> 16;
+    out[at + 2] = value >> 8;
+    out[at + 3] = value;
+}
+
+// payload size after the tag, for everything but utf8
+static std::optional<size_t> payload_size(constant_tag tag) {
+    switch (tag) {
+        case constant_tag::CLASS:
+        case constant_tag::STRING:
+        case constant_tag::METHOD_TYPE:
+        case constant_tag::MODULE:
+        case constant_tag::PACKAGE:
+            return 2;
+        case constant_tag::METHOD_HANDLE:
+            return 3;
+        case constant_tag::INTEGER:
+        case constant_tag::FLOAT:
+        case constant_tag::FIELDREF:
+        case constant_tag::METHODREF:
+        case constant_tag::INTERFACE_METHODREF:
+        case constant_tag::NAME_AND_TYPE:
+        case constant_tag::DYNAMIC:
+        case constant_tag::INVOKE_DYNAMIC:
+            return 4;
+        case constant_tag::LONG:
+        case constant_tag::DOUBLE:
+            return 8;
+        default:
+            return std::nullopt;
+    }
+}
+
+static std::string lookup_key(constant_tag tag, std::span<const uint8_t> payload) {
+    std::string key(1, static_cast<char>(tag));
+    key.append(reinterpret_cast<const char*>(payload.data()), payload.size());
+    return key;
+}
+
+bool constant_pool::parse(reader& in) {
+    auto count = in.u2();
+
+    entries.clear();
+    entries.reserve(count);
+    entries.emplace_back();
+
+    while (entries.size() < count && in.ok()) {
+        auto tag = static_cast<constant_tag>(in.u1());
+
+        // utf8 payloads are stored without their length prefix
+        if (tag == constant_tag::UTF8) {
+            auto length = in.u2();
+            entries.push_back(constant { .tag = tag, .data = in.bytes(length) });
+            continue;
+        }
+
+        auto size = payload_size(tag);
+        if (!size.has_value()) {
+            std::cerr << "Unknown constant pool tag " << static_cast<int>(tag) << std::endl;
+            return false;
+        }
+
+        entries.push_back(constant { .tag = tag, .data = in.bytes(*size) });
+
+        if (tag == constant_tag::LONG || tag == constant_tag::DOUBLE)
+            entries.emplace_back();
+    }
+
+    return in.ok();
+}
+
+void constant_pool::write(writer& out) const {
+    out.u2(count());
+
+    for (auto& entry : entries) {
+        if (!entry.has_value())
+            continue;
+
+        out.u1(static_cast<uint8_t>(entry->tag));
+        if (entry->tag == constant_tag::UTF8)
+            out.u2(entry->data.size());
+
+        out.bytes(entry->data);
+    }
+}
+
+uint16_t constant_pool::count() const {
+    return entries.size();
+}
+
+const constant* constant_pool::at(uint16_t index) const {
+    if (index >= entries.size() || !entries[index].has_value())
+        return nullptr;
+
+    return &*entries[index];
+}
+
+uint16_t constant_pool::u2(uint16_t index, size_t offset) const {
+    auto entry = at(index);
+    if (entry == nullptr || offset + 2 > entry->data.size())
+        return 0;
+
+    return (entry->data[offset] << 8) | entry->data[offset + 1];
+}
+
+uint32_t constant_pool::u4(uint16_t index, size_t offset) const {
+    return (uint32_t(u2(index, offset)) << 16) | u2(index, offset + 2);
+}
+
+std::string_view constant_pool::utf8(uint16_t index) const {
+    auto entry = at(index);
+    if (entry == nullptr || entry->tag != constant_tag::UTF8)
+        return {};
+
+    return std::string_view(reinterpret_cast<const char*>(entry->data.data()), entry->data.size());
+}
+
+std::string_view constant_pool::class_name(uint16_t index) const {
+    auto entry = at(index);
+    if (entry == nullptr || entry->tag != constant_tag::CLASS)
+        return {};
+
+    return utf8(u2(index, 0));
+}
+
+std::pair<std::string_view, std::string_view> constant_pool::name_and_type(uint16_t index) const {
+    return { utf8(u2(index, 0)), utf8(u2(index, 2)) };
+}
+
+member_ref constant_pool::member(uint16_t index) const {
+    auto entry = at(index);
+    if (entry == nullptr)
+        return {};
+
+    // invokedynamic and dynamic constants have a bootstrap index instead of an owner
+    std::string_view owner;
+    if (entry->tag == constant_tag::FIELDREF || entry->tag == constant_tag::METHODREF || entry->tag == constant_tag::INTERFACE_METHODREF)
+        owner = class_name(u2(index, 0));
+
+    auto [name, descriptor] = name_and_type(u2(index, 2));
+    return member_ref { .owner = owner, .name = name, .descriptor = descriptor };
+}
+
+uint16_t constant_pool::add(constant_tag tag, std::vector<uint8_t> payload) {
+    if (lookup.empty()) {
+        for (size_t i = 1; i < entries.size(); i++) {
+            if (entries[i].has_value())
+                lookup.emplace(lookup_key(entries[i]->tag, entries[i]->data), i);
+        }
+    }
+
+    auto key = lookup_key(tag, payload);
+    auto pos = lookup.find(key);
+    if (pos != lookup.end())
+        return pos->second;
+
+    bool wide = tag == constant_tag::LONG || tag == constant_tag::DOUBLE;
+    if (entries.size() + (wide ? 2 : 1) > 0xffff) {
+        std::cerr << "Constant pool is full." << std::endl;
+        return 0;
+    }
+
+    owned.push_back(std::make_unique<std::vector<uint8_t>>(std::move(payload)));
+
+    uint16_t index = entries.size();
+    entries.push_back(constant { .tag = tag, .data = *owned.back() });
+    if (wide)
+        entries.emplace_back();
+
+    lookup.emplace(std::move(key), index);
+    return index;
+}
+
+static std::vector<uint8_t> u2_payload(std::initializer_list<uint16_t> values) {
+    std::vector<uint8_t> payload;
+    writer out(payload);
+    for (auto value : values)
+        out.u2(value);
+
+    return payload;
+}
+
+uint16_t constant_pool::add_utf8(std::string_view value) {
+    return add(constant_tag::UTF8, std::vector<uint8_t>(value.begin(), value.end()));
+}
+
+uint16_t constant_pool::add_class(std::string_view name) {
+    return add(constant_tag::CLASS, u2_payload({ add_utf8(name) }));
+}
+
+uint16_t constant_pool::add_string(std::string_view value) {
+    return add(constant_tag::STRING, u2_payload({ add_utf8(value) }));
+}
+
+uint16_t constant_pool::add_integer(int32_t value) {
+    std::vector<uint8_t> payload;
+    writer(payload).u4(value);
+    return add(constant_tag::INTEGER, std::move(payload));
+}
+
+uint16_t constant_pool::add_long(int64_t value) {
+    std::vector<uint8_t> payload;
+    writer out(payload);
+    out.u4(static_cast<uint64_t>(value) >> 32);
+    out.u4(value);
+    return add(constant_tag::LONG, std::move(payload));
+}
+
+uint16_t constant_pool::add_name_and_type(std::string_view name, std::string_view descriptor) {
+    return add(constant_tag::NAME_AND_TYPE, u2_payload({ add_utf8(name), add_utf8(descriptor) }));
+}
+
+uint16_t constant_pool::add_fieldref(std::string_view owner, std::string_view name, std::string_view descriptor) {
+    return add(constant_tag::FIELDREF, u2_payload({ add_class(owner), add_name_and_type(name, descriptor) }));
+}
+
+uint16_t constant_pool::add_methodref(std::string_view owner, std::string_view name, std::string_view descriptor, bool interface) {
+    auto tag = interface ? constant_tag::INTERFACE_METHODREF : constant_tag::METHODREF;
+    return add(tag, u2_payload({ add_class(owner), add_name_and_type(name, descriptor) }));
+}
+
+std::span<const uint8_t> attribute::bytes() const {
+    if (replaced.has_value())
+        return *replaced;
+
+    return data;
+}
+
+static bool parse_attributes(reader& in, std::vector<attribute>& attributes) {
+    auto count = in.u2();
+    attributes.reserve(count);
+
+    for (uint16_t i = 0; i < count && in.ok(); i++) {
+        auto name_index = in.u2();
+        auto length = in.u4();
+        attributes.push_back(attribute { .name_index = name_index, .data = in.bytes(length), .replaced = std::nullopt });
+    }
+
+    return in.ok();
+}
+
+static void write_attributes(writer& out, const std::vector<attribute>& attributes) {
+    out.u2(attributes.size());
+
+    for (auto& attribute : attributes) {
+        auto bytes = attribute.bytes();
+        out.u2(attribute.name_index);
+        out.u4(bytes.size());
+        out.bytes(bytes);
+    }
+}
+
+static bool parse_members(reader& in, std::vector<member>& members) {
+    auto count = in.u2();
+    members.reserve(count);
+
+    for (uint16_t i = 0; i < count && in.ok(); i++) {
+        auto& entry = members.emplace_back();
+        entry.access = in.u2();
+        entry.name_index = in.u2();
+        entry.descriptor_index = in.u2();
+
+        if (!parse_attributes(in, entry.attributes))
+            return false;
+    }
+
+    return in.ok();
+}
+
+static void write_members(writer& out, const std::vector<member>& members) {
+    out.u2(members.size());
+
+    for (auto& entry : members) {
+        out.u2(entry.access);
+        out.u2(entry.name_index);
+        out.u2(entry.descriptor_index);
+        write_attributes(out, entry.attributes);
+    }
+}
+
+const attribute* find_attribute(const constant_pool& pool, const std::vector<attribute>& attributes, std::string_view name) {
+    for (auto& attribute : attributes) {
+        if (pool.utf8(attribute.name_index) == name)
+            return &attribute;
+    }
+
+    return nullptr;
+}
+
+std::optional<class_file> class_file::parse(std::span<const uint8_t> bytes) {
+    reader in(bytes);
+
+    if (in.u4() != 0xCAFEBABE)
+        return std::nullopt;
+
+    class_file clazz;
+    clazz.source = bytes;
+    clazz.minor_version = in.u2();
+    clazz.major_version = in.u2();
+
+    if (!clazz.pool.parse(in))
+        return std::nullopt;
+
+    clazz.access = in.u2();
+    clazz.this_class = in.u2();
+    clazz.super_class = in.u2();
+
+    auto interface_count = in.u2();
+    for (uint16_t i = 0; i < interface_count && in.ok(); i++)
+        clazz.interfaces.push_back(in.u2());
+
+    if (!parse_members(in, clazz.fields) || !parse_members(in, clazz.methods) || !parse_attributes(in, clazz.attributes))
+        return std::nullopt;
+
+    return clazz;
+}
+
+std::string_view class_file::name() const {
+    return pool.class_name(this_class);
+}
+
+std::string_view class_file::super_name() const {
+    return super_class != 0 ? pool.class_name(super_class) : std::string_view();
+}
+
+member* class_file::find_method(std::string_view name, std::string_view descriptor) {
+    for (auto& method : methods) {
+        if (pool.utf8(method.name_index) == name && pool.utf8(method.descriptor_index) == descriptor)
+            return &method;
+    }
+
+    return nullptr;
+}
+
+code* class_file::body(member& method) {
+    if (method.body != nullptr)
+        return method.body.get();
+
+    auto attribute = find_attribute(pool, method.attributes, "Code");
+    if (attribute == nullptr)
+        return nullptr;
+
+    auto decoded = code::decode(*this, method, attribute->bytes());
+    if (!decoded.has_value())
+        return nullptr;
+
+    method.body = std::make_unique<code>(std::move(*decoded));
+    return method.body.get();
+}
+
+std::optional<std::vector<uint8_t>> class_file::write(const super_resolver& resolver) {
+    // bodies first, encoding them can still add constants
+    for (auto& method : methods) {
+        if (method.body == nullptr)
+            continue;
+
+        auto encoded = method.body->encode(*this, method, resolver);
+        if (!encoded.has_value()) {
+            std::cerr << "Failed to encode " << name() << "." << pool.utf8(method.name_index) << pool.utf8(method.descriptor_index) << std::endl;
+            return std::nullopt;
+        }
+
+        for (auto& attribute : method.attributes) {
+            if (pool.utf8(attribute.name_index) == "Code")
+                attribute.replaced = std::move(*encoded);
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+    bytes.reserve(source.size() + 1024);
+
+    writer out(bytes);
+    out.u4(0xCAFEBABE);
+    out.u2(minor_version);
+    out.u2(major_version);
+
+    pool.write(out);
+
+    out.u2(access);
+    out.u2(this_class);
+    out.u2(super_class);
+
+    out.u2(interfaces.size());
+    for (auto index : interfaces)
+        out.u2(index);
+
+    write_members(out, fields);
+    write_members(out, methods);
+    write_attributes(out, attributes);
+
+    return bytes;
+}
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// In-process class file model. Parsing only records where things are in the
+// original bytes; constants, attributes and members stay spans into them until
+// something is edited, and method bodies are only decoded when asked for.
+namespace classfile {
+
+enum class constant_tag : uint8_t {
+    UTF8 = 1,
+    INTEGER = 3,
+    FLOAT = 4,
+    LONG = 5,
+    DOUBLE = 6,
+    CLASS = 7,
+    STRING = 8,
+    FIELDREF = 9,
+    METHODREF = 10,
+    INTERFACE_METHODREF = 11,
+    NAME_AND_TYPE = 12,
+    METHOD_HANDLE = 15,
+    METHOD_TYPE = 16,
+    DYNAMIC = 17,
+    INVOKE_DYNAMIC = 18,
+    MODULE = 19,
+    PACKAGE = 20
+};
+
+namespace access {
+    constexpr uint16_t PUBLIC = 0x0001;
+    constexpr uint16_t PRIVATE = 0x0002;
+    constexpr uint16_t PROTECTED = 0x0004;
+    constexpr uint16_t STATIC = 0x0008;
+    constexpr uint16_t FINAL = 0x0010;
+    constexpr uint16_t SYNCHRONIZED = 0x0020;
+    constexpr uint16_t BRIDGE = 0x0040;
+    constexpr uint16_t VARARGS = 0x0080;
+    constexpr uint16_t NATIVE = 0x0100;
+    constexpr uint16_t INTERFACE = 0x0200;
+    constexpr uint16_t ABSTRACT = 0x0400;
+    constexpr uint16_t SYNTHETIC = 0x1000;
+}
+
+// big-endian cursor, reads past the end just fail instead of throwing
+class reader {
+    std::span<const uint8_t> data;
+    size_t pos;
+    bool failed;
+
+public:
+    reader(std::span<const uint8_t> data);
+
+    uint8_t u1();
+    uint16_t u2();
+    uint32_t u4();
+    std::span<const uint8_t> bytes(size_t count);
+
+    size_t offset() const;
+    bool ok() const;
+};
+
+class writer {
+    std::vector<uint8_t>& out;
+
+public:
+    writer(std::vector<uint8_t>& out);
+
+    void u1(uint8_t value);
+    void u2(uint16_t value);
+    void u4(uint32_t value);
+    void bytes(std::span<const uint8_t> data);
+
+    size_t offset() const;
+    // overwrites an already written u2/u4, for lengths known only afterwards
+    void patch_u2(size_t at, uint16_t value);
+    void patch_u4(size_t at, uint32_t value);
+};
+
+struct constant {
+    constant_tag tag;
+    // everything after the tag byte. points into the class or into owned pool storage
+    std::span<const uint8_t> data;
+};
+
+struct member_ref {
+    std::string_view owner;
+    std::string_view name;
+    std::string_view descriptor;
+};
+
+class constant_pool {
+    // index 0 and the second slot of long/double entries are empty
+    std::vector<std::optional<constant>> entries;
+
+    // payloads of constants added after parsing
+    std::vector<std::unique_ptr<std::vector<uint8_t>>> owned;
+
+    // tag + payload -> index, built on the first add
+    std::unordered_map<std::string, uint16_t> lookup;
+
+    uint16_t add(constant_tag tag, std::vector<uint8_t> payload);
+
+public:
+    bool parse(reader& in);
+    void write(writer& out) const;
+
+    uint16_t count() const;
+    const constant* at(uint16_t index) const;
+
+    uint16_t u2(uint16_t index, size_t offset) const;
+    uint32_t u4(uint16_t index, size_t offset) const;
+
+    // modified UTF-8, which is plain UTF-8 for everything a name can contain
+    std::string_view utf8(uint16_t index) const;
+    std::string_view class_name(uint16_t index) const;
+    std::pair<std::string_view, std::string_view> name_and_type(uint16_t index) const;
+    member_ref member(uint16_t index) const;
+
+    // adding reuses an equal constant if there already is one
+    uint16_t add_utf8(std::string_view value);
+    uint16_t add_class(std::string_view name);
+    uint16_t add_string(std::string_view value);
+    uint16_t add_integer(int32_t value);
+    uint16_t add_long(int64_t value);
+    uint16_t add_name_and_type(std::string_view name, std::string_view descriptor);
+    uint16_t add_fieldref(std::string_view owner, std::string_view name, std::string_view descriptor);
+    uint16_t add_methodref(std::string_view owner, std::string_view name, std::string_view descriptor, bool interface = false);
+};
+
+struct attribute {
+    uint16_t name_index;
+    std::span<const uint8_t> data;
+
+    // set once the attribute has been rebuilt, `data` is ignored then
+    std::optional<std::vector<uint8_t>> replaced;
+
+    std::span<const uint8_t> bytes() const;
+};
+
+class code;
+
+struct member {
+    uint16_t access;
+    uint16_t name_index;
+    uint16_t descriptor_index;
+    std::vector<attribute> attributes;
+
+    // decoded Code attribute, methods only. written back in place of the original
+    std::unique_ptr<code> body;
+};
+
+// picks the common superclass of two internal names when merging frames.
+// the default answers java/lang/Object which is always assignable, but makes
+// the merged value unusable as anything more specific
+using super_resolver = std::function<std::string(std::string_view, std::string_view)>;
+
+class class_file {
+    std::span<const uint8_t> source;
+
+public:
+    uint16_t minor_version;
+    uint16_t major_version;
+
+    constant_pool pool;
+
+    uint16_t access;
+    uint16_t this_class;
+    uint16_t super_class;
+    std::vector<uint16_t> interfaces;
+
+    std::vector<member> fields;
+    std::vector<member> methods;
+    std::vector<attribute> attributes;
+
+    static std::optional<class_file> parse(std::span<const uint8_t> bytes);
+
+    std::string_view name() const;
+    std::string_view super_name() const;
+
+    member* find_method(std::string_view name, std::string_view descriptor);
+
+    // decodes the method body on first use, null for abstract/native methods or
+    // bodies that can't be decoded (jsr/ret)
+    code* body(member& method);
+
+    // re-encodes decoded bodies with fresh stack map frames, everything else is
+    // copied verbatim. fails if a frame can't be computed
+    std::optional<std::vector<uint8_t>> write(const super_resolver& resolver = nullptr);
+};
+
+// the attribute lookup used everywhere else, by name through the pool
+const attribute* find_attribute(const constant_pool& pool, const std::vector<attribute>& attributes, std::string_view name);
+
+}
@@ -0,0 +1,675 @@
+#include "code.hpp"
+#include "frames.hpp"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace classfile {
+
+instruction instruction::of(uint8_t opcode, int32_t operand, int32_t operand2) {
+    return instruction { .opcode = opcode, .operand = operand, .operand2 = operand2, .target = 0, .keys = {}, .targets = {} };
+}
+
+instruction instruction::jump(uint8_t opcode, label target) {
+    return instruction { .opcode = opcode, .operand = 0, .operand2 = 0, .target = target, .keys = {}, .targets = {} };
+}
+
+instruction instruction::mark(label id) {
+    return instruction { .opcode = LABEL, .operand = static_cast<int32_t>(id), .operand2 = 0, .target = 0, .keys = {}, .targets = {} };
+}
+
+bool instruction::is_label() const {
+    return opcode == LABEL;
+}
+
+vtype vtype::top() {
+    return of(vtype_kind::TOP);
+}
+
+vtype vtype::of(vtype_kind kind) {
+    return vtype { .kind = kind, .name = {}, .site = 0 };
+}
+
+vtype vtype::object(std::string name) {
+    return vtype { .kind = vtype_kind::OBJECT, .name = std::move(name), .site = 0 };
+}
+
+vtype vtype::uninitialized(label site) {
+    return vtype { .kind = vtype_kind::UNINITIALIZED, .name = {}, .site = site };
+}
+
+bool vtype::is_wide() const {
+    return kind == vtype_kind::LONG || kind == vtype_kind::DOUBLE;
+}
+
+static bool is_branch(uint8_t opcode) {
+    return (opcode >= op::IFEQ && opcode <= op::GOTO) || opcode == op::IFNULL || opcode == op::IFNONNULL;
+}
+
+static bool is_local_access(uint8_t opcode) {
+    return (opcode >= op::ILOAD && opcode <= op::ALOAD) || (opcode >= op::ISTORE && opcode <= op::ASTORE);
+}
+
+static int32_t s1(uint8_t value) {
+    return static_cast<int8_t>(value);
+}
+
+static int32_t s2(uint16_t value) {
+    return static_cast<int16_t>(value);
+}
+
+// walks the raw bytecode, calling `visit` with each instruction and its offset
+template <typename visitor>
+static bool walk(std::span<const uint8_t> bytes, visitor visit) {
+    reader in(bytes);
+
+    while (in.offset() < bytes.size() && in.ok()) {
+        uint32_t offset = in.offset();
+        uint8_t opcode = in.u1();
+        auto insn = instruction::of(opcode);
+        // branch displacements are kept as absolute offsets until labels exist
+        std::vector<int64_t> jumps;
+
+        if (opcode >= op::ILOAD_0 && opcode <= op::ALOAD_3) {
+            insn.opcode = op::ILOAD + (opcode - op::ILOAD_0) / 4;
+            insn.operand = (opcode - op::ILOAD_0) % 4;
+        } else if (opcode >= op::ISTORE_0 && opcode <= op::ASTORE_3) {
+            insn.opcode = op::ISTORE + (opcode - op::ISTORE_0) / 4;
+            insn.operand = (opcode - op::ISTORE_0) % 4;
+        } else if (is_local_access(opcode) || opcode == op::NEWARRAY) {
+            insn.operand = in.u1();
+        } else if (opcode == op::LDC) {
+            insn.operand = in.u1();
+        } else if (opcode == op::LDC_W) {
+            insn.opcode = op::LDC;
+            insn.operand = in.u2();
+        } else if (opcode == op::BIPUSH) {
+            insn.operand = s1(in.u1());
+        } else if (opcode == op::SIPUSH) {
+            insn.operand = s2(in.u2());
+        } else if (opcode == op::IINC) {
+            insn.operand = in.u1();
+            insn.operand2 = s1(in.u1());
+        } else if (opcode == op::LDC2_W || (opcode >= op::GETSTATIC && opcode <= op::INVOKESTATIC) || opcode == op::NEW
+                   || opcode == op::ANEWARRAY || opcode == op::CHECKCAST || opcode == op::INSTANCEOF) {
+            insn.operand = in.u2();
+        } else if (opcode == op::INVOKEINTERFACE) {
+            insn.operand = in.u2();
+            insn.operand2 = in.u1();
+            in.u1();
+        } else if (opcode == op::INVOKEDYNAMIC) {
+            insn.operand = in.u2();
+            in.u2();
+        } else if (opcode == op::MULTIANEWARRAY) {
+            insn.operand = in.u2();
+            insn.operand2 = in.u1();
+        } else if (is_branch(opcode)) {
+            jumps.push_back(offset + s2(in.u2()));
+        } else if (opcode == op::GOTO_W) {
+            insn.opcode = op::GOTO;
+            jumps.push_back(offset + static_cast<int32_t>(in.u4()));
+        } else if (opcode == op::TABLESWITCH || opcode == op::LOOKUPSWITCH) {
+            while (in.offset() % 4 != 0 && in.ok())
+                in.u1();
+
+            jumps.push_back(offset + static_cast<int32_t>(in.u4()));
+
+            if (opcode == op::TABLESWITCH) {
+                int32_t low = in.u4();
+                int32_t high = in.u4();
+                if (high < low)
+                    return false;
+
+                for (int64_t key = low; key <= high && in.ok(); key++) {
+                    insn.keys.push_back(key);
+                    jumps.push_back(offset + static_cast<int32_t>(in.u4()));
+                }
+            } else {
+                int32_t pairs = in.u4();
+                for (int32_t i = 0; i < pairs && in.ok(); i++) {
+                    insn.keys.push_back(in.u4());
+                    jumps.push_back(offset + static_cast<int32_t>(in.u4()));
+                }
+            }
+        } else if (opcode == op::WIDE) {
+            insn.opcode = in.u1();
+            insn.operand = in.u2();
+            if (insn.opcode == op::IINC)
+                insn.operand2 = s2(in.u2());
+            else if (!is_local_access(insn.opcode))
+                return false;
+        } else if (opcode == op::JSR || opcode == op::JSR_W || opcode == op::RET || opcode > op::JSR_W) {
+            // subroutines can't have stack map frames, nothing that needs them uses these
+            return false;
+        }
+
+        if (!in.ok() || !visit(offset, std::move(insn), jumps))
+            return false;
+    }
+
+    return in.ok();
+}
+
+std::optional<code> code::decode(const class_file& clazz, const member& method, std::span<const uint8_t> data) {
+    auto& pool = clazz.pool;
+    reader in(data);
+
+    code body;
+    body.next_label = 0;
+    body.max_stack = in.u2();
+    body.max_locals = in.u2();
+
+    auto code_length = in.u4();
+    auto bytes = in.bytes(code_length);
+
+    struct raw_handler {
+        uint16_t start, end, handler, catch_type;
+    };
+
+    std::vector<raw_handler> raw_handlers(in.u2());
+    for (auto& handler : raw_handlers)
+        handler = raw_handler { in.u2(), in.u2(), in.u2(), in.u2() };
+
+    std::vector<attribute> attributes;
+    auto attribute_count = in.u2();
+    for (uint16_t i = 0; i < attribute_count && in.ok(); i++) {
+        auto name_index = in.u2();
+        auto length = in.u4();
+        attributes.push_back(attribute { .name_index = name_index, .data = in.bytes(length), .replaced = std::nullopt });
+    }
+
+    if (!in.ok())
+        return std::nullopt;
+
+    std::map<uint32_t, label> labels;
+    auto label_at = [&](uint32_t offset) {
+        auto [pos, inserted] = labels.emplace(offset, body.next_label);
+        if (inserted)
+            body.next_label++;
+
+        return pos->second;
+    };
+
+    // first pass only collects branch targets
+    if (!walk(bytes, [&](uint32_t, instruction, std::vector<int64_t>& jumps) {
+        for (auto target : jumps) {
+            if (target < 0 || target >= code_length)
+                return false;
+
+            label_at(target);
+        }
+        return true;
+    })) {
+        return std::nullopt;
+    }
+
+    for (auto& handler : raw_handlers) {
+        body.handlers.push_back(exception_handler {
+            .start = label_at(handler.start),
+            .end = label_at(handler.end),
+            .handler = label_at(handler.handler),
+            .catch_type = handler.catch_type
+        });
+    }
+
+    for (auto& attribute : attributes) {
+        auto name = pool.utf8(attribute.name_index);
+        reader table(attribute.bytes());
+
+        if (name == "LineNumberTable") {
+            auto count = table.u2();
+            for (uint16_t i = 0; i < count && table.ok(); i++) {
+                auto start = table.u2();
+                auto line = table.u2();
+                body.lines.push_back(line_number { .start = label_at(start), .line = line });
+            }
+        } else if (name == "LocalVariableTable" || name == "LocalVariableTypeTable") {
+            auto count = table.u2();
+            for (uint16_t i = 0; i < count && table.ok(); i++) {
+                auto start = table.u2();
+                auto length = table.u2();
+                auto name_index = table.u2();
+                auto descriptor_index = table.u2();
+                auto index = table.u2();
+
+                body.locals.push_back(local_variable {
+                    .start = label_at(start),
+                    .end = label_at(start + length),
+                    .name_index = name_index,
+                    .descriptor_index = descriptor_index,
+                    .index = index,
+                    .generic = name == "LocalVariableTypeTable"
+                });
+            }
+        } else if (name == "StackMapTable") {
+            auto frames = read_stack_map(pool, initial_frame(clazz, method), attribute.bytes());
+            if (!frames.has_value())
+                return std::nullopt;
+
+            for (auto& raw : *frames) {
+                auto value = std::move(raw.value);
+                for (auto [site, slot] : raw.uninitialized_locals)
+                    value.locals[slot].site = label_at(site);
+                for (auto [site, slot] : raw.uninitialized_stack)
+                    value.stack[slot].site = label_at(site);
+
+                body.declared.emplace(label_at(raw.offset), std::move(value));
+            }
+        }
+
+        // anything else refers to offsets in ways we can't follow and is dropped on encode
+    }
+
+    // second pass builds the instruction list with labels in place
+    auto next = labels.begin();
+    bool decoded = walk(bytes, [&](uint32_t offset, instruction insn, std::vector<int64_t>& jumps) {
+        for (; next != labels.end() && next->first <= offset; ++next) {
+            // a label pointing into the middle of an instruction
+            if (next->first != offset)
+                return false;
+
+            body.instructions.push_back(instruction::mark(next->second));
+        }
+
+        if (!jumps.empty()) {
+            insn.target = labels.at(jumps[0]);
+            for (size_t i = 1; i < jumps.size(); i++)
+                insn.targets.push_back(labels.at(jumps[i]));
+        }
+
+        body.instructions.push_back(std::move(insn));
+        return true;
+    });
+
+    if (!decoded)
+        return std::nullopt;
+
+    for (; next != labels.end(); ++next) {
+        if (next->first != code_length)
+            return std::nullopt;
+
+        body.instructions.push_back(instruction::mark(next->second));
+    }
+
+    return body;
+}
+
+label code::new_label() {
+    return next_label++;
+}
+
+void code::declare_local(uint16_t slot, const vtype& type) {
+    for (auto& [at, value] : declared) {
+        size_t size = slot + (type.is_wide() ? 2 : 1);
+        if (value.locals.size() < size)
+            value.locals.resize(size, vtype::top());
+
+        value.locals[slot] = type;
+        if (type.is_wide())
+            value.locals[slot + 1] = vtype::top();
+    }
+}
+
+static size_t encoded_size(const instruction& insn, uint32_t offset, bool wide_jump) {
+    if (insn.is_label())
+        return 0;
+
+    auto opcode = static_cast<uint8_t>(insn.opcode);
+
+    if (is_local_access(opcode)) {
+        if (insn.operand <= 3)
+            return 1;
+        return insn.operand <= 0xff ? 2 : 4;
+    }
+
+    switch (opcode) {
+        case op::IINC:
+            return insn.operand <= 0xff && insn.operand2 >= -128 && insn.operand2 <= 127 ? 3 : 6;
+        case op::BIPUSH:
+        case op::NEWARRAY:
+            return 2;
+        case op::LDC:
+            return insn.operand <= 0xff ? 2 : 3;
+        case op::SIPUSH:
+        case op::LDC2_W:
+        case op::GETSTATIC: case op::PUTSTATIC: case op::GETFIELD: case op::PUTFIELD:
+        case op::INVOKEVIRTUAL: case op::INVOKESPECIAL: case op::INVOKESTATIC:
+        case op::NEW: case op::ANEWARRAY: case op::CHECKCAST: case op::INSTANCEOF:
+            return 3;
+        case op::MULTIANEWARRAY:
+            return 4;
+        case op::INVOKEINTERFACE:
+        case op::INVOKEDYNAMIC:
+            return 5;
+        case op::TABLESWITCH:
+            return 1 + (3 - offset % 4) + 12 + 4 * insn.keys.size();
+        case op::LOOKUPSWITCH:
+            return 1 + (3 - offset % 4) + 8 + 8 * insn.keys.size();
+        default:
+            if (is_branch(opcode))
+                return wide_jump ? 5 : 3;
+            return 1;
+    }
+}
+
+static void encode_instruction(writer& out, const instruction& insn, uint32_t offset, bool wide_jump, const std::unordered_map<label, uint32_t>& offsets) {
+    if (insn.is_label())
+        return;
+
+    auto opcode = static_cast<uint8_t>(insn.opcode);
+    auto displacement = [&](label target) { return static_cast<int32_t>(offsets.at(target) - offset); };
+
+    if (is_local_access(opcode)) {
+        bool store = opcode >= op::ISTORE;
+        if (insn.operand <= 3) {
+            auto base = store ? op::ISTORE_0 + (opcode - op::ISTORE) * 4 : op::ILOAD_0 + (opcode - op::ILOAD) * 4;
+            out.u1(base + insn.operand);
+        } else if (insn.operand <= 0xff) {
+            out.u1(opcode);
+            out.u1(insn.operand);
+        } else {
+            out.u1(op::WIDE);
+            out.u1(opcode);
+            out.u2(insn.operand);
+        }
+        return;
+    }
+
+    switch (opcode) {
+        case op::IINC:
+            if (insn.operand <= 0xff && insn.operand2 >= -128 && insn.operand2 <= 127) {
+                out.u1(opcode);
+                out.u1(insn.operand);
+                out.u1(insn.operand2);
+            } else {
+                out.u1(op::WIDE);
+                out.u1(opcode);
+                out.u2(insn.operand);
+                out.u2(insn.operand2);
+            }
+            return;
+        case op::BIPUSH:
+        case op::NEWARRAY:
+            out.u1(opcode);
+            out.u1(insn.operand);
+            return;
+        case op::LDC:
+            if (insn.operand <= 0xff) {
+                out.u1(opcode);
+                out.u1(insn.operand);
+            } else {
+                out.u1(op::LDC_W);
+                out.u2(insn.operand);
+            }
+            return;
+        case op::SIPUSH:
+        case op::LDC2_W:
+        case op::GETSTATIC: case op::PUTSTATIC: case op::GETFIELD: case op::PUTFIELD:
+        case op::INVOKEVIRTUAL: case op::INVOKESPECIAL: case op::INVOKESTATIC:
+        case op::NEW: case op::ANEWARRAY: case op::CHECKCAST: case op::INSTANCEOF:
+            out.u1(opcode);
+            out.u2(insn.operand);
+            return;
+        case op::MULTIANEWARRAY:
+            out.u1(opcode);
+            out.u2(insn.operand);
+            out.u1(insn.operand2);
+            return;
+        case op::INVOKEINTERFACE:
+            out.u1(opcode);
+            out.u2(insn.operand);
+            out.u1(insn.operand2);
+            out.u1(0);
+            return;
+        case op::INVOKEDYNAMIC:
+            out.u1(opcode);
+            out.u2(insn.operand);
+            out.u2(0);
+            return;
+        case op::TABLESWITCH:
+        case op::LOOKUPSWITCH:
+            out.u1(opcode);
+            for (uint32_t pad = 3 - offset % 4; pad > 0; pad--)
+                out.u1(0);
+
+            out.u4(displacement(insn.target));
+            if (opcode == op::TABLESWITCH) {
+                out.u4(insn.keys.empty() ? 0 : insn.keys.front());
+                out.u4(insn.keys.empty() ? -1 : insn.keys.back());
+                for (auto target : insn.targets)
+                    out.u4(displacement(target));
+            } else {
+                out.u4(insn.keys.size());
+                for (size_t i = 0; i < insn.keys.size(); i++) {
+                    out.u4(insn.keys[i]);
+                    out.u4(displacement(insn.targets[i]));
+                }
+            }
+            return;
+        default:
+            if (is_branch(opcode)) {
+                if (wide_jump) {
+                    out.u1(op::GOTO_W);
+                    out.u4(displacement(insn.target));
+                } else {
+                    out.u1(opcode);
+                    out.u2(displacement(insn.target));
+                }
+                return;
+            }
+
+            out.u1(opcode);
+            return;
+    }
+}
+
+static void write_table(writer& out, uint16_t name_index, const std::vector<uint8_t>& table) {
+    out.u2(name_index);
+    out.u4(table.size());
+    out.bytes(table);
+}
+
+std::optional<std::vector<uint8_t>> code::encode(class_file& clazz, const member& method, const super_resolver& resolver) {
+    auto& pool = clazz.pool;
+
+    // UNINITIALIZED frames refer to the `new` by its offset, so every one needs a label
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (instructions[i].opcode == op::NEW && (i == 0 || !instructions[i - 1].is_label()))
+            instructions.insert(instructions.begin() + i++, instruction::mark(new_label()));
+    }
+
+    auto result = analyze(clazz, method, *this, resolver);
+    if (!result.has_value())
+        return std::nullopt;
+
+    // lay out until every goto fits, only unconditional jumps get widened
+    std::vector<bool> wide_jumps(instructions.size(), false);
+    std::vector<uint32_t> insn_offsets(instructions.size() + 1);
+    std::unordered_map<label, uint32_t> offsets;
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        offsets.clear();
+
+        uint32_t offset = 0;
+        for (size_t i = 0; i < instructions.size(); i++) {
+            insn_offsets[i] = offset;
+            if (instructions[i].is_label())
+                offsets[instructions[i].operand] = offset;
+
+            offset += encoded_size(instructions[i], offset, wide_jumps[i]);
+        }
+        insn_offsets[instructions.size()] = offset;
+
+        if (offset > 0xffff) {
+            std::cerr << "Method body grew past 65535 bytes." << std::endl;
+            return std::nullopt;
+        }
+
+        for (size_t i = 0; i < instructions.size(); i++) {
+            auto& insn = instructions[i];
+            if (insn.is_label() || !is_branch(insn.opcode) || wide_jumps[i])
+                continue;
+
+            int64_t displacement = int64_t(offsets.at(insn.target)) - insn_offsets[i];
+            if (displacement >= -32768 && displacement <= 32767)
+                continue;
+
+            if (insn.opcode != op::GOTO) {
+                std::cerr << "Conditional branch out of range." << std::endl;
+                return std::nullopt;
+            }
+
+            wide_jumps[i] = true;
+            changed = true;
+        }
+    }
+
+    std::vector<uint8_t> out_bytes;
+    writer out(out_bytes);
+
+    out.u2(result->max_stack);
+    out.u2(std::max(max_locals, result->max_locals));
+
+    auto length_at = out.offset();
+    out.u4(0);
+
+    for (size_t i = 0; i < instructions.size(); i++)
+        encode_instruction(out, instructions[i], insn_offsets[i], wide_jumps[i], offsets);
+
+    out.patch_u4(length_at, out.offset() - length_at - 4);
+
+    std::vector<const exception_handler*> live_handlers;
+    for (auto& handler : handlers) {
+        if (offsets.at(handler.start) < offsets.at(handler.end))
+            live_handlers.push_back(&handler);
+    }
+
+    out.u2(live_handlers.size());
+    for (auto handler : live_handlers) {
+        out.u2(offsets.at(handler->start));
+        out.u2(offsets.at(handler->end));
+        out.u2(offsets.at(handler->handler));
+        out.u2(handler->catch_type);
+    }
+
+    auto attributes_at = out.offset();
+    uint16_t attribute_count = 0;
+    out.u2(0);
+
+    if (!lines.empty()) {
+        std::vector<uint8_t> table;
+        writer entries(table);
+        entries.u2(lines.size());
+        for (auto& line : lines) {
+            entries.u2(offsets.at(line.start));
+            entries.u2(line.line);
+        }
+
+        write_table(out, pool.add_utf8("LineNumberTable"), table);
+        attribute_count++;
+    }
+
+    for (bool generic : { false, true }) {
+        std::vector<uint8_t> table;
+        writer entries(table);
+        uint16_t count = 0;
+        entries.u2(0);
+
+        for (auto& local : locals) {
+            if (local.generic != generic)
+                continue;
+
+            auto start = offsets.at(local.start);
+            entries.u2(start);
+            entries.u2(offsets.at(local.end) - start);
+            entries.u2(local.name_index);
+            entries.u2(local.descriptor_index);
+            entries.u2(local.index);
+            count++;
+        }
+
+        if (count == 0)
+            continue;
+
+        entries.patch_u2(0, count);
+        write_table(out, pool.add_utf8(generic ? "LocalVariableTypeTable" : "LocalVariableTable"), table);
+        attribute_count++;
+    }
+
+    // frames go at every jump target, handler and instruction after an unconditional jump
+    if (clazz.major_version >= 50) {
+        std::map<uint32_t, const frame*> needed;
+        auto need = [&](size_t index) {
+            // the frame before a label is the frame before whatever follows it
+            if (!result->frames[index].has_value())
+                return false;
+
+            needed.emplace(insn_offsets[index], &*result->frames[index]);
+            return true;
+        };
+
+        std::unordered_map<label, size_t> label_index;
+        for (size_t i = 0; i < instructions.size(); i++) {
+            if (instructions[i].is_label())
+                label_index[instructions[i].operand] = i;
+        }
+
+        bool after_jump = false;
+        for (size_t i = 0; i < instructions.size(); i++) {
+            auto& insn = instructions[i];
+            if (insn.is_label())
+                continue;
+
+            if (after_jump && !need(i)) {
+                std::cerr << "Unreachable code at offset " << insn_offsets[i] << " needs a frame." << std::endl;
+                return std::nullopt;
+            }
+
+            bool ok = true;
+            if (is_branch(insn.opcode) || insn.opcode == op::TABLESWITCH || insn.opcode == op::LOOKUPSWITCH) {
+                ok &= need(label_index.at(insn.target));
+                for (auto target : insn.targets)
+                    ok &= need(label_index.at(target));
+            }
+
+            if (!ok) {
+                std::cerr << "No frame for a jump target in " << pool.utf8(method.name_index) << std::endl;
+                return std::nullopt;
+            }
+
+            auto opcode = static_cast<uint8_t>(insn.opcode);
+            after_jump = opcode == op::GOTO || opcode == op::TABLESWITCH || opcode == op::LOOKUPSWITCH || opcode == op::ATHROW
+                || (opcode >= op::IRETURN && opcode <= op::RETURN);
+        }
+
+        for (auto handler : live_handlers) {
+            if (!need(label_index.at(handler->handler))) {
+                std::cerr << "No frame for an exception handler in " << pool.utf8(method.name_index) << std::endl;
+                return std::nullopt;
+            }
+        }
+
+        if (!needed.empty()) {
+            std::vector<std::pair<uint32_t, const frame*>> ordered(needed.begin(), needed.end());
+
+            std::vector<uint8_t> table;
+            writer entries(table);
+            if (!write_stack_map(entries, pool, initial_frame(clazz, method), ordered, offsets))
+                return std::nullopt;
+
+            write_table(out, pool.add_utf8("StackMapTable"), table);
+            attribute_count++;
+        }
+    }
+
+    out.patch_u2(attributes_at, attribute_count);
+    return out_bytes;
+}
+
+}
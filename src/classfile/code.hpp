@@ -0,0 +1,175 @@
+#pragma once
+
+#include "classfile.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace classfile {
+
+namespace op {
+    enum : uint8_t {
+        NOP = 0x00, ACONST_NULL = 0x01,
+        ICONST_M1 = 0x02, ICONST_0 = 0x03, ICONST_1 = 0x04, ICONST_2 = 0x05, ICONST_3 = 0x06, ICONST_4 = 0x07, ICONST_5 = 0x08,
+        LCONST_0 = 0x09, LCONST_1 = 0x0a, FCONST_0 = 0x0b, FCONST_1 = 0x0c, FCONST_2 = 0x0d, DCONST_0 = 0x0e, DCONST_1 = 0x0f,
+        BIPUSH = 0x10, SIPUSH = 0x11, LDC = 0x12, LDC_W = 0x13, LDC2_W = 0x14,
+        ILOAD = 0x15, LLOAD = 0x16, FLOAD = 0x17, DLOAD = 0x18, ALOAD = 0x19,
+        ILOAD_0 = 0x1a, LLOAD_0 = 0x1e, FLOAD_0 = 0x22, DLOAD_0 = 0x26, ALOAD_0 = 0x2a, ALOAD_3 = 0x2d,
+        IALOAD = 0x2e, LALOAD = 0x2f, FALOAD = 0x30, DALOAD = 0x31, AALOAD = 0x32, BALOAD = 0x33, CALOAD = 0x34, SALOAD = 0x35,
+        ISTORE = 0x36, LSTORE = 0x37, FSTORE = 0x38, DSTORE = 0x39, ASTORE = 0x3a,
+        ISTORE_0 = 0x3b, LSTORE_0 = 0x3f, FSTORE_0 = 0x43, DSTORE_0 = 0x47, ASTORE_0 = 0x4b, ASTORE_3 = 0x4e,
+        IASTORE = 0x4f, LASTORE = 0x50, FASTORE = 0x51, DASTORE = 0x52, AASTORE = 0x53, BASTORE = 0x54, CASTORE = 0x55, SASTORE = 0x56,
+        POP = 0x57, POP2 = 0x58, DUP = 0x59, DUP_X1 = 0x5a, DUP_X2 = 0x5b, DUP2 = 0x5c, DUP2_X1 = 0x5d, DUP2_X2 = 0x5e, SWAP = 0x5f,
+        IADD = 0x60, LADD = 0x61, FADD = 0x62, DADD = 0x63, ISUB = 0x64, LSUB = 0x65, FSUB = 0x66, DSUB = 0x67,
+        IMUL = 0x68, LMUL = 0x69, FMUL = 0x6a, DMUL = 0x6b, IDIV = 0x6c, LDIV = 0x6d, FDIV = 0x6e, DDIV = 0x6f,
+        IREM = 0x70, LREM = 0x71, FREM = 0x72, DREM = 0x73, INEG = 0x74, LNEG = 0x75, FNEG = 0x76, DNEG = 0x77,
+        ISHL = 0x78, LSHL = 0x79, ISHR = 0x7a, LSHR = 0x7b, IUSHR = 0x7c, LUSHR = 0x7d,
+        IAND = 0x7e, LAND = 0x7f, IOR = 0x80, LOR = 0x81, IXOR = 0x82, LXOR = 0x83, IINC = 0x84,
+        I2L = 0x85, I2F = 0x86, I2D = 0x87, L2I = 0x88, L2F = 0x89, L2D = 0x8a, F2I = 0x8b, F2L = 0x8c, F2D = 0x8d,
+        D2I = 0x8e, D2L = 0x8f, D2F = 0x90, I2B = 0x91, I2C = 0x92, I2S = 0x93,
+        LCMP = 0x94, FCMPL = 0x95, FCMPG = 0x96, DCMPL = 0x97, DCMPG = 0x98,
+        IFEQ = 0x99, IFNE = 0x9a, IFLT = 0x9b, IFGE = 0x9c, IFGT = 0x9d, IFLE = 0x9e,
+        IF_ICMPEQ = 0x9f, IF_ICMPNE = 0xa0, IF_ICMPLT = 0xa1, IF_ICMPGE = 0xa2, IF_ICMPGT = 0xa3, IF_ICMPLE = 0xa4,
+        IF_ACMPEQ = 0xa5, IF_ACMPNE = 0xa6, GOTO = 0xa7, JSR = 0xa8, RET = 0xa9,
+        TABLESWITCH = 0xaa, LOOKUPSWITCH = 0xab,
+        IRETURN = 0xac, LRETURN = 0xad, FRETURN = 0xae, DRETURN = 0xaf, ARETURN = 0xb0, RETURN = 0xb1,
+        GETSTATIC = 0xb2, PUTSTATIC = 0xb3, GETFIELD = 0xb4, PUTFIELD = 0xb5,
+        INVOKEVIRTUAL = 0xb6, INVOKESPECIAL = 0xb7, INVOKESTATIC = 0xb8, INVOKEINTERFACE = 0xb9, INVOKEDYNAMIC = 0xba,
+        NEW = 0xbb, NEWARRAY = 0xbc, ANEWARRAY = 0xbd, ARRAYLENGTH = 0xbe, ATHROW = 0xbf,
+        CHECKCAST = 0xc0, INSTANCEOF = 0xc1, MONITORENTER = 0xc2, MONITOREXIT = 0xc3,
+        WIDE = 0xc4, MULTIANEWARRAY = 0xc5, IFNULL = 0xc6, IFNONNULL = 0xc7, GOTO_W = 0xc8, JSR_W = 0xc9
+    };
+}
+
+// labels are plain ids, placed in the instruction list with a LABEL pseudo-op
+using label = uint32_t;
+
+constexpr int16_t LABEL = -1;
+
+struct instruction {
+    // JVM opcode, or LABEL. short forms (iload_0) and wide forms are
+    // normalized when decoding and picked again when encoding
+    int16_t opcode;
+
+    // local index, constant pool index, immediate, newarray type or label id
+    int32_t operand;
+    // iinc increment, invokeinterface count, multianewarray dimensions
+    int32_t operand2;
+
+    // branch target, or the default of a switch
+    label target;
+
+    // tableswitch: keys are low, low+1, ...
+    std::vector<int32_t> keys;
+    std::vector<label> targets;
+
+    static instruction of(uint8_t opcode, int32_t operand = 0, int32_t operand2 = 0);
+    static instruction jump(uint8_t opcode, label target);
+    static instruction mark(label id);
+
+    bool is_label() const;
+};
+
+enum class vtype_kind : uint8_t {
+    TOP = 0,
+    INTEGER = 1,
+    FLOAT = 2,
+    DOUBLE = 3,
+    LONG = 4,
+    NULL_TYPE = 5,
+    UNINITIALIZED_THIS = 6,
+    OBJECT = 7,
+    UNINITIALIZED = 8
+};
+
+// verification type. long/double take two slots, the second one is TOP
+struct vtype {
+    vtype_kind kind;
+    // OBJECT: internal name or array descriptor
+    std::string name;
+    // UNINITIALIZED: label right before the `new`
+    label site;
+
+    static vtype top();
+    static vtype of(vtype_kind kind);
+    static vtype object(std::string name);
+    static vtype uninitialized(label site);
+
+    bool is_wide() const;
+    bool operator==(const vtype& other) const = default;
+};
+
+struct frame {
+    std::vector<vtype> locals;
+    std::vector<vtype> stack;
+
+    bool operator==(const frame& other) const = default;
+};
+
+struct exception_handler {
+    label start;
+    label end;
+    label handler;
+    // 0 catches everything
+    uint16_t catch_type;
+};
+
+struct line_number {
+    label start;
+    uint16_t line;
+};
+
+struct local_variable {
+    label start;
+    label end;
+    uint16_t name_index;
+    uint16_t descriptor_index;
+    uint16_t index;
+    // LocalVariableTypeTable entry, descriptor_index is a signature then
+    bool generic;
+};
+
+// A decoded method body. Branch targets, exception ranges and debug tables
+// all refer to labels, so instructions can be inserted and removed freely and
+// offsets are only worked out again when encoding.
+class code {
+    label next_label;
+
+public:
+    uint16_t max_stack;
+    uint16_t max_locals;
+
+    std::vector<instruction> instructions;
+    std::vector<exception_handler> handlers;
+    std::vector<line_number> lines;
+    std::vector<local_variable> locals;
+
+    // frames from the original StackMapTable. they are trusted as-is when
+    // computing new frames, so edits that keep the original code's view of
+    // locals and stack don't need a common superclass resolver
+    std::unordered_map<label, frame> declared;
+
+    static std::optional<code> decode(const class_file& clazz, const member& method, std::span<const uint8_t> data);
+
+    label new_label();
+
+    // makes a local added by an edit visible in every declared frame
+    void declare_local(uint16_t slot, const vtype& type);
+
+    // Code attribute payload, with max_stack/max_locals and frames recomputed
+    std::optional<std::vector<uint8_t>> encode(class_file& clazz, const member& method, const super_resolver& resolver);
+};
+
+// entry frame of a method, from its descriptor and access flags
+frame initial_frame(const class_file& clazz, const member& method);
+
+// field descriptor -> verification type, with long/double expanded to two slots
+void push_descriptor_type(std::vector<vtype>& out, std::string_view descriptor);
+
+// splits "(IJLjava/lang/String;)V" into argument descriptors and the return descriptor
+bool split_method_descriptor(std::string_view descriptor, std::vector<std::string_view>& arguments, std::string_view& result);
+
+}
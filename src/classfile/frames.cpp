@@ -0,0 +1,928 @@
+#include "frames.hpp"
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace classfile {
+
+static vtype descriptor_type(std::string_view descriptor) {
+    switch (descriptor.empty() ? 'V' : descriptor[0]) {
+        case 'B': case 'C': case 'I': case 'S': case 'Z':
+            return vtype::of(vtype_kind::INTEGER);
+        case 'F':
+            return vtype::of(vtype_kind::FLOAT);
+        case 'J':
+            return vtype::of(vtype_kind::LONG);
+        case 'D':
+            return vtype::of(vtype_kind::DOUBLE);
+        case 'L':
+            return vtype::object(std::string(descriptor.substr(1, descriptor.size() - 2)));
+        case '[':
+            return vtype::object(std::string(descriptor));
+        default:
+            return vtype::top();
+    }
+}
+
+void push_descriptor_type(std::vector<vtype>& out, std::string_view descriptor) {
+    auto type = descriptor_type(descriptor);
+    if (!descriptor.empty() && descriptor[0] == 'V')
+        return;
+
+    out.push_back(type);
+    if (type.is_wide())
+        out.push_back(vtype::top());
+}
+
+bool split_method_descriptor(std::string_view descriptor, std::vector<std::string_view>& arguments, std::string_view& result) {
+    if (descriptor.empty() || descriptor[0] != '(')
+        return false;
+
+    size_t pos = 1;
+    while (pos < descriptor.size() && descriptor[pos] != ')') {
+        auto start = pos;
+        while (pos < descriptor.size() && descriptor[pos] == '[')
+            pos++;
+
+        if (pos < descriptor.size() && descriptor[pos] == 'L')
+            pos = descriptor.find(';', pos);
+
+        if (pos == std::string_view::npos || pos >= descriptor.size())
+            return false;
+
+        arguments.push_back(descriptor.substr(start, ++pos - start));
+    }
+
+    if (pos >= descriptor.size())
+        return false;
+
+    result = descriptor.substr(pos + 1);
+    return true;
+}
+
+frame initial_frame(const class_file& clazz, const member& method) {
+    frame value;
+
+    auto name = clazz.pool.utf8(method.name_index);
+    if (!(method.access & access::STATIC)) {
+        if (name == "<init>" && clazz.name() != "java/lang/Object")
+            value.locals.push_back(vtype::of(vtype_kind::UNINITIALIZED_THIS));
+        else
+            value.locals.push_back(vtype::object(std::string(clazz.name())));
+    }
+
+    std::vector<std::string_view> arguments;
+    std::string_view result;
+    if (split_method_descriptor(clazz.pool.utf8(method.descriptor_index), arguments, result)) {
+        for (auto argument : arguments)
+            push_descriptor_type(value.locals, argument);
+    }
+
+    return value;
+}
+
+// slot form -> verification_type_info entries, dropping the TOP after long/double
+static std::vector<const vtype*> entries_of(const std::vector<vtype>& slots, bool trim) {
+    size_t end = slots.size();
+    while (trim && end > 0 && slots[end - 1].kind == vtype_kind::TOP)
+        end--;
+
+    std::vector<const vtype*> entries;
+    for (size_t i = 0; i < end; i++) {
+        entries.push_back(&slots[i]);
+        if (slots[i].is_wide())
+            i++;
+    }
+
+    return entries;
+}
+
+// one verification_type_info entry, UNINITIALIZED keeps its raw offset in `site` for now
+static bool read_vtype(reader& in, const constant_pool& pool, vtype& type) {
+    auto tag = in.u1();
+    if (tag > static_cast<uint8_t>(vtype_kind::UNINITIALIZED))
+        return false;
+
+    auto kind = static_cast<vtype_kind>(tag);
+    if (kind == vtype_kind::OBJECT)
+        type = vtype::object(std::string(pool.class_name(in.u2())));
+    else if (kind == vtype_kind::UNINITIALIZED)
+        type = vtype::uninitialized(in.u2());
+    else
+        type = vtype::of(kind);
+
+    return in.ok();
+}
+
+static bool read_vtypes(reader& in, const constant_pool& pool, std::vector<vtype>& entries, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (!read_vtype(in, pool, entries.emplace_back()))
+            return false;
+    }
+
+    return true;
+}
+
+// entries -> slot form, noting where the UNINITIALIZED ones ended up
+static std::vector<vtype> expand(const std::vector<vtype>& entries, std::vector<std::pair<uint32_t, size_t>>& uninitialized) {
+    std::vector<vtype> slots;
+
+    for (auto& type : entries) {
+        if (type.kind == vtype_kind::UNINITIALIZED)
+            uninitialized.emplace_back(type.site, slots.size());
+
+        slots.push_back(type);
+        if (type.is_wide())
+            slots.push_back(vtype::top());
+    }
+
+    return slots;
+}
+
+std::optional<std::vector<raw_frame>> read_stack_map(const constant_pool& pool, const frame& initial, std::span<const uint8_t> data) {
+    reader in(data);
+    std::vector<raw_frame> frames;
+
+    // chop/append count in entries, so the previous locals are kept in that form
+    std::vector<vtype> locals;
+    for (auto type : entries_of(initial.locals, false))
+        locals.push_back(*type);
+
+    int64_t offset = -1;
+
+    auto count = in.u2();
+    for (uint16_t i = 0; i < count && in.ok(); i++) {
+        auto type = in.u1();
+
+        uint32_t delta;
+        std::vector<vtype> stack;
+
+        if (type < 64) {
+            delta = type;
+        } else if (type < 128) {
+            delta = type - 64;
+            if (!read_vtypes(in, pool, stack, 1))
+                return std::nullopt;
+        } else if (type < 247) {
+            return std::nullopt;
+        } else if (type == 247) {
+            delta = in.u2();
+            if (!read_vtypes(in, pool, stack, 1))
+                return std::nullopt;
+        } else if (type < 251) {
+            delta = in.u2();
+
+            size_t chop = 251 - type;
+            if (chop > locals.size())
+                return std::nullopt;
+
+            locals.resize(locals.size() - chop);
+        } else if (type == 251) {
+            delta = in.u2();
+        } else if (type < 255) {
+            delta = in.u2();
+            if (!read_vtypes(in, pool, locals, type - 251))
+                return std::nullopt;
+        } else {
+            delta = in.u2();
+
+            locals.clear();
+            if (!read_vtypes(in, pool, locals, in.u2()))
+                return std::nullopt;
+            if (!read_vtypes(in, pool, stack, in.u2()))
+                return std::nullopt;
+        }
+
+        offset += delta + 1;
+
+        raw_frame raw;
+        raw.offset = offset;
+        raw.value.locals = expand(locals, raw.uninitialized_locals);
+        raw.value.stack = expand(stack, raw.uninitialized_stack);
+        frames.push_back(std::move(raw));
+    }
+
+    if (!in.ok())
+        return std::nullopt;
+
+    return frames;
+}
+
+static void write_vtype(writer& out, constant_pool& pool, const vtype& type, const std::unordered_map<label, uint32_t>& offsets) {
+    out.u1(static_cast<uint8_t>(type.kind));
+
+    if (type.kind == vtype_kind::OBJECT)
+        out.u2(pool.add_class(type.name));
+    else if (type.kind == vtype_kind::UNINITIALIZED)
+        out.u2(offsets.at(type.site));
+}
+
+bool write_stack_map(writer& out, constant_pool& pool, const frame& initial, const std::vector<std::pair<uint32_t, const frame*>>& frames, const std::unordered_map<label, uint32_t>& offsets) {
+    out.u2(frames.size());
+
+    auto previous = entries_of(initial.locals, true);
+    int64_t previous_offset = -1;
+
+    auto same = [](const std::vector<const vtype*>& a, const std::vector<const vtype*>& b, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            if (*a[i] != *b[i])
+                return false;
+        }
+        return true;
+    };
+
+    for (auto& [offset, value] : frames) {
+        uint32_t delta = offset - previous_offset - 1;
+        previous_offset = offset;
+
+        auto locals = entries_of(value->locals, true);
+        auto stack = entries_of(value->stack, false);
+
+        bool same_locals = locals.size() == previous.size() && same(locals, previous, locals.size());
+
+        if (same_locals && stack.empty()) {
+            if (delta < 64) {
+                out.u1(delta);
+            } else {
+                out.u1(251);
+                out.u2(delta);
+            }
+        } else if (same_locals && stack.size() == 1) {
+            if (delta < 64) {
+                out.u1(64 + delta);
+            } else {
+                out.u1(247);
+                out.u2(delta);
+            }
+            write_vtype(out, pool, *stack[0], offsets);
+        } else if (stack.empty() && locals.size() < previous.size() && previous.size() - locals.size() <= 3 && same(locals, previous, locals.size())) {
+            out.u1(251 - (previous.size() - locals.size()));
+            out.u2(delta);
+        } else if (stack.empty() && locals.size() > previous.size() && locals.size() - previous.size() <= 3 && same(locals, previous, previous.size())) {
+            out.u1(251 + (locals.size() - previous.size()));
+            out.u2(delta);
+            for (size_t i = previous.size(); i < locals.size(); i++)
+                write_vtype(out, pool, *locals[i], offsets);
+        } else {
+            out.u1(255);
+            out.u2(delta);
+            out.u2(locals.size());
+            for (auto type : locals)
+                write_vtype(out, pool, *type, offsets);
+            out.u2(stack.size());
+            for (auto type : stack)
+                write_vtype(out, pool, *type, offsets);
+        }
+
+        previous = std::move(locals);
+    }
+
+    return true;
+}
+
+static bool is_branch(uint8_t opcode) {
+    return (opcode >= op::IFEQ && opcode <= op::GOTO) || opcode == op::IFNULL || opcode == op::IFNONNULL;
+}
+
+// merges `incoming` into `current`, true if anything changed
+static bool merge_type(vtype& current, const vtype& incoming, const super_resolver& resolver) {
+    if (current == incoming)
+        return false;
+
+    bool current_ref = current.kind == vtype_kind::OBJECT || current.kind == vtype_kind::NULL_TYPE;
+    bool incoming_ref = incoming.kind == vtype_kind::OBJECT || incoming.kind == vtype_kind::NULL_TYPE;
+
+    if (current_ref && incoming_ref) {
+        if (incoming.kind == vtype_kind::NULL_TYPE)
+            return false;
+
+        if (current.kind == vtype_kind::NULL_TYPE) {
+            current = incoming;
+            return true;
+        }
+
+        auto common = resolver ? resolver(current.name, incoming.name) : std::string("java/lang/Object");
+        if (common == current.name)
+            return false;
+
+        current = vtype::object(std::move(common));
+        return true;
+    }
+
+    if (current.kind == vtype_kind::TOP)
+        return false;
+
+    current = vtype::top();
+    return true;
+}
+
+static std::optional<bool> merge_frame(frame& current, const frame& incoming, const super_resolver& resolver) {
+    if (current.stack.size() != incoming.stack.size())
+        return std::nullopt;
+
+    bool changed = false;
+
+    // anything only one side has a value for is unusable afterwards
+    if (current.locals.size() > incoming.locals.size()) {
+        for (size_t i = incoming.locals.size(); i < current.locals.size(); i++)
+            changed |= merge_type(current.locals[i], vtype::top(), resolver);
+    }
+
+    for (size_t i = 0; i < std::min(current.locals.size(), incoming.locals.size()); i++)
+        changed |= merge_type(current.locals[i], incoming.locals[i], resolver);
+
+    // a long/double that lost its second half is gone too
+    for (size_t i = 0; i < current.locals.size(); i++) {
+        if (current.locals[i].is_wide() && (i + 1 >= current.locals.size() || current.locals[i + 1].kind != vtype_kind::TOP)) {
+            current.locals[i] = vtype::top();
+            changed = true;
+        }
+    }
+
+    for (size_t i = 0; i < current.stack.size(); i++) {
+        auto before = current.stack[i].kind;
+        changed |= merge_type(current.stack[i], incoming.stack[i], resolver);
+
+        // values of different kinds can't meet on the stack
+        if (current.stack[i].kind == vtype_kind::TOP && before != vtype_kind::TOP)
+            return std::nullopt;
+    }
+
+    return changed;
+}
+
+// simulates one instruction on the frame, in slot form
+class interpreter {
+    const class_file& clazz;
+    frame& state;
+
+    // label before each `new`, to find the class an UNINITIALIZED gets initialized to
+    const std::unordered_map<label, uint16_t>& new_sites;
+
+public:
+    uint16_t max_stack;
+    uint16_t max_locals;
+
+    interpreter(const class_file& clazz, frame& state, const std::unordered_map<label, uint16_t>& new_sites)
+        : clazz(clazz), state(state), new_sites(new_sites), max_stack(0), max_locals(0) {}
+
+    void track() {
+        max_stack = std::max<size_t>(max_stack, state.stack.size());
+        max_locals = std::max<size_t>(max_locals, state.locals.size());
+    }
+
+    bool pop(size_t count = 1) {
+        if (state.stack.size() < count)
+            return false;
+
+        state.stack.resize(state.stack.size() - count);
+        return true;
+    }
+
+    void push(vtype type) {
+        bool wide = type.is_wide();
+        state.stack.push_back(std::move(type));
+        if (wide)
+            state.stack.push_back(vtype::top());
+        track();
+    }
+
+    void push(vtype_kind kind) {
+        push(vtype::of(kind));
+    }
+
+    void push(std::string_view descriptor) {
+        push_descriptor_type(state.stack, descriptor);
+        track();
+    }
+
+    const vtype& peek(size_t depth = 0) {
+        return state.stack[state.stack.size() - 1 - depth];
+    }
+
+    void store(size_t slot, vtype type) {
+        size_t size = slot + (type.is_wide() ? 2 : 1);
+        if (state.locals.size() < size)
+            state.locals.resize(size, vtype::top());
+
+        // overwriting the second half of a long/double kills it
+        if (slot > 0 && state.locals[slot - 1].is_wide())
+            state.locals[slot - 1] = vtype::top();
+
+        bool wide = type.is_wide();
+        state.locals[slot] = std::move(type);
+        if (wide)
+            state.locals[slot + 1] = vtype::top();
+
+        track();
+    }
+
+    vtype load(size_t slot) {
+        max_locals = std::max<size_t>(max_locals, slot + 1);
+        return slot < state.locals.size() ? state.locals[slot] : vtype::top();
+    }
+
+    void initialize(const vtype& uninitialized, const vtype& initialized) {
+        for (auto& type : state.locals) {
+            if (type == uninitialized)
+                type = initialized;
+        }
+        for (auto& type : state.stack) {
+            if (type == uninitialized)
+                type = initialized;
+        }
+    }
+
+    bool invoke(const instruction& insn) {
+        auto opcode = static_cast<uint8_t>(insn.opcode);
+        auto ref = clazz.pool.member(insn.operand);
+
+        std::vector<std::string_view> arguments;
+        std::string_view result;
+        if (!split_method_descriptor(ref.descriptor, arguments, result))
+            return false;
+
+        size_t words = 0;
+        for (auto argument : arguments)
+            words += argument == "J" || argument == "D" ? 2 : 1;
+
+        if (!pop(words))
+            return false;
+
+        if (opcode != op::INVOKESTATIC && opcode != op::INVOKEDYNAMIC) {
+            if (state.stack.empty())
+                return false;
+
+            auto receiver = peek();
+            pop();
+
+            if (opcode == op::INVOKESPECIAL && ref.name == "<init>") {
+                if (receiver.kind == vtype_kind::UNINITIALIZED_THIS) {
+                    initialize(receiver, vtype::object(std::string(clazz.name())));
+                } else if (receiver.kind == vtype_kind::UNINITIALIZED) {
+                    auto site = new_sites.find(receiver.site);
+                    if (site == new_sites.end())
+                        return false;
+
+                    initialize(receiver, vtype::object(std::string(clazz.pool.class_name(site->second))));
+                }
+            }
+        }
+
+        push(result);
+        return true;
+    }
+
+    vtype ldc_type(uint16_t index) {
+        auto entry = clazz.pool.at(index);
+        if (entry == nullptr)
+            return vtype::top();
+
+        switch (entry->tag) {
+            case constant_tag::INTEGER: return vtype::of(vtype_kind::INTEGER);
+            case constant_tag::FLOAT: return vtype::of(vtype_kind::FLOAT);
+            case constant_tag::LONG: return vtype::of(vtype_kind::LONG);
+            case constant_tag::DOUBLE: return vtype::of(vtype_kind::DOUBLE);
+            case constant_tag::STRING: return vtype::object("java/lang/String");
+            case constant_tag::CLASS: return vtype::object("java/lang/Class");
+            case constant_tag::METHOD_TYPE: return vtype::object("java/lang/invoke/MethodType");
+            case constant_tag::METHOD_HANDLE: return vtype::object("java/lang/invoke/MethodHandle");
+            case constant_tag::DYNAMIC: return descriptor_type(clazz.pool.member(index).descriptor);
+            default: return vtype::top();
+        }
+    }
+
+    // element type of the array reference below the index
+    vtype element_type(const vtype& array) {
+        if (array.kind != vtype_kind::OBJECT || array.name.size() < 2 || array.name[0] != '[')
+            return vtype::of(vtype_kind::NULL_TYPE);
+
+        return descriptor_type(std::string_view(array.name).substr(1));
+    }
+
+    bool execute(const instruction& insn) {
+        auto opcode = static_cast<uint8_t>(insn.opcode);
+        auto& pool = clazz.pool;
+
+        switch (opcode) {
+            case op::NOP:
+                return true;
+            case op::ACONST_NULL:
+                push(vtype_kind::NULL_TYPE);
+                return true;
+            case op::ICONST_M1: case op::ICONST_0: case op::ICONST_1: case op::ICONST_2:
+            case op::ICONST_3: case op::ICONST_4: case op::ICONST_5: case op::BIPUSH: case op::SIPUSH:
+                push(vtype_kind::INTEGER);
+                return true;
+            case op::LCONST_0: case op::LCONST_1:
+                push(vtype_kind::LONG);
+                return true;
+            case op::FCONST_0: case op::FCONST_1: case op::FCONST_2:
+                push(vtype_kind::FLOAT);
+                return true;
+            case op::DCONST_0: case op::DCONST_1:
+                push(vtype_kind::DOUBLE);
+                return true;
+            case op::LDC: case op::LDC2_W:
+                push(ldc_type(insn.operand));
+                return true;
+            case op::ILOAD:
+                load(insn.operand);
+                push(vtype_kind::INTEGER);
+                return true;
+            case op::LLOAD:
+                load(insn.operand + 1);
+                push(vtype_kind::LONG);
+                return true;
+            case op::FLOAD:
+                load(insn.operand);
+                push(vtype_kind::FLOAT);
+                return true;
+            case op::DLOAD:
+                load(insn.operand + 1);
+                push(vtype_kind::DOUBLE);
+                return true;
+            case op::ALOAD:
+                push(load(insn.operand));
+                return true;
+            case op::IALOAD: case op::BALOAD: case op::CALOAD: case op::SALOAD:
+                if (!pop(2)) return false;
+                push(vtype_kind::INTEGER);
+                return true;
+            case op::LALOAD:
+                if (!pop(2)) return false;
+                push(vtype_kind::LONG);
+                return true;
+            case op::FALOAD:
+                if (!pop(2)) return false;
+                push(vtype_kind::FLOAT);
+                return true;
+            case op::DALOAD:
+                if (!pop(2)) return false;
+                push(vtype_kind::DOUBLE);
+                return true;
+            case op::AALOAD: {
+                if (state.stack.size() < 2) return false;
+                auto element = element_type(peek(1));
+                pop(2);
+                push(element);
+            } return true;
+            case op::ISTORE: case op::FSTORE: case op::ASTORE: {
+                if (state.stack.empty()) return false;
+                auto value = peek();
+                pop();
+                store(insn.operand, value);
+            } return true;
+            case op::LSTORE: case op::DSTORE: {
+                if (state.stack.size() < 2) return false;
+                auto value = peek(1);
+                pop(2);
+                store(insn.operand, value);
+            } return true;
+            case op::IASTORE: case op::FASTORE: case op::AASTORE: case op::BASTORE: case op::CASTORE: case op::SASTORE:
+                return pop(3);
+            case op::LASTORE: case op::DASTORE:
+                return pop(4);
+            case op::POP:
+                return pop(1);
+            case op::POP2:
+                return pop(2);
+            case op::DUP: {
+                if (state.stack.empty()) return false;
+                state.stack.push_back(peek());
+            } break;
+            case op::DUP_X1: {
+                if (state.stack.size() < 2) return false;
+                auto v1 = peek();
+                state.stack.insert(state.stack.end() - 2, v1);
+            } break;
+            case op::DUP_X2: {
+                if (state.stack.size() < 3) return false;
+                auto v1 = peek();
+                state.stack.insert(state.stack.end() - 3, v1);
+            } break;
+            case op::DUP2: {
+                if (state.stack.size() < 2) return false;
+                auto v2 = peek(1), v1 = peek();
+                state.stack.push_back(v2);
+                state.stack.push_back(v1);
+            } break;
+            case op::DUP2_X1: {
+                if (state.stack.size() < 3) return false;
+                auto v2 = peek(1), v1 = peek();
+                state.stack.insert(state.stack.end() - 3, { v2, v1 });
+            } break;
+            case op::DUP2_X2: {
+                if (state.stack.size() < 4) return false;
+                auto v2 = peek(1), v1 = peek();
+                state.stack.insert(state.stack.end() - 4, { v2, v1 });
+            } break;
+            case op::SWAP: {
+                if (state.stack.size() < 2) return false;
+                std::swap(state.stack[state.stack.size() - 1], state.stack[state.stack.size() - 2]);
+            } return true;
+            case op::IADD: case op::ISUB: case op::IMUL: case op::IDIV: case op::IREM:
+            case op::ISHL: case op::ISHR: case op::IUSHR: case op::IAND: case op::IOR: case op::IXOR:
+                if (!pop(2)) return false;
+                push(vtype_kind::INTEGER);
+                return true;
+            case op::LADD: case op::LSUB: case op::LMUL: case op::LDIV: case op::LREM:
+            case op::LAND: case op::LOR: case op::LXOR:
+                if (!pop(4)) return false;
+                push(vtype_kind::LONG);
+                return true;
+            case op::LSHL: case op::LSHR: case op::LUSHR:
+                if (!pop(3)) return false;
+                push(vtype_kind::LONG);
+                return true;
+            case op::FADD: case op::FSUB: case op::FMUL: case op::FDIV: case op::FREM:
+                if (!pop(2)) return false;
+                push(vtype_kind::FLOAT);
+                return true;
+            case op::DADD: case op::DSUB: case op::DMUL: case op::DDIV: case op::DREM:
+                if (!pop(4)) return false;
+                push(vtype_kind::DOUBLE);
+                return true;
+            case op::INEG: case op::FNEG: case op::LNEG: case op::DNEG:
+                return true;
+            case op::IINC:
+                load(insn.operand);
+                return true;
+            case op::I2L: case op::F2L:
+                if (!pop(1)) return false;
+                push(vtype_kind::LONG);
+                return true;
+            case op::I2F:
+                if (!pop(1)) return false;
+                push(vtype_kind::FLOAT);
+                return true;
+            case op::I2D: case op::F2D:
+                if (!pop(1)) return false;
+                push(vtype_kind::DOUBLE);
+                return true;
+            case op::L2I: case op::D2I:
+                if (!pop(2)) return false;
+                push(vtype_kind::INTEGER);
+                return true;
+            case op::L2F: case op::D2F:
+                if (!pop(2)) return false;
+                push(vtype_kind::FLOAT);
+                return true;
+            case op::L2D:
+                if (!pop(2)) return false;
+                push(vtype_kind::DOUBLE);
+                return true;
+            case op::D2L:
+                if (!pop(2)) return false;
+                push(vtype_kind::LONG);
+                return true;
+            case op::F2I: case op::I2B: case op::I2C: case op::I2S:
+                if (!pop(1)) return false;
+                push(vtype_kind::INTEGER);
+                return true;
+            case op::LCMP: case op::DCMPL: case op::DCMPG:
+                if (!pop(4)) return false;
+                push(vtype_kind::INTEGER);
+                return true;
+            case op::FCMPL: case op::FCMPG:
+                if (!pop(2)) return false;
+                push(vtype_kind::INTEGER);
+                return true;
+            case op::IFEQ: case op::IFNE: case op::IFLT: case op::IFGE: case op::IFGT: case op::IFLE:
+            case op::IFNULL: case op::IFNONNULL: case op::TABLESWITCH: case op::LOOKUPSWITCH:
+                return pop(1);
+            case op::IF_ICMPEQ: case op::IF_ICMPNE: case op::IF_ICMPLT: case op::IF_ICMPGE:
+            case op::IF_ICMPGT: case op::IF_ICMPLE: case op::IF_ACMPEQ: case op::IF_ACMPNE:
+                return pop(2);
+            case op::GOTO: case op::RETURN:
+                return true;
+            case op::IRETURN: case op::FRETURN: case op::ARETURN: case op::ATHROW:
+            case op::MONITORENTER: case op::MONITOREXIT:
+                return pop(1);
+            case op::LRETURN: case op::DRETURN:
+                return pop(2);
+            case op::GETSTATIC:
+                push(pool.member(insn.operand).descriptor);
+                return true;
+            case op::PUTSTATIC: {
+                auto descriptor = pool.member(insn.operand).descriptor;
+                return pop(descriptor == "J" || descriptor == "D" ? 2 : 1);
+            }
+            case op::GETFIELD:
+                if (!pop(1)) return false;
+                push(pool.member(insn.operand).descriptor);
+                return true;
+            case op::PUTFIELD: {
+                auto descriptor = pool.member(insn.operand).descriptor;
+                return pop(descriptor == "J" || descriptor == "D" ? 3 : 2);
+            }
+            case op::INVOKEVIRTUAL: case op::INVOKESPECIAL: case op::INVOKESTATIC:
+            case op::INVOKEINTERFACE: case op::INVOKEDYNAMIC:
+                return invoke(insn);
+            case op::NEW:
+                return false;
+            case op::NEWARRAY: {
+                static const char* codes = "ZCFDBSIJ";
+                if (insn.operand < 4 || insn.operand > 11 || !pop(1)) return false;
+                push(vtype::object(std::string("[") + codes[insn.operand - 4]));
+            } return true;
+            case op::ANEWARRAY: {
+                if (!pop(1)) return false;
+                auto name = pool.class_name(insn.operand);
+                push(vtype::object(name.starts_with("[") ? "[" + std::string(name) : "[L" + std::string(name) + ";"));
+            } return true;
+            case op::ARRAYLENGTH: case op::INSTANCEOF:
+                if (!pop(1)) return false;
+                push(vtype_kind::INTEGER);
+                return true;
+            case op::CHECKCAST:
+                if (!pop(1)) return false;
+                push(vtype::object(std::string(pool.class_name(insn.operand))));
+                return true;
+            case op::MULTIANEWARRAY:
+                if (!pop(insn.operand2)) return false;
+                push(vtype::object(std::string(pool.class_name(insn.operand))));
+                return true;
+            default:
+                return false;
+        }
+
+        track();
+        return true;
+    }
+
+    // `new` needs the label in front of it, so the caller handles it
+    void allocate(label site) {
+        push(vtype::uninitialized(site));
+    }
+};
+
+std::optional<analysis> analyze(const class_file& clazz, const member& method, const code& body, const super_resolver& resolver) {
+    auto& instructions = body.instructions;
+
+    std::unordered_map<label, size_t> label_index;
+    std::unordered_map<label, uint16_t> new_sites;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (!instructions[i].is_label())
+            continue;
+
+        label_index[instructions[i].operand] = i;
+
+        // the label right before a `new` names its allocation site
+        for (size_t j = i + 1; j < instructions.size(); j++) {
+            if (instructions[j].is_label())
+                continue;
+
+            if (instructions[j].opcode == op::NEW)
+                new_sites[instructions[i].operand] = instructions[j].operand;
+            break;
+        }
+    }
+
+    // handlers covering each instruction
+    std::vector<std::vector<const exception_handler*>> covering(instructions.size());
+    for (auto& handler : body.handlers) {
+        auto start = label_index.find(handler.start);
+        auto end = label_index.find(handler.end);
+        if (start == label_index.end() || end == label_index.end() || !label_index.contains(handler.handler))
+            return std::nullopt;
+
+        for (size_t i = start->second; i < end->second; i++)
+            covering[i].push_back(&handler);
+    }
+
+    analysis result;
+    result.frames.resize(instructions.size());
+    result.max_stack = 0;
+    result.max_locals = 0;
+
+    std::vector<size_t> worklist;
+    std::vector<bool> queued(instructions.size(), false);
+
+    auto flow = [&](size_t index, const frame& incoming) {
+        if (index >= instructions.size())
+            return false;
+
+        auto& current = result.frames[index];
+
+        // declared frames are authoritative, whatever flows in is assumed to fit
+        if (instructions[index].is_label()) {
+            auto declared = body.declared.find(instructions[index].operand);
+            if (declared != body.declared.end()) {
+                if (!current.has_value()) {
+                    current = declared->second;
+                    worklist.push_back(index);
+                }
+                return true;
+            }
+        }
+
+        if (!current.has_value()) {
+            current = incoming;
+        } else {
+            auto changed = merge_frame(*current, incoming, resolver);
+            if (!changed.has_value())
+                return false;
+            if (!*changed)
+                return true;
+        }
+
+        if (!queued[index]) {
+            queued[index] = true;
+            worklist.push_back(index);
+        }
+
+        return true;
+    };
+
+    auto to_label = [&](label target) {
+        auto pos = label_index.find(target);
+        return pos == label_index.end() ? instructions.size() : pos->second;
+    };
+
+    auto entry = initial_frame(clazz, method);
+    result.max_locals = entry.locals.size();
+    if (!instructions.empty() && !flow(0, entry))
+        return std::nullopt;
+
+    while (!worklist.empty()) {
+        auto index = worklist.back();
+        worklist.pop_back();
+        queued[index] = false;
+
+        auto& insn = instructions[index];
+        frame state = *result.frames[index];
+        frame before = state;
+
+        interpreter machine(clazz, state, new_sites);
+
+        bool ok;
+        if (insn.is_label()) {
+            ok = true;
+        } else if (insn.opcode == op::NEW) {
+            // the label in front is guaranteed by code::encode
+            if (index == 0 || !instructions[index - 1].is_label())
+                return std::nullopt;
+
+            machine.allocate(instructions[index - 1].operand);
+            ok = true;
+        } else {
+            ok = machine.execute(insn);
+        }
+
+        if (!ok) {
+            std::cerr << "Can't simulate opcode " << insn.opcode << " in " << clazz.name() << "." << clazz.pool.utf8(method.name_index) << std::endl;
+            return std::nullopt;
+        }
+
+        result.max_stack = std::max(result.max_stack, machine.max_stack);
+        result.max_locals = std::max(result.max_locals, machine.max_locals);
+
+        // handlers see the locals from both before and after the instruction
+        for (auto handler : covering[index]) {
+            auto catch_type = handler->catch_type != 0 ? std::string(clazz.pool.class_name(handler->catch_type)) : std::string("java/lang/Throwable");
+
+            for (auto* locals : { &before.locals, &state.locals }) {
+                frame incoming { .locals = *locals, .stack = { vtype::object(catch_type) } };
+                result.max_stack = std::max<uint16_t>(result.max_stack, 1);
+
+                if (!flow(label_index.at(handler->handler), incoming))
+                    return std::nullopt;
+            }
+        }
+
+        if (insn.is_label()) {
+            if (!flow(index + 1, state) && index + 1 < instructions.size())
+                return std::nullopt;
+            continue;
+        }
+
+        auto opcode = static_cast<uint8_t>(insn.opcode);
+
+        bool ok_flow = true;
+        if (is_branch(opcode) || opcode == op::TABLESWITCH || opcode == op::LOOKUPSWITCH) {
+            ok_flow &= flow(to_label(insn.target), state);
+            for (auto target : insn.targets)
+                ok_flow &= flow(to_label(target), state);
+        }
+
+        bool falls_through = !(opcode == op::GOTO || opcode == op::TABLESWITCH || opcode == op::LOOKUPSWITCH
+            || opcode == op::ATHROW || (opcode >= op::IRETURN && opcode <= op::RETURN));
+
+        if (falls_through)
+            ok_flow &= flow(index + 1, state);
+
+        if (!ok_flow) {
+            std::cerr << "Inconsistent stack at a merge point in " << clazz.name() << "." << clazz.pool.utf8(method.name_index) << std::endl;
+            return std::nullopt;
+        }
+    }
+
+    return result;
+}
+
+}
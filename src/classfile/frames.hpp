@@ -0,0 +1,40 @@
+#pragma once
+
+#include "classfile.hpp"
+#include "code.hpp"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Stack map frame computation and the StackMapTable codec. Frames are kept in
+// slot form internally, long/double followed by a TOP, and only compressed to
+// verification_type_info entries when written.
+namespace classfile {
+
+struct analysis {
+    // frame before each entry of code::instructions, empty if unreachable
+    std::vector<std::optional<frame>> frames;
+
+    uint16_t max_stack;
+    uint16_t max_locals;
+};
+
+std::optional<analysis> analyze(const class_file& clazz, const member& method, const code& body, const super_resolver& resolver);
+
+// one decoded StackMapTable entry, offsets still unresolved
+struct raw_frame {
+    uint32_t offset;
+    frame value;
+    // offsets of `new` instructions referenced by Uninitialized entries, by slot
+    std::vector<std::pair<uint32_t, size_t>> uninitialized_locals;
+    std::vector<std::pair<uint32_t, size_t>> uninitialized_stack;
+};
+
+std::optional<std::vector<raw_frame>> read_stack_map(const constant_pool& pool, const frame& initial, std::span<const uint8_t> data);
+
+// frames by code offset in ascending order, `offsets` maps UNINITIALIZED sites
+bool write_stack_map(writer& out, constant_pool& pool, const frame& initial, const std::vector<std::pair<uint32_t, const frame*>>& frames, const std::unordered_map<label, uint32_t>& offsets);
+
+}
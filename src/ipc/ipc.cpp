@@ -12,3 +12,11 @@ size_t ipc_pipe::read_or_close(void* buffer, size_t size) {
 
     return count;
 }
+
+size_t ipc_pipe::write_or_close(const void* buffer, size_t size) {
+    auto count = write(buffer, size);
+    if (count != size)
+        close_client();
+
+    return count;
+}
@@ -33,4 +33,8 @@ public:
 
     size_t read_or_close(void* buffer, size_t size);
 
+    size_t write(const void* buffer, size_t size);
+
+    size_t write_or_close(const void* buffer, size_t size);
+
 };
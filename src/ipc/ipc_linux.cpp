@@ -110,3 +110,19 @@ size_t ipc_pipe::read(void* buffer, size_t size) {
 
     return ::read(client, buffer, size);
 }
+
+size_t ipc_pipe::write(const void* buffer, size_t size) {
+    if (client == -1)
+        return 0;
+
+    size_t written = 0;
+    while (written < size) {
+        auto count = ::send(client, static_cast<const char*>(buffer) + written, size - written, MSG_NOSIGNAL);
+        if (count <= 0)
+            break;
+
+        written += count;
+    }
+
+    return written;
+}
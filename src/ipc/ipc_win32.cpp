@@ -64,3 +64,13 @@ size_t ipc_pipe::read(void *buffer, size_t size) {
     ReadFile(pipe_handle, buffer, size, &bytes_read, nullptr);
     return bytes_read;
 }
+
+size_t ipc_pipe::write(const void* buffer, size_t size) {
+    if (!connected) {
+        return 0;
+    }
+
+    DWORD bytes_written = 0;
+    WriteFile(pipe_handle, buffer, size, &bytes_written, nullptr);
+    return bytes_written;
+}
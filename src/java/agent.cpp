@@ -0,0 +1,141 @@
+#include "agent.hpp"
+#include "hook.hpp"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+agents::agents() : next_id(0) {}
+
+agents* agents::get() {
+    static agents instance;
+    return &instance;
+}
+
+// the agent's class knows its loader, whichever way it was loaded
+static jobject loader_of(JNIEnv* env, jobject instance) {
+    auto clazz = env->GetObjectClass(instance);
+
+    jobject loader = nullptr;
+    java::get()->ti()->GetClassLoader(clazz, &loader);
+    env->DeleteLocalRef(clazz);
+
+    if (loader == nullptr)
+        return nullptr;
+
+    auto global = env->NewGlobalRef(loader);
+    env->DeleteLocalRef(loader);
+    return global;
+}
+
+void agents::stop(JNIEnv* env, agent& entry) {
+    auto jvm = java::get();
+
+    // listeners first, so onAgentUnload can retransform classes back without them interfering
+    auto listeners = load_hook::get()->remove_loader(env, entry.loader);
+
+    jvm->stop_agent(entry.instance);
+    auto classes = jvm->forget_loader(entry.loader);
+
+    env->DeleteGlobalRef(entry.instance);
+    env->DeleteGlobalRef(entry.loader);
+
+    entry.instance = nullptr;
+    entry.loader = nullptr;
+
+    std::cerr << "Unloaded agent " << entry.id << " (" << entry.agent_class << "), "
+        << listeners << " listeners and " << classes << " classes released." << std::endl;
+}
+
+load_status agents::load(std::filesystem::path path, std::string agent_class, uint32_t& id) {
+    std::lock_guard guard(lock);
+
+    auto env = java::get()->env();
+
+    jobject instance = nullptr;
+    auto status = java::get()->load_jar(path, agent_class, instance);
+    if (status != load_status::OK)
+        return status;
+
+    id = next_id++;
+    loaded.push_back(agent {
+        .id = id,
+        .path = std::move(path),
+        .agent_class = std::move(agent_class),
+        .instance = instance,
+        .loader = loader_of(env, instance)
+    });
+
+    return load_status::OK;
+}
+
+load_status agents::unload(uint32_t id) {
+    std::lock_guard guard(lock);
+
+    auto pos = std::find_if(loaded.begin(), loaded.end(), [id](auto& entry) { return entry.id == id; });
+    if (pos == loaded.end())
+        return load_status::AGENT_NOT_FOUND;
+
+    stop(java::get()->env(), *pos);
+    loaded.erase(pos);
+
+    return load_status::OK;
+}
+
+load_status agents::reload(uint32_t id, std::filesystem::path path) {
+    std::lock_guard guard(lock);
+
+    auto pos = std::find_if(loaded.begin(), loaded.end(), [id](auto& entry) { return entry.id == id; });
+    if (pos == loaded.end())
+        return load_status::AGENT_NOT_FOUND;
+
+    auto jvm = java::get();
+    auto env = jvm->env();
+
+    if (path.empty())
+        path = pos->path;
+
+    // the slow part, reading and defining the new jar, happens while the old agent still runs
+    auto loader = jvm->define_jar(path);
+
+    stop(env, *pos);
+
+    // the new classes were prepared while the old ones still held their names in the index
+    if (loader != nullptr)
+        jvm->index_loader(loader);
+
+    jobject instance = nullptr;
+    auto status = loader != nullptr
+        ? jvm->start_agent(loader, pos->agent_class, instance)
+        : jvm->load_jar(path, pos->agent_class, instance);
+
+    // the old version is gone already, there's nothing left to keep under this id.
+    // whatever the new one registered before failing goes with it
+    if (status != load_status::OK && loader != nullptr) {
+        load_hook::get()->remove_loader(env, loader);
+        jvm->forget_loader(loader);
+    }
+
+    if (loader != nullptr)
+        env->DeleteGlobalRef(loader);
+
+    if (status != load_status::OK) {
+        loaded.erase(pos);
+        return status;
+    }
+
+    pos->path = std::move(path);
+    pos->instance = instance;
+    pos->loader = loader_of(env, instance);
+
+    return load_status::OK;
+}
+
+std::string agents::list() {
+    std::lock_guard guard(lock);
+
+    std::stringstream stream;
+    for (auto& entry : loaded)
+        stream << entry.id << '\t' << entry.agent_class << '\t' << entry.path.string() << '\n';
+
+    return stream.str();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "java.hpp"
+#include "jni.h"
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct agent {
+    uint32_t id;
+
+    std::filesystem::path path;
+    std::string agent_class;
+
+    // global refs, the instance onAgentLoad ran on and the loader its class came from
+    jobject instance;
+    jobject loader;
+};
+
+// Agents loaded over IPC, by id. Unloading takes the agent's listeners out of
+// the load hook, lets it clean up in onAgentUnload and drops every ref this
+// library holds into its loader, so the loader and its classes can be
+// collected. Reloading defines the new jar before the old agent stops, so the
+// only gap without instrumentation is the new agent's own onAgentLoad.
+class agents {
+
+    std::vector<agent> loaded;
+    std::mutex lock;
+
+    uint32_t next_id;
+
+    agents();
+
+    void stop(JNIEnv* env, agent& entry);
+
+public:
+
+    static agents* get();
+
+    load_status load(std::filesystem::path path, std::string agent_class, uint32_t& id);
+
+    load_status unload(uint32_t id);
+
+    // same id, new instance and loader. an empty path reloads the jar it was loaded from
+    load_status reload(uint32_t id, std::filesystem::path path);
+
+    // "id\tagent class\tpath" per agent
+    std::string list();
+
+};
@@ -0,0 +1,356 @@
+#include "cache.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr char MAGIC[8] = { 'G', 'O', 'O', 'B', 'T', 'C', '0', '1' };
+
+static constexpr uint32_t UNCHANGED_LENGTH = UINT32_MAX;
+
+static constexpr size_t HEADER_SIZE = 64;
+static constexpr size_t PROBE_LENGTH = 4;
+
+// far more than any set of transformed classes needs, and small enough that sizing the index can't overflow
+static constexpr uint64_t MAX_SIZE = 64ull << 30;
+
+struct cache_header {
+    char magic[8];
+    uint64_t size;
+    uint64_t bucket_count;
+    // bytes in the data ring
+    uint64_t capacity;
+    // logical end of the ring. only ever grows, the physical offset is this modulo capacity
+    uint64_t written;
+};
+
+struct cache_entry {
+    uint64_t input_hash;
+    uint64_t stage;
+    // checked on every hit, a crash halfway through a store just reads as a miss
+    uint64_t output_hash;
+    // logical offset of the output in the ring
+    uint64_t position;
+    // 0 marks an empty slot, class files are never empty
+    uint32_t input_length;
+    uint32_t length;
+};
+
+static_assert(sizeof(cache_header) <= HEADER_SIZE);
+
+static uint64_t mix(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+uint64_t hash_bytes(std::span<const uint8_t> bytes, uint64_t seed) {
+    auto hash = seed ^ (bytes.size() * 0x9e3779b97f4a7c15ull);
+
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t word;
+        memcpy(&word, bytes.data() + i, sizeof(word));
+        hash = mix(hash ^ word);
+    }
+
+    uint64_t tail = 0;
+    if (i < bytes.size())
+        memcpy(&tail, bytes.data() + i, bytes.size() - i);
+
+    return mix(hash ^ tail);
+}
+
+#ifdef _WIN32
+transform_cache::transform_cache() : file(INVALID_HANDLE_VALUE), mapping(nullptr), base(nullptr), size(0), header(nullptr), entries(nullptr), data(nullptr), opened(false) {}
+#else
+transform_cache::transform_cache() : fd(-1), base(nullptr), size(0), header(nullptr), entries(nullptr), data(nullptr), opened(false) {}
+#endif
+
+transform_cache::~transform_cache() {
+    close();
+}
+
+transform_cache* transform_cache::get() {
+    static transform_cache instance;
+    return &instance;
+}
+
+void transform_cache::unmap() {
+    opened = false;
+
+#ifdef _WIN32
+    if (base != nullptr)
+        UnmapViewOfFile(base);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (base != nullptr)
+        munmap(base, size);
+    if (fd != -1)
+        ::close(fd);
+
+    fd = -1;
+#endif
+
+    base = nullptr;
+    header = nullptr;
+    entries = nullptr;
+    data = nullptr;
+    size = 0;
+}
+
+cache_status transform_cache::open(std::filesystem::path path, uint64_t requested) {
+    std::lock_guard guard(lock);
+
+    unmap();
+
+    // the size comes straight from the client
+    if (requested > MAX_SIZE)
+        return cache_status::TOO_LARGE;
+
+    // one index slot per ~8k of data, which is a few average classes
+    uint64_t bucket_count = 256;
+    while (bucket_count * 8192 < requested)
+        bucket_count *= 2;
+
+    auto index_size = bucket_count * sizeof(cache_entry);
+    if (requested < HEADER_SIZE + index_size + 64 * 1024)
+        return cache_status::TOO_SMALL;
+
+#ifdef _WIN32
+    // no sharing, a second process gets ERROR_SHARING_VIOLATION instead of a corrupted cache
+    file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        auto error = GetLastError();
+        std::cerr << "Failed to open transform cache " << path << ": " << error << std::endl;
+        return error == ERROR_SHARING_VIOLATION ? cache_status::LOCKED : cache_status::OPEN_FAILED;
+    }
+
+    LARGE_INTEGER current;
+    if (!GetFileSizeEx(file, &current) || static_cast<uint64_t>(current.QuadPart) != requested) {
+        LARGE_INTEGER length;
+        length.QuadPart = requested;
+        if (!SetFilePointerEx(file, length, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+            std::cerr << "Failed to resize transform cache " << path << ": " << GetLastError() << std::endl;
+            unmap();
+            return cache_status::OPEN_FAILED;
+        }
+    }
+
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(requested >> 32), static_cast<DWORD>(requested), nullptr);
+    base = mapping != nullptr ? static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, requested)) : nullptr;
+    if (base == nullptr) {
+        std::cerr << "Failed to map transform cache " << path << ": " << GetLastError() << std::endl;
+        unmap();
+        return cache_status::OPEN_FAILED;
+    }
+#else
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        std::cerr << "Failed to open transform cache " << path << ": " << strerror(errno) << std::endl;
+        return cache_status::OPEN_FAILED;
+    }
+
+    // the ring has no notion of other writers, so only one process gets to use it
+    if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+        unmap();
+        return cache_status::LOCKED;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || static_cast<uint64_t>(info.st_size) != requested) {
+        if (ftruncate(fd, requested) == -1) {
+            std::cerr << "Failed to resize transform cache " << path << ": " << strerror(errno) << std::endl;
+            unmap();
+            return cache_status::OPEN_FAILED;
+        }
+    }
+
+    auto address = mmap(nullptr, requested, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        std::cerr << "Failed to map transform cache " << path << ": " << strerror(errno) << std::endl;
+        unmap();
+        return cache_status::OPEN_FAILED;
+    }
+
+    base = static_cast<uint8_t*>(address);
+#endif
+
+    size = requested;
+    header = reinterpret_cast<cache_header*>(base);
+    entries = reinterpret_cast<cache_entry*>(base + HEADER_SIZE);
+    data = base + HEADER_SIZE + index_size;
+
+    auto capacity = requested - HEADER_SIZE - index_size;
+    bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0
+        && header->size == requested
+        && header->bucket_count == bucket_count
+        && header->capacity == capacity;
+
+    if (!valid) {
+        memset(base, 0, HEADER_SIZE + index_size);
+
+        memcpy(header->magic, MAGIC, sizeof(MAGIC));
+        header->size = requested;
+        header->bucket_count = bucket_count;
+        header->capacity = capacity;
+        header->written = 0;
+    }
+
+    opened = true;
+    return cache_status::OK;
+}
+
+void transform_cache::close() {
+    std::lock_guard guard(lock);
+    unmap();
+}
+
+bool transform_cache::is_open() {
+    return opened;
+}
+
+static size_t bucket_of(uint64_t input_hash, uint64_t stage, uint64_t bucket_count) {
+    return mix(input_hash ^ (stage * 0x9e3779b97f4a7c15ull)) & (bucket_count - 1);
+}
+
+cache_entry* transform_cache::find(uint64_t input_hash, uint32_t input_length, uint64_t stage) {
+    auto bucket = bucket_of(input_hash, stage, header->bucket_count);
+
+    for (size_t i = 0; i < PROBE_LENGTH; i++) {
+        auto entry = &entries[(bucket + i) & (header->bucket_count - 1)];
+        if (entry->input_length == input_length && entry->input_hash == input_hash && entry->stage == stage)
+            return entry;
+    }
+
+    return nullptr;
+}
+
+cache_result transform_cache::lookup(jvmtiEnv* ti, uint64_t input_hash, uint32_t input_length, uint64_t stage, unsigned char** output, jint* output_length) {
+    std::lock_guard guard(lock);
+
+    if (!opened)
+        return cache_result::MISS;
+
+    auto entry = find(input_hash, input_length, stage);
+    if (entry == nullptr)
+        return cache_result::MISS;
+
+    if (entry->length == UNCHANGED_LENGTH)
+        return cache_result::UNCHANGED;
+
+    // lapped by the ring since it was written
+    if (header->written > entry->position + header->capacity) {
+        entry->input_length = 0;
+        return cache_result::MISS;
+    }
+
+    auto bytes = std::span<const uint8_t>(data + entry->position % header->capacity, entry->length);
+    if (hash_bytes(bytes) != entry->output_hash) {
+        entry->input_length = 0;
+        return cache_result::MISS;
+    }
+
+    unsigned char* buf;
+    if (ti->Allocate(bytes.size(), &buf) != JVMTI_ERROR_NONE)
+        return cache_result::MISS;
+
+    memcpy(buf, bytes.data(), bytes.size());
+    *output = buf;
+    *output_length = bytes.size();
+
+    return cache_result::HIT;
+}
+
+void transform_cache::store(uint64_t input_hash, uint32_t input_length, uint64_t stage, std::span<const uint8_t> output, bool unchanged) {
+    std::lock_guard guard(lock);
+
+    // big outputs would evict a large part of the ring at once
+    if (!opened || output.size() > header->capacity / 4)
+        return;
+
+    auto entry = find(input_hash, input_length, stage);
+    if (entry == nullptr) {
+        // otherwise whichever slot was written longest ago
+        auto bucket = bucket_of(input_hash, stage, header->bucket_count);
+        for (size_t i = 0; i < PROBE_LENGTH; i++) {
+            auto candidate = &entries[(bucket + i) & (header->bucket_count - 1)];
+            if (candidate->input_length == 0) {
+                entry = candidate;
+                break;
+            }
+
+            if (entry == nullptr || candidate->position < entry->position)
+                entry = candidate;
+        }
+    }
+
+    // invalid until the data is in place
+    entry->input_length = 0;
+
+    uint64_t position = header->written;
+    if (!unchanged) {
+        // outputs never straddle the end of the ring, the tail is skipped instead
+        auto offset = position % header->capacity;
+        if (offset + output.size() > header->capacity)
+            position += header->capacity - offset;
+
+        memcpy(data + position % header->capacity, output.data(), output.size());
+        header->written = (position + output.size() + 7) & ~uint64_t(7);
+    }
+
+    entry->input_hash = input_hash;
+    entry->stage = stage;
+    entry->output_hash = unchanged ? 0 : hash_bytes(output);
+    entry->position = position;
+    entry->length = unchanged ? UNCHANGED_LENGTH : output.size();
+    entry->input_length = input_length;
+}
+
+void transform_cache::store(uint64_t input_hash, uint32_t input_length, uint64_t stage, std::span<const uint8_t> output) {
+    store(input_hash, input_length, stage, output, false);
+}
+
+void transform_cache::store_unchanged(uint64_t input_hash, uint32_t input_length, uint64_t stage) {
+    store(input_hash, input_length, stage, {}, true);
+}
+
+std::ostream& operator<<(std::ostream& stream, cache_status status) {
+
+    switch (status) {
+    case cache_status::OK:
+        stream << "OK";
+        break;
+    case cache_status::OPEN_FAILED:
+        stream << "Open failed";
+        break;
+    case cache_status::LOCKED:
+        stream << "Locked by another process";
+        break;
+    case cache_status::TOO_SMALL:
+        stream << "Too small";
+        break;
+    case cache_status::TOO_LARGE:
+        stream << "Too large";
+        break;
+    }
+
+    return stream;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "jni.h"
+#include "jvmti.h"
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <span>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+enum class cache_status : uint8_t {
+    OK = 0,
+    OPEN_FAILED,
+    // another process has the file open
+    LOCKED,
+    TOO_SMALL,
+    // above MAX_SIZE
+    TOO_LARGE
+};
+
+std::ostream& operator<<(std::ostream& stream, cache_status status);
+
+enum class cache_result : uint8_t {
+    MISS = 0,
+    // the stage passed this input through as-is
+    UNCHANGED,
+    // output copied into a fresh JVMTI allocation
+    HIT
+};
+
+struct cache_header;
+struct cache_entry;
+
+uint64_t hash_bytes(std::span<const uint8_t> bytes, uint64_t seed = 0);
+
+// On-disk cache of listener output, keyed by the hash of the stage's input
+// and the listener's cache key. The file is a fixed-size mapping: a header, an
+// open-addressed index and a data ring that is written front to back and
+// wraps around, so the oldest outputs get evicted first and the file never
+// grows past the size it was opened with.
+class transform_cache {
+
+    std::mutex lock;
+
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+
+    uint8_t* base;
+    size_t size;
+
+    cache_header* header;
+    cache_entry* entries;
+    uint8_t* data;
+
+    // checked by the hook without taking the lock, so closed caches cost nothing
+    std::atomic<bool> opened;
+
+    transform_cache();
+
+    cache_entry* find(uint64_t input_hash, uint32_t input_length, uint64_t stage);
+    void store(uint64_t input_hash, uint32_t input_length, uint64_t stage, std::span<const uint8_t> output, bool unchanged);
+
+    void unmap();
+
+public:
+
+    static transform_cache* get();
+    ~transform_cache();
+
+    // existing files with a different size or layout start over empty
+    cache_status open(std::filesystem::path path, uint64_t size);
+    void close();
+
+    bool is_open();
+
+    cache_result lookup(jvmtiEnv* ti, uint64_t input_hash, uint32_t input_length, uint64_t stage, unsigned char** output, jint* output_length);
+
+    void store(uint64_t input_hash, uint32_t input_length, uint64_t stage, std::span<const uint8_t> output);
+    void store_unchanged(uint64_t input_hash, uint32_t input_length, uint64_t stage);
+
+};
@@ -0,0 +1,335 @@
+#include "codec.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace codec {
+
+static bool read_length(std::span<const uint8_t> input, size_t& pos, size_t& length) {
+    uint8_t next;
+    do {
+        if (pos >= input.size())
+            return false;
+
+        next = input[pos++];
+        length += next;
+    } while (next == 255);
+
+    return true;
+}
+
+bool decompress(std::span<const uint8_t> input, std::span<uint8_t> output) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < input.size()) {
+        auto token = input[in++];
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_length(input, in, literals))
+            return false;
+
+        if (literals > input.size() - in || literals > output.size() - out)
+            return false;
+
+        if (literals != 0)
+            memcpy(output.data() + out, input.data() + in, literals);
+        in += literals;
+        out += literals;
+
+        // the last sequence ends right after its literals
+        if (in == input.size())
+            break;
+
+        if (input.size() - in < 2)
+            return false;
+
+        size_t offset = input[in] | input[in + 1] << 8;
+        in += 2;
+
+        size_t length = (token & 0x0f) + 4;
+        if ((token & 0x0f) == 15 && !read_length(input, in, length))
+            return false;
+
+        if (offset == 0 || offset > out || length > output.size() - out)
+            return false;
+
+        // byte by byte, matches may overlap what they're copying
+        for (size_t i = 0; i < length; i++, out++)
+            output[out] = output[out - offset];
+    }
+
+    return out == output.size();
+}
+
+struct bit_reader {
+    std::span<const uint8_t> input;
+    size_t pos = 0;
+
+    uint32_t buffer = 0;
+    int count = 0;
+
+    // reading past the end yields zeroes and sets this, checked once per block
+    bool overrun = false;
+
+    uint32_t bits(int need) {
+        while (count < need) {
+            uint32_t next = 0;
+            if (pos < input.size())
+                next = input[pos++];
+            else
+                overrun = true;
+
+            buffer |= next << count;
+            count += 8;
+        }
+
+        auto value = buffer & ((1u << need) - 1);
+        buffer >>= need;
+        count -= need;
+        return value;
+    }
+};
+
+static constexpr int MAX_BITS = 15;
+
+// canonical huffman code, as counts per length and symbols in code order
+struct huffman {
+    uint16_t count[MAX_BITS + 1];
+    uint16_t symbol[288];
+};
+
+// false for over-subscribed codes, incomplete ones are allowed (a single distance code is valid)
+static bool build(huffman& code, const uint8_t* lengths, int n) {
+    memset(code.count, 0, sizeof(code.count));
+    for (int i = 0; i < n; i++)
+        code.count[lengths[i]]++;
+
+    int left = 1;
+    for (int length = 1; length <= MAX_BITS; length++) {
+        left <<= 1;
+        left -= code.count[length];
+        if (left < 0)
+            return false;
+    }
+
+    uint16_t offsets[MAX_BITS + 1];
+    offsets[1] = 0;
+    for (int length = 1; length < MAX_BITS; length++)
+        offsets[length + 1] = offsets[length] + code.count[length];
+
+    for (int i = 0; i < n; i++) {
+        if (lengths[i] != 0)
+            code.symbol[offsets[lengths[i]]++] = i;
+    }
+
+    return true;
+}
+
+// a bit at a time, agent jars are small enough that table lookups wouldn't pay off
+static int decode(bit_reader& reader, const huffman& code) {
+    int value = 0;
+    int first = 0;
+    int index = 0;
+
+    for (int length = 1; length <= MAX_BITS; length++) {
+        value |= reader.bits(1);
+
+        int count = code.count[length];
+        if (value - count < first)
+            return code.symbol[index + (value - first)];
+
+        index += count;
+        first += count;
+        first <<= 1;
+        value <<= 1;
+
+        if (reader.overrun)
+            return -1;
+    }
+
+    return -1;
+}
+
+static constexpr uint16_t LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static constexpr uint8_t LENGTH_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static constexpr uint16_t DISTANCE_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static constexpr uint8_t DISTANCE_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static bool inflate_codes(bit_reader& reader, const huffman& lengths, const huffman& distances, std::span<uint8_t> output, size_t& out) {
+    while (true) {
+        auto symbol = decode(reader, lengths);
+        if (symbol < 0)
+            return false;
+
+        if (symbol < 256) {
+            if (out >= output.size())
+                return false;
+
+            output[out++] = symbol;
+            continue;
+        }
+
+        if (symbol == 256)
+            return true;
+
+        symbol -= 257;
+        if (symbol >= 29)
+            return false;
+
+        size_t length = LENGTH_BASE[symbol] + reader.bits(LENGTH_EXTRA[symbol]);
+
+        auto distance_symbol = decode(reader, distances);
+        if (distance_symbol < 0 || distance_symbol >= 30)
+            return false;
+
+        size_t distance = DISTANCE_BASE[distance_symbol] + reader.bits(DISTANCE_EXTRA[distance_symbol]);
+        if (distance > out || length > output.size() - out)
+            return false;
+
+        for (size_t i = 0; i < length; i++, out++)
+            output[out] = output[out - distance];
+    }
+}
+
+static bool inflate_stored(bit_reader& reader, std::span<uint8_t> output, size_t& out) {
+    // stored blocks start on a byte boundary, whatever is left in the buffer is padding
+    reader.buffer = 0;
+    reader.count = 0;
+
+    auto& input = reader.input;
+    if (input.size() - reader.pos < 4)
+        return false;
+
+    size_t length = input[reader.pos] | input[reader.pos + 1] << 8;
+    size_t complement = input[reader.pos + 2] | input[reader.pos + 3] << 8;
+    reader.pos += 4;
+
+    if (length != (~complement & 0xffff))
+        return false;
+
+    if (length > input.size() - reader.pos || length > output.size() - out)
+        return false;
+
+    if (length != 0)
+        memcpy(output.data() + out, input.data() + reader.pos, length);
+    reader.pos += length;
+    out += length;
+    return true;
+}
+
+static bool inflate_fixed(bit_reader& reader, std::span<uint8_t> output, size_t& out) {
+    static huffman lengths;
+    static huffman distances;
+
+    static bool built = [] {
+        uint8_t code_lengths[288];
+        std::fill_n(code_lengths, 144, 8);
+        std::fill_n(code_lengths + 144, 112, 9);
+        std::fill_n(code_lengths + 256, 24, 7);
+        std::fill_n(code_lengths + 280, 8, 8);
+        build(lengths, code_lengths, 288);
+
+        std::fill_n(code_lengths, 30, 5);
+        build(distances, code_lengths, 30);
+        return true;
+    }();
+
+    return built && inflate_codes(reader, lengths, distances, output, out);
+}
+
+static bool inflate_dynamic(bit_reader& reader, std::span<uint8_t> output, size_t& out) {
+    static constexpr uint8_t ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    int length_count = reader.bits(5) + 257;
+    int distance_count = reader.bits(5) + 1;
+    int code_count = reader.bits(4) + 4;
+
+    if (length_count > 286 || distance_count > 30)
+        return false;
+
+    uint8_t code_lengths[288 + 30] = {};
+    for (int i = 0; i < code_count; i++)
+        code_lengths[ORDER[i]] = reader.bits(3);
+
+    huffman code_length_code;
+    if (!build(code_length_code, code_lengths, 19))
+        return false;
+
+    memset(code_lengths, 0, sizeof(code_lengths));
+
+    for (int i = 0; i < length_count + distance_count;) {
+        auto symbol = decode(reader, code_length_code);
+        if (symbol < 0)
+            return false;
+
+        if (symbol < 16) {
+            code_lengths[i++] = symbol;
+            continue;
+        }
+
+        uint8_t repeated = 0;
+        int times;
+        if (symbol == 16) {
+            if (i == 0)
+                return false;
+
+            repeated = code_lengths[i - 1];
+            times = 3 + reader.bits(2);
+        } else if (symbol == 17) {
+            times = 3 + reader.bits(3);
+        } else {
+            times = 11 + reader.bits(7);
+        }
+
+        if (i + times > length_count + distance_count)
+            return false;
+
+        while (times--)
+            code_lengths[i++] = repeated;
+    }
+
+    // without an end of block code nothing could ever stop
+    if (code_lengths[256] == 0)
+        return false;
+
+    huffman lengths;
+    huffman distances;
+    if (!build(lengths, code_lengths, length_count) || !build(distances, code_lengths + length_count, distance_count))
+        return false;
+
+    return inflate_codes(reader, lengths, distances, output, out);
+}
+
+bool inflate(std::span<const uint8_t> input, std::span<uint8_t> output) {
+    bit_reader reader { .input = input };
+    size_t out = 0;
+
+    bool last;
+    do {
+        last = reader.bits(1);
+        auto type = reader.bits(2);
+
+        bool ok;
+        switch (type) {
+        case 0:
+            ok = inflate_stored(reader, output, out);
+            break;
+        case 1:
+            ok = inflate_fixed(reader, output, out);
+            break;
+        case 2:
+            ok = inflate_dynamic(reader, output, out);
+            break;
+        default:
+            ok = false;
+            break;
+        }
+
+        if (!ok || reader.overrun)
+            return false;
+    } while (!last);
+
+    return out == output.size();
+}
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+// Decoders for class file payloads. Both return false on malformed input or
+// if it doesn't decode to exactly output.size() bytes.
+namespace codec {
+
+// the LZ4 style blocks java_tool.py stores the embedded classes in. each
+// sequence is a token (literal count in the high nibble, match length minus 4
+// in the low one, 15 meaning more length bytes follow), the literals and a
+// little endian u16 offset back into the output. the last sequence has no match
+bool decompress(std::span<const uint8_t> input, std::span<uint8_t> output);
+
+// raw DEFLATE (RFC 1951) as used by zip entries
+bool inflate(std::span<const uint8_t> input, std::span<uint8_t> output);
+
+}
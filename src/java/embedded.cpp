@@ -1,83 +0,0 @@
-// Auto-generated C++ embedded Java classes
-#include <cstdint> 
-#include <vector>
-
-namespace embedded {
-
-struct method_info {
-    const char* name;
-    const char* desc;
-    uint16_t access;
-};
-
-struct class_info {
-    const char* name;
-    std::vector<unsigned char> bytes;
-    std::vector<method_info> methods;
-};
-
-std::vector<class_info> classes = {
-    class_info {
-        // Auto-generated from build/java/cat/psychward/goober/Utility.class
-        // Class: cat.psychward.goober.Utility
-        .name = "cat/psychward/goober/Utility",
-        .bytes = { 0xca, 0xfe, 0xba, 0xbe, 0x00, 0x00, 0x00, 0x34, 0x00, 0x86, 0x0a, 0x00, 0x02, 0x00, 0x03, 0x07, 0x00, 0x04, 0x0c, 0x00, 0x05, 0x00, 0x06, 0x01, 0x00, 0x10, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x01, 0x00, 0x06, 0x3c, 0x69, 0x6e, 0x69, 0x74, 0x3e, 0x01, 0x00, 0x03, 0x28, 0x29, 0x56, 0x07, 0x00, 0x08, 0x01, 0x00, 0x0c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x69, 0x6f, 0x2f, 0x46, 0x69, 0x6c, 0x65, 0x0a, 0x00, 0x07, 0x00, 0x0a, 0x0c, 0x00, 0x05, 0x00, 0x0b, 0x01, 0x00, 0x15, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x29, 0x56, 0x0a, 0x00, 0x07, 0x00, 0x0d, 0x0c, 0x00, 0x0e, 0x00, 0x0f, 0x01, 0x00, 0x06, 0x65, 0x78, 0x69, 0x73, 0x74, 0x73, 0x01, 0x00, 0x03, 0x28, 0x29, 0x5a, 0x07, 0x00, 0x11, 0x01, 0x00, 0x1d, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x69, 0x6f, 0x2f, 0x46, 0x69, 0x6c, 0x65, 0x4e, 0x6f, 0x74, 0x46, 0x6f, 0x75, 0x6e, 0x64, 0x45, 0x78, 0x63, 0x65, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x07, 0x00, 0x13, 0x01, 0x00, 0x17, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x42, 0x75, 0x69, 0x6c, 0x64, 0x65, 0x72, 0x0a, 0x00, 0x12, 0x00, 0x03, 0x08, 0x00, 0x16, 0x01, 0x00, 0x05, 0x50, 0x61, 0x74, 0x68, 0x20, 0x0a, 0x00, 0x12, 0x00, 0x18, 0x0c, 0x00, 0x19, 0x00, 0x1a, 0x01, 0x00, 0x06, 0x61, 0x70, 0x70, 0x65, 0x6e, 0x64, 0x01, 0x00, 0x2d, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x29, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x42, 0x75, 0x69, 0x6c, 0x64, 0x65, 0x72, 0x3b, 0x08, 0x00, 0x1c, 0x01, 0x00, 0x10, 0x20, 0x64, 0x6f, 0x65, 0x73, 0x20, 0x6e, 0x6f, 0x74, 0x20, 0x65, 0x78, 0x69, 0x73, 0x74, 0x21, 0x0a, 0x00, 0x12, 0x00, 0x1e, 0x0c, 0x00, 0x1f, 0x00, 0x20, 0x01, 0x00, 0x08, 0x74, 0x6f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x01, 0x00, 0x14, 0x28, 0x29, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x0a, 0x00, 0x10, 0x00, 0x0a, 0x07, 0x00, 0x23, 0x01, 0x00, 0x17, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6e, 0x65, 0x74, 0x2f, 0x55, 0x52, 0x4c, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x4c, 0x6f, 0x61, 0x64, 0x65, 0x72, 0x07, 0x00, 0x25, 0x01, 0x00, 0x0c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6e, 0x65, 0x74, 0x2f, 0x55, 0x52, 0x4c, 0x0a, 0x00, 0x07, 0x00, 0x27, 0x0c, 0x00, 0x28, 0x00, 0x29, 0x01, 0x00, 0x05, 0x74, 0x6f, 0x55, 0x52, 0x49, 0x01, 0x00, 0x10, 0x28, 0x29, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6e, 0x65, 0x74, 0x2f, 0x55, 0x52, 0x49, 0x3b, 0x0a, 0x00, 0x2b, 0x00, 0x2c, 0x07, 0x00, 0x2d, 0x0c, 0x00, 0x2e, 0x00, 0x2f, 0x01, 0x00, 0x0c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6e, 0x65, 0x74, 0x2f, 0x55, 0x52, 0x49, 0x01, 0x00, 0x05, 0x74, 0x6f, 0x55, 0x52, 0x4c, 0x01, 0x00, 0x10, 0x28, 0x29, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6e, 0x65, 0x74, 0x2f, 0x55, 0x52, 0x4c, 0x3b, 0x0a, 0x00, 0x22, 0x00, 0x31, 0x0c, 0x00, 0x05, 0x00, 0x32, 0x01, 0x00, 0x12, 0x28, 0x5b, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6e, 0x65, 0x74, 0x2f, 0x55, 0x52, 0x4c, 0x3b, 0x29, 0x56, 0x0a, 0x00, 0x22, 0x00, 0x34, 0x0c, 0x00, 0x35, 0x00, 0x36, 0x01, 0x00, 0x09, 0x6c, 0x6f, 0x61, 0x64, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x01, 0x00, 0x25, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x29, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x3b, 0x08, 0x00, 0x38, 0x01, 0x00, 0x0b, 0x6f, 0x6e, 0x41, 0x67, 0x65, 0x6e, 0x74, 0x4c, 0x6f, 0x61, 0x64, 0x07, 0x00, 0x3a, 0x01, 0x00, 0x0f, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x0a, 0x00, 0x39, 0x00, 0x3c, 0x0c, 0x00, 0x3d, 0x00, 0x3e, 0x01, 0x00, 0x11, 0x67, 0x65, 0x74, 0x44, 0x65, 0x63, 0x6c, 0x61, 0x72, 0x65, 0x64, 0x4d, 0x65, 0x74, 0x68, 0x6f, 0x64, 0x01, 0x00, 0x40, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x5b, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x3b, 0x29, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x72, 0x65, 0x66, 0x6c, 0x65, 0x63, 0x74, 0x2f, 0x4d, 0x65, 0x74, 0x68, 0x6f, 0x64, 0x3b, 0x0a, 0x00, 0x39, 0x00, 0x40, 0x0c, 0x00, 0x41, 0x00, 0x42, 0x01, 0x00, 0x16, 0x67, 0x65, 0x74, 0x44, 0x65, 0x63, 0x6c, 0x61, 0x72, 0x65, 0x64, 0x43, 0x6f, 0x6e, 0x73, 0x74, 0x72, 0x75, 0x63, 0x74, 0x6f, 0x72, 0x01, 0x00, 0x33, 0x28, 0x5b, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x3b, 0x29, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x72, 0x65, 0x66, 0x6c, 0x65, 0x63, 0x74, 0x2f, 0x43, 0x6f, 0x6e, 0x73, 0x74, 0x72, 0x75, 0x63, 0x74, 0x6f, 0x72, 0x3b, 0x0a, 0x00, 0x44, 0x00, 0x45, 0x07, 0x00, 0x46, 0x0c, 0x00, 0x47, 0x00, 0x48, 0x01, 0x00, 0x1d, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x72, 0x65, 0x66, 0x6c, 0x65, 0x63, 0x74, 0x2f, 0x43, 0x6f, 0x6e, 0x73, 0x74, 0x72, 0x75, 0x63, 0x74, 0x6f, 0x72, 0x01, 0x00, 0x0d, 0x73, 0x65, 0x74, 0x41, 0x63, 0x63, 0x65, 0x73, 0x73, 0x69, 0x62, 0x6c, 0x65, 0x01, 0x00, 0x04, 0x28, 0x5a, 0x29, 0x56, 0x0a, 0x00, 0x44, 0x00, 0x4a, 0x0c, 0x00, 0x4b, 0x00, 0x4c, 0x01, 0x00, 0x0b, 0x6e, 0x65, 0x77, 0x49, 0x6e, 0x73, 0x74, 0x61, 0x6e, 0x63, 0x65, 0x01, 0x00, 0x27, 0x28, 0x5b, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x3b, 0x29, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x3b, 0x0a, 0x00, 0x4e, 0x00, 0x4f, 0x07, 0x00, 0x50, 0x0c, 0x00, 0x51, 0x00, 0x52, 0x01, 0x00, 0x18, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x72, 0x65, 0x66, 0x6c, 0x65, 0x63, 0x74, 0x2f, 0x4d, 0x65, 0x74, 0x68, 0x6f, 0x64, 0x01, 0x00, 0x06, 0x69, 0x6e, 0x76, 0x6f, 0x6b, 0x65, 0x01, 0x00, 0x39, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x3b, 0x5b, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x3b, 0x29, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x3b, 0x0a, 0x00, 0x22, 0x00, 0x54, 0x0c, 0x00, 0x55, 0x00, 0x06, 0x01, 0x00, 0x05, 0x63, 0x6c, 0x6f, 0x73, 0x65, 0x07, 0x00, 0x57, 0x01, 0x00, 0x13, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x54, 0x68, 0x72, 0x6f, 0x77, 0x61, 0x62, 0x6c, 0x65, 0x0a, 0x00, 0x56, 0x00, 0x59, 0x0c, 0x00, 0x5a, 0x00, 0x5b, 0x01, 0x00, 0x0d, 0x61, 0x64, 0x64, 0x53, 0x75, 0x70, 0x70, 0x72, 0x65, 0x73, 0x73, 0x65, 0x64, 0x01, 0x00, 0x18, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x54, 0x68, 0x72, 0x6f, 0x77, 0x61, 0x62, 0x6c, 0x65, 0x3b, 0x29, 0x56, 0x09, 0x00, 0x5d, 0x00, 0x5e, 0x07, 0x00, 0x5f, 0x0c, 0x00, 0x60, 0x00, 0x61, 0x01, 0x00, 0x1c, 0x63, 0x61, 0x74, 0x2f, 0x70, 0x73, 0x79, 0x63, 0x68, 0x77, 0x61, 0x72, 0x64, 0x2f, 0x67, 0x6f, 0x6f, 0x62, 0x65, 0x72, 0x2f, 0x55, 0x74, 0x69, 0x6c, 0x69, 0x74, 0x79, 0x01, 0x00, 0x0d, 0x6c, 0x6f, 0x61, 0x64, 0x4c, 0x69, 0x73, 0x74, 0x65, 0x6e, 0x65, 0x72, 0x73, 0x01, 0x00, 0x10, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x75, 0x74, 0x69, 0x6c, 0x2f, 0x4c, 0x69, 0x73, 0x74, 0x3b, 0x0b, 0x00, 0x63, 0x00, 0x64, 0x07, 0x00, 0x65, 0x0c, 0x00, 0x66, 0x00, 0x67, 0x01, 0x00, 0x0e, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x75, 0x74, 0x69, 0x6c, 0x2f, 0x4c, 0x69, 0x73, 0x74, 0x01, 0x00, 0x03, 0x61, 0x64, 0x64, 0x01, 0x00, 0x15, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x3b, 0x29, 0x5a, 0x07, 0x00, 0x69, 0x01, 0x00, 0x29, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x75, 0x74, 0x69, 0x6c, 0x2f, 0x63, 0x6f, 0x6e, 0x63, 0x75, 0x72, 0x72, 0x65, 0x6e, 0x74, 0x2f, 0x43, 0x6f, 0x70, 0x79, 0x4f, 0x6e, 0x57, 0x72, 0x69, 0x74, 0x65, 0x41, 0x72, 0x72, 0x61, 0x79, 0x4c, 0x69, 0x73, 0x74, 0x0a, 0x00, 0x68, 0x00, 0x03, 0x01, 0x00, 0x09, 0x53, 0x69, 0x67, 0x6e, 0x61, 0x74, 0x75, 0x72, 0x65, 0x01, 0x00, 0x3a, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x75, 0x74, 0x69, 0x6c, 0x2f, 0x4c, 0x69, 0x73, 0x74, 0x3c, 0x4c, 0x63, 0x61, 0x74, 0x2f, 0x70, 0x73, 0x79, 0x63, 0x68, 0x77, 0x61, 0x72, 0x64, 0x2f, 0x67, 0x6f, 0x6f, 0x62, 0x65, 0x72, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x4c, 0x6f, 0x61, 0x64, 0x4c, 0x69, 0x73, 0x74, 0x65, 0x6e, 0x65, 0x72, 0x3b, 0x3e, 0x3b, 0x01, 0x00, 0x04, 0x43, 0x6f, 0x64, 0x65, 0x01, 0x00, 0x0f, 0x4c, 0x69, 0x6e, 0x65, 0x4e, 0x75, 0x6d, 0x62, 0x65, 0x72, 0x54, 0x61, 0x62, 0x6c, 0x65, 0x01, 0x00, 0x09, 0x6c, 0x6f, 0x61, 0x64, 0x41, 0x67, 0x65, 0x6e, 0x74, 0x01, 0x00, 0x27, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x29, 0x56, 0x01, 0x00, 0x0d, 0x53, 0x74, 0x61, 0x63, 0x6b, 0x4d, 0x61, 0x70, 0x54, 0x61, 0x62, 0x6c, 0x65, 0x07, 0x00, 0x73, 0x01, 0x00, 0x10, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x01, 0x00, 0x0a, 0x45, 0x78, 0x63, 0x65, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x73, 0x07, 0x00, 0x76, 0x01, 0x00, 0x13, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x69, 0x6f, 0x2f, 0x49, 0x4f, 0x45, 0x78, 0x63, 0x65, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x07, 0x00, 0x78, 0x01, 0x00, 0x26, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x52, 0x65, 0x66, 0x6c, 0x65, 0x63, 0x74, 0x69, 0x76, 0x65, 0x4f, 0x70, 0x65, 0x72, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x45, 0x78, 0x63, 0x65, 0x70, 0x74, 0x69, 0x6f, 0x6e, 0x01, 0x00, 0x0d, 0x72, 0x65, 0x64, 0x65, 0x66, 0x69, 0x6e, 0x65, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x01, 0x00, 0x17, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x5b, 0x42, 0x29, 0x49, 0x01, 0x00, 0x16, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x3b, 0x5b, 0x42, 0x29, 0x49, 0x01, 0x00, 0x19, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x3c, 0x2a, 0x3e, 0x3b, 0x5b, 0x42, 0x29, 0x49, 0x01, 0x00, 0x10, 0x72, 0x65, 0x74, 0x72, 0x61, 0x6e, 0x73, 0x66, 0x6f, 0x72, 0x6d, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x01, 0x00, 0x15, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x29, 0x49, 0x01, 0x00, 0x14, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x3b, 0x29, 0x49, 0x01, 0x00, 0x17, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x3c, 0x2a, 0x3e, 0x3b, 0x29, 0x49, 0x01, 0x00, 0x0b, 0x6f, 0x6e, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x4c, 0x6f, 0x61, 0x64, 0x01, 0x00, 0x2b, 0x28, 0x4c, 0x63, 0x61, 0x74, 0x2f, 0x70, 0x73, 0x79, 0x63, 0x68, 0x77, 0x61, 0x72, 0x64, 0x2f, 0x67, 0x6f, 0x6f, 0x62, 0x65, 0x72, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x4c, 0x6f, 0x61, 0x64, 0x4c, 0x69, 0x73, 0x74, 0x65, 0x6e, 0x65, 0x72, 0x3b, 0x29, 0x56, 0x01, 0x00, 0x08, 0x3c, 0x63, 0x6c, 0x69, 0x6e, 0x69, 0x74, 0x3e, 0x01, 0x00, 0x0a, 0x53, 0x6f, 0x75, 0x72, 0x63, 0x65, 0x46, 0x69, 0x6c, 0x65, 0x01, 0x00, 0x0c, 0x55, 0x74, 0x69, 0x6c, 0x69, 0x74, 0x79, 0x2e, 0x6a, 0x61, 0x76, 0x61, 0x00, 0x31, 0x00, 0x5d, 0x00, 0x02, 0x00, 0x00, 0x00, 0x01, 0x00, 0x1a, 0x00, 0x60, 0x00, 0x61, 0x00, 0x01, 0x00, 0x6b, 0x00, 0x00, 0x00, 0x02, 0x00, 0x6c, 0x00, 0x08, 0x00, 0x01, 0x00, 0x05, 0x00, 0x06, 0x00, 0x01, 0x00, 0x6d, 0x00, 0x00, 0x00, 0x1d, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x05, 0x2a, 0xb7, 0x00, 0x01, 0xb1, 0x00, 0x00, 0x00, 0x01, 0x00, 0x6e, 0x00, 0x00, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0f, 0x00, 0x0a, 0x00, 0x6f, 0x00, 0x70, 0x00, 0x02, 0x00, 0x6d, 0x00, 0x00, 0x01, 0x34, 0x00, 0x06, 0x00, 0x07, 0x00, 0x00, 0x00, 0x9b, 0xbb, 0x00, 0x07, 0x59, 0x2a, 0xb7, 0x00, 0x09, 0x4d, 0x2c, 0xb6, 0x00, 0x0c, 0x9a, 0x00, 0x23, 0xbb, 0x00, 0x10, 0x59, 0xbb, 0x00, 0x12, 0x59, 0xb7, 0x00, 0x14, 0x12, 0x15, 0xb6, 0x00, 0x17, 0x2a, 0xb6, 0x00, 0x17, 0x12, 0x1b, 0xb6, 0x00, 0x17, 0xb6, 0x00, 0x1d, 0xb7, 0x00, 0x21, 0xbf, 0xbb, 0x00, 0x22, 0x59, 0x04, 0xbd, 0x00, 0x24, 0x59, 0x03, 0x2c, 0xb6, 0x00, 0x26, 0xb6, 0x00, 0x2a, 0x53, 0xb7, 0x00, 0x30, 0x4e, 0x2d, 0x2b, 0xb6, 0x00, 0x33, 0x3a, 0x04, 0x19, 0x04, 0x12, 0x37, 0x03, 0xbd, 0x00, 0x39, 0xb6, 0x00, 0x3b, 0x3a, 0x05, 0x19, 0x04, 0x03, 0xbd, 0x00, 0x39, 0xb6, 0x00, 0x3f, 0x3a, 0x06, 0x19, 0x06, 0x04, 0xb6, 0x00, 0x43, 0x19, 0x05, 0x19, 0x06, 0x03, 0xbd, 0x00, 0x02, 0xb6, 0x00, 0x49, 0x03, 0xbd, 0x00, 0x02, 0xb6, 0x00, 0x4d, 0x57, 0x2d, 0xb6, 0x00, 0x53, 0xa7, 0x00, 0x18, 0x3a, 0x04, 0x2d, 0xb6, 0x00, 0x53, 0xa7, 0x00, 0x0c, 0x3a, 0x05, 0x19, 0x04, 0x19, 0x05, 0xb6, 0x00, 0x58, 0x19, 0x04, 0xbf, 0xb1, 0x00, 0x02, 0x00, 0x46, 0x00, 0x7e, 0x00, 0x85, 0x00, 0x56, 0x00, 0x87, 0x00, 0x8b, 0x00, 0x8e, 0x00, 0x56, 0x00, 0x02, 0x00, 0x6e, 0x00, 0x00, 0x00, 0x36, 0x00, 0x0d, 0x00, 0x00, 0x00, 0x15, 0x00, 0x09, 0x00, 0x17, 0x00, 0x30, 0x00, 0x1c, 0x00, 0x3b, 0x00, 0x1d, 0x00, 0x46, 0x00, 0x20, 0x00, 0x4d, 0x00, 0x21, 0x00, 0x5a, 0x00, 0x24, 0x00, 0x60, 0x00, 0x25, 0x00, 0x65, 0x00, 0x26, 0x00, 0x6b, 0x00, 0x28, 0x00, 0x7e, 0x00, 0x29, 0x00, 0x85, 0x00, 0x1b, 0x00, 0x9a, 0x00, 0x2a, 0x00, 0x71, 0x00, 0x00, 0x00, 0x3b, 0x00, 0x05, 0xfc, 0x00, 0x30, 0x07, 0x00, 0x07, 0xff, 0x00, 0x54, 0x00, 0x04, 0x07, 0x00, 0x72, 0x07, 0x00, 0x72, 0x07, 0x00, 0x07, 0x07, 0x00, 0x22, 0x00, 0x01, 0x07, 0x00, 0x56, 0xff, 0x00, 0x08, 0x00, 0x05, 0x07, 0x00, 0x72, 0x07, 0x00, 0x72, 0x07, 0x00, 0x07, 0x07, 0x00, 0x22, 0x07, 0x00, 0x56, 0x00, 0x01, 0x07, 0x00, 0x56, 0x08, 0xf9, 0x00, 0x02, 0x00, 0x74, 0x00, 0x00, 0x00, 0x06, 0x00, 0x02, 0x00, 0x75, 0x00, 0x77, 0x01, 0x09, 0x00, 0x79, 0x00, 0x7a, 0x00, 0x00, 0x01, 0x09, 0x00, 0x79, 0x00, 0x7b, 0x00, 0x01, 0x00, 0x6b, 0x00, 0x00, 0x00, 0x02, 0x00, 0x7c, 0x01, 0x09, 0x00, 0x7d, 0x00, 0x7e, 0x00, 0x00, 0x01, 0x09, 0x00, 0x7d, 0x00, 0x7f, 0x00, 0x01, 0x00, 0x6b, 0x00, 0x00, 0x00, 0x02, 0x00, 0x80, 0x00, 0x09, 0x00, 0x81, 0x00, 0x82, 0x00, 0x01, 0x00, 0x6d, 0x00, 0x00, 0x00, 0x27, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x0b, 0xb2, 0x00, 0x5c, 0x2a, 0xb9, 0x00, 0x62, 0x02, 0x00, 0x57, 0xb1, 0x00, 0x00, 0x00, 0x01, 0x00, 0x6e, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x02, 0x00, 0x00, 0x00, 0x35, 0x00, 0x0a, 0x00, 0x36, 0x00, 0x08, 0x00, 0x83, 0x00, 0x06, 0x00, 0x01, 0x00, 0x6d, 0x00, 0x00, 0x00, 0x23, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0b, 0xbb, 0x00, 0x68, 0x59, 0xb7, 0x00, 0x6a, 0xb3, 0x00, 0x5c, 0xb1, 0x00, 0x00, 0x00, 0x01, 0x00, 0x6e, 0x00, 0x00, 0x00, 0x06, 0x00, 0x01, 0x00, 0x00, 0x00, 0x11, 0x00, 0x01, 0x00, 0x84, 0x00, 0x00, 0x00, 0x02, 0x00, 0x85 },
-        .methods = {
-            method_info {
-                .name = "<init>",
-                .desc = "()V",
-                .access = 0x1,
-            },
-            method_info {
-                .name = "loadAgent",
-                .desc = "(Ljava/lang/String;Ljava/lang/String;)V",
-                .access = 0xa,
-            },
-            method_info {
-                .name = "redefineClass",
-                .desc = "(Ljava/lang/String;[B)I",
-                .access = 0x109,
-            },
-            method_info {
-                .name = "redefineClass",
-                .desc = "(Ljava/lang/Class;[B)I",
-                .access = 0x109,
-            },
-            method_info {
-                .name = "retransformClass",
-                .desc = "(Ljava/lang/String;)I",
-                .access = 0x109,
-            },
-            method_info {
-                .name = "retransformClass",
-                .desc = "(Ljava/lang/Class;)I",
-                .access = 0x109,
-            },
-            method_info {
-                .name = "onClassLoad",
-                .desc = "(Lcat/psychward/goober/ClassLoadListener;)V",
-                .access = 0x9,
-            },
-            method_info {
-                .name = "<clinit>",
-                .desc = "()V",
-                .access = 0x8,
-            },
-        }
-    },
-    class_info {
-        // Auto-generated from build/java/cat/psychward/goober/ClassLoadListener.class
-        // Class: cat.psychward.goober.ClassLoadListener
-        .name = "cat/psychward/goober/ClassLoadListener",
-        .bytes = { 0xca, 0xfe, 0xba, 0xbe, 0x00, 0x00, 0x00, 0x34, 0x00, 0x0b, 0x07, 0x00, 0x02, 0x01, 0x00, 0x26, 0x63, 0x61, 0x74, 0x2f, 0x70, 0x73, 0x79, 0x63, 0x68, 0x77, 0x61, 0x72, 0x64, 0x2f, 0x67, 0x6f, 0x6f, 0x62, 0x65, 0x72, 0x2f, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x4c, 0x6f, 0x61, 0x64, 0x4c, 0x69, 0x73, 0x74, 0x65, 0x6e, 0x65, 0x72, 0x07, 0x00, 0x04, 0x01, 0x00, 0x10, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x4f, 0x62, 0x6a, 0x65, 0x63, 0x74, 0x01, 0x00, 0x06, 0x6f, 0x6e, 0x4c, 0x6f, 0x61, 0x64, 0x01, 0x00, 0x18, 0x28, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x53, 0x74, 0x72, 0x69, 0x6e, 0x67, 0x3b, 0x5b, 0x42, 0x29, 0x5b, 0x42, 0x01, 0x00, 0x0a, 0x53, 0x6f, 0x75, 0x72, 0x63, 0x65, 0x46, 0x69, 0x6c, 0x65, 0x01, 0x00, 0x16, 0x43, 0x6c, 0x61, 0x73, 0x73, 0x4c, 0x6f, 0x61, 0x64, 0x4c, 0x69, 0x73, 0x74, 0x65, 0x6e, 0x65, 0x72, 0x2e, 0x6a, 0x61, 0x76, 0x61, 0x01, 0x00, 0x19, 0x52, 0x75, 0x6e, 0x74, 0x69, 0x6d, 0x65, 0x56, 0x69, 0x73, 0x69, 0x62, 0x6c, 0x65, 0x41, 0x6e, 0x6e, 0x6f, 0x74, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x73, 0x01, 0x00, 0x1f, 0x4c, 0x6a, 0x61, 0x76, 0x61, 0x2f, 0x6c, 0x61, 0x6e, 0x67, 0x2f, 0x46, 0x75, 0x6e, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x61, 0x6c, 0x49, 0x6e, 0x74, 0x65, 0x72, 0x66, 0x61, 0x63, 0x65, 0x3b, 0x06, 0x01, 0x00, 0x01, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x04, 0x01, 0x00, 0x05, 0x00, 0x06, 0x00, 0x00, 0x00, 0x02, 0x00, 0x07, 0x00, 0x00, 0x00, 0x02, 0x00, 0x08, 0x00, 0x09, 0x00, 0x00, 0x00, 0x06, 0x00, 0x01, 0x00, 0x0a, 0x00, 0x00 },
-        .methods = {
-            method_info {
-                .name = "onLoad",
-                .desc = "(Ljava/lang/String;[B)[B",
-                .access = 0x401,
-            },
-        }
-    },
-};
-
-}
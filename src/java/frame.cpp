@@ -0,0 +1,74 @@
+#include "frame.hpp"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+static std::mutex counters_lock;
+
+static std::vector<frame_counter*>& counters() {
+    static std::vector<frame_counter*> instance;
+    return instance;
+}
+
+frame_counter::frame_counter(const char* operation) : operation(operation), frames(0), peak(0) {
+    std::lock_guard guard(counters_lock);
+    counters().push_back(this);
+}
+
+void frame_counter::record(uint32_t refs) {
+    frames.fetch_add(1, std::memory_order_relaxed);
+
+    auto previous = peak.load(std::memory_order_relaxed);
+    while (refs > previous && !peak.compare_exchange_weak(previous, refs, std::memory_order_relaxed));
+}
+
+std::string frame_counter::report() {
+    std::lock_guard guard(counters_lock);
+
+    std::stringstream stream;
+    for (auto counter : counters()) {
+        auto frames = counter->frames.load(std::memory_order_relaxed);
+        if (frames == 0)
+            continue;
+
+        stream << counter->peak.load(std::memory_order_relaxed) << '\t' << frames << '\t' << counter->operation << '\n';
+    }
+
+    return stream.str();
+}
+
+thread_local local_frame* local_frame::current = nullptr;
+
+local_frame::local_frame(JNIEnv* env, frame_counter& counter, jint capacity) : env(env), counter(counter), pushed(false), active(true), refs(0), parent(current) {
+    if (env->PushLocalFrame(capacity) == JNI_OK) {
+        pushed = true;
+    } else {
+        // OutOfMemoryError, the refs just end up in the caller's frame instead
+        env->ExceptionClear();
+        std::cerr << "Failed to push a local frame of " << capacity << " refs for " << counter.operation << "." << std::endl;
+    }
+
+    current = this;
+}
+
+local_frame::~local_frame() {
+    if (pushed)
+        env->PopLocalFrame(nullptr);
+
+    leave();
+}
+
+void local_frame::leave() {
+    if (!active)
+        return;
+
+    active = false;
+    counter.record(refs);
+    current = parent;
+}
+
+bool local_frame::is_pushed() const {
+    return pushed;
+}
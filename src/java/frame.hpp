@@ -0,0 +1,80 @@
+#pragma once
+
+#include "jni.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Peak local refs of one kind of operation ("dump", "class load hook"),
+// declared once per call site and reported over IPC.
+class frame_counter {
+
+public:
+
+    const char* operation;
+
+    std::atomic<uint64_t> frames;
+    std::atomic<uint32_t> peak;
+
+    frame_counter(const char* operation);
+
+    void record(uint32_t refs);
+
+    // "peak\tframes\toperation" per counter that has seen a frame
+    static std::string report();
+
+};
+
+// PushLocalFrame / PopLocalFrame for the lifetime of a scope, so bulk paths
+// release their local refs per class or per batch instead of piling them up
+// in whatever frame the JVM called us in. JNI has no way to ask how many refs
+// a frame holds, so the code creating them reports each one with track().
+class local_frame {
+
+    JNIEnv* env;
+    frame_counter& counter;
+
+    bool pushed;
+    // still the innermost frame of this thread, popping early ends that
+    bool active;
+    uint32_t refs;
+
+    local_frame* parent;
+    static thread_local local_frame* current;
+
+    void leave();
+
+public:
+
+    local_frame(JNIEnv* env, frame_counter& counter, jint capacity);
+    ~local_frame();
+
+    local_frame(const local_frame&) = delete;
+    local_frame& operator=(const local_frame&) = delete;
+
+    // false if the JVM couldn't reserve the capacity, refs then go to the enclosing frame
+    bool is_pushed() const;
+
+    // pops early, handing `result` back as a local ref of the enclosing frame
+    template<typename T>
+    T pop(T result) {
+        auto kept = result;
+        if (pushed)
+            kept = static_cast<T>(env->PopLocalFrame(result));
+
+        pushed = false;
+        leave();
+
+        return kept;
+    }
+
+    // counts towards the innermost frame of the calling thread, if there is one
+    template<typename T>
+    static T track(T ref) {
+        if (current != nullptr && ref != nullptr)
+            current->refs++;
+
+        return ref;
+    }
+
+};
@@ -0,0 +1,514 @@
+#include "hook.hpp"
+#include "cache.hpp"
+#include "frame.hpp"
+#include "java.hpp"
+#include "members.hpp"
+#include "pattern.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// buffers handed out by allocateClassBuffer during the current hook call on this thread
+struct hook_context {
+    std::vector<unsigned char*> allocations;
+};
+
+static thread_local hook_context* current_context = nullptr;
+
+// the name plus a view, a result and a read-only wrapper per stage, a few chained stages fit without growing
+static constexpr jint HOOK_FRAME_CAPACITY = 16;
+
+using byte_buffer = members::object<"java/nio/ByteBuffer">;
+
+using as_read_only_buffer = members::method<"java/nio/ByteBuffer", "asReadOnlyBuffer", byte_buffer()>;
+using buffer_limit = members::method<"java/nio/Buffer", "limit", jint()>;
+
+using on_load_bytes = members::method<"cat/psychward/goober/ClassLoadListener", "onLoad", members::bytes(members::string, members::bytes)>;
+using on_load_buffer = members::method<"cat/psychward/goober/ClassBufferListener", "onLoad", byte_buffer(members::string, byte_buffer)>;
+
+static std::vector<std::string> to_patterns(JNIEnv* env, jobjectArray j_patterns) {
+    std::vector<std::string> patterns;
+
+    auto count = j_patterns != nullptr ? env->GetArrayLength(j_patterns) : 0;
+    for (jsize i = 0; i < count; i++) {
+        auto j_pattern = static_cast<jstring>(env->GetObjectArrayElement(j_patterns, i));
+        if (j_pattern == nullptr)
+            continue;
+
+        const char* chars = env->GetStringUTFChars(j_pattern, nullptr);
+        std::string pattern(chars);
+        env->ReleaseStringUTFChars(j_pattern, chars);
+        env->DeleteLocalRef(j_pattern);
+
+        // the hook sees internal names, so match against those directly
+        std::replace(pattern.begin(), pattern.end(), '.', '/');
+        patterns.push_back(std::move(pattern));
+    }
+
+    return patterns;
+}
+
+// the kind goes into the key too, the two listener types don't see the same input
+static uint64_t to_cache_key(JNIEnv* env, jstring j_cache_key, listener_kind kind) {
+    if (j_cache_key == nullptr)
+        return 0;
+
+    const char* chars = env->GetStringUTFChars(j_cache_key, nullptr);
+    auto key = hash_bytes(std::span(reinterpret_cast<const uint8_t*>(chars), strlen(chars)), static_cast<uint64_t>(kind) + 1);
+    env->ReleaseStringUTFChars(j_cache_key, chars);
+
+    return key != 0 ? key : 1;
+}
+
+JNIEXPORT void JNICALL add_load_listener_j(JNIEnv* env, jclass owner, jobject listener, jint priority, jstring j_cache_key, jobjectArray j_patterns) {
+    load_hook::get()->add(env, listener, listener_kind::BYTES, priority, to_cache_key(env, j_cache_key, listener_kind::BYTES), to_patterns(env, j_patterns));
+}
+
+JNIEXPORT void JNICALL add_buffer_listener_j(JNIEnv* env, jclass owner, jobject listener, jint priority, jstring j_cache_key, jobjectArray j_patterns) {
+    load_hook::get()->add(env, listener, listener_kind::BUFFER, priority, to_cache_key(env, j_cache_key, listener_kind::BUFFER), to_patterns(env, j_patterns));
+}
+
+JNIEXPORT jobject JNICALL allocate_class_buffer_j(JNIEnv* env, jclass owner, jint size) {
+    if (current_context == nullptr) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalStateException"), "class buffers can only be allocated inside a class load listener");
+        return nullptr;
+    }
+
+    unsigned char* buf;
+    if (size < 0 || java::get()->ti()->Allocate(size, &buf) != JVMTI_ERROR_NONE) {
+        env->ThrowNew(env->FindClass("java/lang/OutOfMemoryError"), "failed to allocate class buffer");
+        return nullptr;
+    }
+
+    current_context->allocations.push_back(buf);
+    return env->NewDirectByteBuffer(buf, size);
+}
+
+// where the output of the previous stage currently lives
+enum class data_source : uint8_t {
+    // untouched JVM class_data
+    ORIGINAL = 0,
+    // byte[] returned by a ClassLoadListener
+    ARRAY,
+    // JVMTI allocation owned by the chain
+    ALLOCATED
+};
+
+struct chain_data {
+    data_source source;
+
+    // valid for ORIGINAL and ALLOCATED
+    const unsigned char* bytes;
+    unsigned char* owned;
+    jint length;
+
+    // views of the current data, created lazily and reused until a stage changes it
+    jbyteArray array;
+    jobject buffer;
+};
+
+static void release(jvmtiEnv* ti, JNIEnv* env, chain_data& data) {
+    if (data.array != nullptr)
+        env->DeleteLocalRef(data.array);
+    if (data.buffer != nullptr)
+        env->DeleteLocalRef(data.buffer);
+    if (data.owned != nullptr)
+        ti->Deallocate(data.owned);
+
+    data.array = nullptr;
+    data.buffer = nullptr;
+    data.owned = nullptr;
+}
+
+static void replace(jvmtiEnv* ti, JNIEnv* env, chain_data& data, jbyteArray array) {
+    release(ti, env, data);
+
+    data.source = data_source::ARRAY;
+    data.bytes = nullptr;
+    data.length = env->GetArrayLength(array);
+    data.array = array;
+}
+
+static void replace(jvmtiEnv* ti, JNIEnv* env, chain_data& data, unsigned char* buf, jint length) {
+    release(ti, env, data);
+
+    data.source = data_source::ALLOCATED;
+    data.bytes = buf;
+    data.owned = buf;
+    data.length = length;
+}
+
+static jbyteArray as_array(JNIEnv* env, chain_data& data) {
+    if (data.array == nullptr) {
+        data.array = local_frame::track(env->NewByteArray(data.length));
+        env->SetByteArrayRegion(data.array, 0, data.length, reinterpret_cast<const jbyte*>(data.bytes));
+    }
+
+    return data.array;
+}
+
+// null if the bytes couldn't be moved out of the heap, the data then stays an array
+static const unsigned char* as_native(jvmtiEnv* ti, JNIEnv* env, chain_data& data) {
+    // a byte[] has no stable address, so move it out of the heap first. the
+    // array stays valid as a view since the contents are the same
+    if (data.source == data_source::ARRAY) {
+        unsigned char* buf = nullptr;
+        if (ti->Allocate(data.length, &buf) != JVMTI_ERROR_NONE || buf == nullptr)
+            return nullptr;
+
+        env->GetByteArrayRegion(data.array, 0, data.length, reinterpret_cast<jbyte*>(buf));
+
+        data.source = data_source::ALLOCATED;
+        data.bytes = buf;
+        data.owned = buf;
+    }
+
+    return data.bytes;
+}
+
+static jobject as_buffer(jvmtiEnv* ti, JNIEnv* env, chain_data& data) {
+    if (data.buffer != nullptr)
+        return data.buffer;
+
+    if (as_native(ti, env, data) == nullptr)
+        return nullptr;
+
+    auto writable = local_frame::track(env->NewDirectByteBuffer(const_cast<unsigned char*>(data.bytes), data.length));
+    data.buffer = local_frame::track(as_read_only_buffer::call(env, writable));
+    env->DeleteLocalRef(writable);
+
+    return data.buffer;
+}
+
+enum class stage_result : uint8_t {
+    UNCHANGED = 0,
+    CHANGED,
+    // threw or returned something unusable, nothing worth caching
+    FAILED
+};
+
+static stage_result run_array_stage(jvmtiEnv* ti, JNIEnv* env, const load_listener& entry, jstring j_name, chain_data& data) {
+    auto input = as_array(env, data);
+    auto value = local_frame::track(on_load_bytes::call(env, entry.listener, j_name, input));
+
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        return stage_result::FAILED;
+    }
+
+    // null, or handing back the input, means unchanged
+    if (value == nullptr || env->IsSameObject(value, input)) {
+        env->DeleteLocalRef(value);
+        return stage_result::UNCHANGED;
+    }
+
+    replace(ti, env, data, value);
+    return stage_result::CHANGED;
+}
+
+static stage_result run_buffer_stage(jvmtiEnv* ti, JNIEnv* env, hook_context& context, const load_listener& entry, jstring j_name, chain_data& data) {
+    auto input = as_buffer(ti, env, data);
+    if (input == nullptr) {
+        std::cerr << "Failed to allocate the input of a ClassBufferListener, skipping it." << std::endl;
+        return stage_result::FAILED;
+    }
+
+    auto value = local_frame::track(on_load_buffer::call(env, entry.listener, j_name, input));
+
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        return stage_result::FAILED;
+    }
+
+    if (value == nullptr)
+        return stage_result::UNCHANGED;
+
+    auto address = static_cast<unsigned char*>(env->GetDirectBufferAddress(value));
+    jint length = buffer_limit::call(env, value);
+    env->DeleteLocalRef(value);
+
+    if (address == nullptr) {
+        std::cerr << "ClassBufferListener returned a non-direct buffer, ignoring it." << std::endl;
+        return stage_result::FAILED;
+    }
+
+    if (address == data.bytes)
+        return stage_result::UNCHANGED;
+
+    // buffers from allocateClassBuffer are adopted as-is, anything else gets copied
+    auto owned = std::find(context.allocations.begin(), context.allocations.end(), address);
+    if (owned != context.allocations.end()) {
+        context.allocations.erase(owned);
+    } else {
+        // the previous stage's bytes stay if there's no room for a copy
+        auto source = address;
+        if (ti->Allocate(length, &address) != JVMTI_ERROR_NONE || address == nullptr) {
+            std::cerr << "Failed to copy the buffer of a ClassBufferListener, ignoring it." << std::endl;
+            return stage_result::FAILED;
+        }
+
+        memcpy(address, source, length);
+    }
+
+    replace(ti, env, data, address, length);
+    return stage_result::CHANGED;
+}
+
+bool load_listener::matches(std::string_view name) const {
+    if (patterns.empty())
+        return true;
+
+    return std::any_of(patterns.begin(), patterns.end(), [name](auto& p) {
+        return pattern::match(p, name, '/');
+    });
+}
+
+listener_set::~listener_set() {
+    if (retired.empty())
+        return;
+
+    // the last hook done with a snapshot may be any thread, JVM ones and attached ones alike
+    auto env = java::get()->env();
+    for (auto listener : retired)
+        env->DeleteGlobalRef(listener);
+}
+
+load_hook::load_hook() : listeners(std::make_shared<const listener_set>()), next_id(0) {}
+
+load_hook* load_hook::get() {
+    static load_hook instance;
+    return &instance;
+}
+
+int32_t load_hook::insert(load_listener entry) {
+    std::lock_guard lock(write_lock);
+
+    auto updated = std::make_shared<listener_set>();
+    updated->entries = listeners.load()->entries;
+
+    // ascending priority, registration order among equals
+    auto pos = std::upper_bound(updated->entries.begin(), updated->entries.end(), entry.priority, [](int priority, auto& entry) {
+        return priority < entry.priority;
+    });
+
+    entry.id = next_id++;
+    auto id = entry.id;
+    updated->entries.insert(pos, std::move(entry));
+
+    listeners.store(std::move(updated));
+    return id;
+}
+
+int32_t load_hook::add(JNIEnv* env, jobject listener, listener_kind kind, int priority, uint64_t cache_key, std::vector<std::string> patterns) {
+    return insert(load_listener {
+        .listener = env->NewGlobalRef(listener),
+        .kind = kind,
+        .transform = nullptr,
+        .user_data = nullptr,
+        .priority = priority,
+        .cache_key = cache_key,
+        .patterns = std::move(patterns)
+    });
+}
+
+int32_t load_hook::add(goober_transform_fn transform, void* user_data, int priority, std::vector<std::string> patterns) {
+    return insert(load_listener {
+        .listener = nullptr,
+        .kind = listener_kind::NATIVE,
+        .transform = transform,
+        .user_data = user_data,
+        .priority = priority,
+        .cache_key = 0,
+        .patterns = std::move(patterns)
+    });
+}
+
+void load_hook::remove(int32_t id) {
+    std::lock_guard lock(write_lock);
+
+    auto updated = std::make_shared<listener_set>();
+    updated->entries = listeners.load()->entries;
+    std::erase_if(updated->entries, [id](auto& entry) {
+        return entry.id == id && entry.kind == listener_kind::NATIVE;
+    });
+
+    listeners.store(std::move(updated));
+}
+
+size_t load_hook::remove_loader(JNIEnv* env, jobject loader) {
+    std::unique_lock lock(write_lock);
+
+    auto ti = java::get()->ti();
+    auto previous = listeners.load();
+    auto updated = std::make_shared<listener_set>();
+
+    std::vector<jobject> removed;
+    for (auto& entry : previous->entries) {
+        jobject defining_loader = nullptr;
+        if (entry.kind != listener_kind::NATIVE) {
+            auto clazz = env->GetObjectClass(entry.listener);
+            ti->GetClassLoader(clazz, &defining_loader);
+            env->DeleteLocalRef(clazz);
+        }
+
+        if (defining_loader != nullptr && env->IsSameObject(defining_loader, loader))
+            removed.push_back(entry.listener);
+        else
+            updated->entries.push_back(entry);
+
+        if (defining_loader != nullptr)
+            env->DeleteLocalRef(defining_loader);
+    }
+
+    if (removed.empty())
+        return 0;
+
+    // on_load holds a copy of the snapshot for as long as it runs, the refs go
+    // with the last one. nobody waits here for a listener that never returns
+    auto count = removed.size();
+    previous->retired = std::move(removed);
+
+    listeners.store(std::move(updated));
+    previous.reset();
+
+    return count;
+}
+
+static void run_native_stage(jvmtiEnv* ti, JNIEnv* env, const load_listener& entry, const char* name, chain_data& data) {
+    auto input = as_native(ti, env, data);
+    if (input == nullptr) {
+        std::cerr << "Failed to allocate the input of a native transformer, skipping it." << std::endl;
+        return;
+    }
+
+    unsigned char* output = nullptr;
+    int32_t length = 0;
+
+    if (entry.transform(entry.user_data, name, input, data.length, &output, &length) != GOOBER_TRANSFORMED)
+        return;
+
+    if (output == nullptr || output == input)
+        return;
+
+    replace(ti, env, data, output, length);
+}
+
+void load_hook::on_load(jvmtiEnv* ti, JNIEnv* env, const char* name, jint class_data_len, const unsigned char* class_data, jint* new_class_data_len, unsigned char** new_class_data) {
+    auto snapshot = listeners.load();
+    auto cache = transform_cache::get();
+
+    // hidden classes come through without a name, only unfiltered listeners get those
+    std::string_view class_name = name != nullptr ? name : "";
+
+    hook_context context;
+    auto previous_context = std::exchange(current_context, &context);
+
+    auto data = chain_data {
+        .source = data_source::ORIGINAL,
+        .bytes = class_data,
+        .owned = nullptr,
+        .length = class_data_len,
+        .array = nullptr,
+        .buffer = nullptr
+    };
+
+    jstring j_name = nullptr;
+
+    // views and results of every stage, all released together when the hook returns
+    static frame_counter counter("class load hook");
+    std::optional<local_frame> frame;
+
+    // every matching stage sees the output of the one before it
+    for (auto& entry : snapshot->entries) {
+        if (name == nullptr ? !entry.patterns.empty() : !entry.matches(class_name))
+            continue;
+
+        if (entry.kind == listener_kind::NATIVE) {
+            run_native_stage(ti, env, entry, name, data);
+            continue;
+        }
+
+        // a cache hit replays the listener's earlier output without calling into Java
+        uint64_t input_hash = 0;
+        jint input_length = data.length;
+        bool cached = entry.cache_key != 0 && cache->is_open();
+
+        // without native bytes to hash, the listener just runs uncached
+        auto native = cached ? as_native(ti, env, data) : nullptr;
+        cached = native != nullptr;
+
+        if (cached) {
+            input_hash = hash_bytes(std::span(native, data.length));
+
+            unsigned char* output;
+            jint output_length;
+            auto result = cache->lookup(ti, input_hash, input_length, entry.cache_key, &output, &output_length);
+
+            if (result == cache_result::UNCHANGED)
+                continue;
+
+            if (result == cache_result::HIT) {
+                replace(ti, env, data, output, output_length);
+                continue;
+            }
+        }
+
+        // the frame is only worth pushing once a Java listener actually runs
+        if (!frame)
+            frame.emplace(env, counter, HOOK_FRAME_CAPACITY);
+
+        // only pay for the name and copies once somebody actually wants the class
+        if (j_name == nullptr && name != nullptr)
+            j_name = local_frame::track(env->NewStringUTF(name));
+
+        auto result = entry.kind == listener_kind::BYTES
+            ? run_array_stage(ti, env, entry, j_name, data)
+            : run_buffer_stage(ti, env, context, entry, j_name, data);
+
+        if (!cached || result == stage_result::FAILED)
+            continue;
+
+        if (result == stage_result::UNCHANGED)
+            cache->store_unchanged(input_hash, input_length, entry.cache_key);
+        else if (auto output = as_native(ti, env, data))
+            cache->store(input_hash, input_length, entry.cache_key, std::span(output, data.length));
+    }
+
+    // the only copy the chain itself makes, and only if the last change was a byte[]
+    switch (data.source) {
+        case data_source::ORIGINAL:
+            break;
+        case data_source::ARRAY: {
+            // without a copy the class loads as it came in, rather than from garbage
+            unsigned char* buf = nullptr;
+            if (ti->Allocate(data.length, &buf) != JVMTI_ERROR_NONE || buf == nullptr) {
+                std::cerr << "Failed to allocate the transformed class data, loading " << class_name << " unchanged." << std::endl;
+                break;
+            }
+
+            env->GetByteArrayRegion(data.array, 0, data.length, reinterpret_cast<jbyte*>(buf));
+
+            *new_class_data_len = data.length;
+            *new_class_data = buf;
+        } break;
+        case data_source::ALLOCATED: {
+            *new_class_data_len = data.length;
+            *new_class_data = std::exchange(data.owned, nullptr);
+        } break;
+    }
+
+    release(ti, env, data);
+
+    // whatever the listeners allocated but didn't hand back
+    for (auto buf : context.allocations)
+        ti->Deallocate(buf);
+
+    current_context = previous_context;
+}
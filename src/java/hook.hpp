@@ -0,0 +1,95 @@
+#pragma once
+
+#include "jni.h"
+#include "jvmti.h"
+#include "../plugin/goober.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class listener_kind : uint8_t {
+    // ClassLoadListener, gets and returns byte[] copies
+    BYTES = 0,
+    // ClassBufferListener, gets a direct view of the class data
+    BUFFER,
+    // goober_transformer from a native plugin
+    NATIVE
+};
+
+struct load_listener {
+    int32_t id;
+
+    // global ref to the ClassLoadListener / ClassBufferListener
+    jobject listener;
+    listener_kind kind;
+
+    // NATIVE only
+    goober_transform_fn transform;
+    void* user_data;
+
+    // stages run in ascending priority, each one sees the previous output
+    int priority;
+
+    // hash of the listener's cache key and kind, 0 if its results aren't cached
+    uint64_t cache_key;
+
+    // internal-name patterns ("com/acme/"), empty means every class
+    std::vector<std::string> patterns;
+
+    bool matches(std::string_view name) const;
+};
+
+// One copy-on-write generation of the listeners.
+struct listener_set {
+    std::vector<load_listener> entries;
+
+    // refs of listeners the next generation dropped. hooks still running on this
+    // one may use them, so they go with whoever holds the last copy
+    mutable std::vector<jobject> retired;
+
+    ~listener_set();
+};
+
+// Native side of Utility.onClassLoad. Listeners and their name filters live
+// here so the ClassFileLoadHook can reject uninteresting classes with a string
+// compare before touching JNI at all. Matching listeners form a transform
+// chain ordered by priority.
+class load_hook {
+
+    // copy-on-write like the CopyOnWriteArrayList it replaces, the hook only
+    // ever loads a snapshot and never takes the lock
+    std::atomic<std::shared_ptr<const listener_set>> listeners;
+    std::mutex write_lock;
+
+    std::atomic<int32_t> next_id;
+
+    int32_t insert(load_listener entry);
+
+    load_hook();
+
+public:
+
+    static load_hook* get();
+
+    int32_t add(JNIEnv* env, jobject listener, listener_kind kind, int priority, uint64_t cache_key, std::vector<std::string> patterns);
+
+    int32_t add(goober_transform_fn transform, void* user_data, int priority, std::vector<std::string> patterns);
+
+    // only for native transformers, the snapshot may still be in use elsewhere
+    void remove(int32_t id);
+
+    // every Java listener whose class the loader defined. their refs are deleted once
+    // no hook runs on the old snapshot anymore, returns how many went
+    size_t remove_loader(JNIEnv* env, jobject loader);
+
+    void on_load(jvmtiEnv* ti, JNIEnv* env, const char* name, jint class_data_len, const unsigned char* class_data, jint* new_class_data_len, unsigned char** new_class_data);
+
+};
+
+JNIEXPORT void JNICALL add_load_listener_j(JNIEnv* env, jclass owner, jobject listener, jint priority, jstring j_cache_key, jobjectArray j_patterns);
+JNIEXPORT void JNICALL add_buffer_listener_j(JNIEnv* env, jclass owner, jobject listener, jint priority, jstring j_cache_key, jobjectArray j_patterns);
+JNIEXPORT jobject JNICALL allocate_class_buffer_j(JNIEnv* env, jclass owner, jint size);
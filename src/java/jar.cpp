@@ -0,0 +1,264 @@
+#include "jar.hpp"
+#include "codec.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static constexpr uint32_t END_SIGNATURE = 0x06054b50;
+static constexpr uint32_t CENTRAL_SIGNATURE = 0x02014b50;
+static constexpr uint32_t LOCAL_SIGNATURE = 0x04034b50;
+
+static constexpr size_t END_SIZE = 22;
+static constexpr size_t CENTRAL_SIZE = 46;
+static constexpr size_t LOCAL_SIZE = 30;
+
+// zip fields are little endian and unaligned
+static uint16_t u2(const uint8_t* at) {
+    return at[0] | at[1] << 8;
+}
+
+static uint32_t u4(const uint8_t* at) {
+    return at[0] | at[1] << 8 | at[2] << 16 | static_cast<uint32_t>(at[3]) << 24;
+}
+
+JNIEXPORT jclass JNICALL define_jar_class_j(JNIEnv* env, jobject loader, jlong jar, jstring j_name) {
+    auto file = reinterpret_cast<const jar_file*>(jar);
+
+    const char* chars = env->GetStringUTFChars(j_name, nullptr);
+    std::string name(chars);
+    env->ReleaseStringUTFChars(j_name, chars);
+
+    std::replace(name.begin(), name.end(), '.', '/');
+
+    auto entry = file->find(name + ".class");
+    if (entry == nullptr)
+        return nullptr;
+
+    // DefineClass copies the bytes, so one buffer per thread does
+    static thread_local std::vector<uint8_t> scratch;
+    if (!file->read(*entry, scratch)) {
+        std::cerr << "Failed to read " << entry->name << " from the agent jar." << std::endl;
+        return nullptr;
+    }
+
+    return env->DefineClass(name.c_str(), loader, reinterpret_cast<const jbyte*>(scratch.data()), scratch.size());
+}
+
+#ifdef _WIN32
+jar_file::jar_file() : file(INVALID_HANDLE_VALUE), mapping(nullptr), base(nullptr), size(0) {}
+#else
+jar_file::jar_file() : fd(-1), base(nullptr), size(0) {}
+#endif
+
+jar_file::~jar_file() {
+    close();
+}
+
+jar_status jar_file::open(const std::filesystem::path& path) {
+    close();
+
+#ifdef _WIN32
+    file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return jar_status::OPEN_FAILED;
+
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+        close();
+        return jar_status::OPEN_FAILED;
+    }
+
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    base = mapping != nullptr ? static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (base == nullptr) {
+        close();
+        return jar_status::OPEN_FAILED;
+    }
+
+    size = length.QuadPart;
+#else
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return jar_status::OPEN_FAILED;
+
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size == 0) {
+        close();
+        return jar_status::OPEN_FAILED;
+    }
+
+    auto address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+        close();
+        return jar_status::OPEN_FAILED;
+    }
+
+    base = static_cast<const uint8_t*>(address);
+    size = info.st_size;
+#endif
+
+    // the end record sits behind a comment of up to 64k, so search backwards for it
+    if (size < END_SIZE) {
+        close();
+        return jar_status::MALFORMED;
+    }
+
+    const uint8_t* end = nullptr;
+    auto lowest = size > END_SIZE + 0xffff ? size - END_SIZE - 0xffff : 0;
+    for (auto at = size - END_SIZE + 1; at-- > lowest;) {
+        if (u4(base + at) == END_SIGNATURE && at + END_SIZE + u2(base + at + 20) == size) {
+            end = base + at;
+            break;
+        }
+    }
+
+    if (end == nullptr) {
+        close();
+        return jar_status::MALFORMED;
+    }
+
+    auto count = u2(end + 10);
+    auto directory_size = u4(end + 12);
+    auto directory_offset = u4(end + 16);
+
+    if (u2(end + 4) != 0 || u2(end + 6) != 0 || count == 0xffff || directory_offset == 0xffffffff) {
+        close();
+        return jar_status::UNSUPPORTED;
+    }
+
+    if (directory_offset > size || directory_size > size - directory_offset) {
+        close();
+        return jar_status::MALFORMED;
+    }
+
+    entries.reserve(count);
+
+    auto at = base + directory_offset;
+    auto directory_end = at + directory_size;
+
+    for (size_t i = 0; i < count; i++) {
+        if (directory_end - at < static_cast<ptrdiff_t>(CENTRAL_SIZE) || u4(at) != CENTRAL_SIGNATURE) {
+            close();
+            return jar_status::MALFORMED;
+        }
+
+        auto name_length = u2(at + 28);
+        auto record_size = CENTRAL_SIZE + name_length + u2(at + 30) + u2(at + 32);
+        if (directory_end - at < static_cast<ptrdiff_t>(record_size)) {
+            close();
+            return jar_status::MALFORMED;
+        }
+
+        auto entry = jar_entry {
+            .name = std::string_view(reinterpret_cast<const char*>(at + CENTRAL_SIZE), name_length),
+            .method = u2(at + 10),
+            .compressed_size = u4(at + 20),
+            .size = u4(at + 24),
+            .local_offset = u4(at + 42)
+        };
+
+        // encrypted entries can't be read anyway
+        if ((u2(at + 8) & 1) == 0) {
+            by_name.emplace(entry.name, entries.size());
+            entries.push_back(entry);
+        }
+
+        at += record_size;
+    }
+
+    return jar_status::OK;
+}
+
+void jar_file::close() {
+#ifdef _WIN32
+    if (base != nullptr)
+        UnmapViewOfFile(base);
+    if (mapping != nullptr)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (base != nullptr)
+        munmap(const_cast<uint8_t*>(base), size);
+    if (fd != -1)
+        ::close(fd);
+
+    fd = -1;
+#endif
+
+    base = nullptr;
+    size = 0;
+
+    entries.clear();
+    by_name.clear();
+}
+
+const std::vector<jar_entry>& jar_file::list() const {
+    return entries;
+}
+
+const jar_entry* jar_file::find(std::string_view name) const {
+    auto pos = by_name.find(name);
+    return pos != by_name.end() ? &entries[pos->second] : nullptr;
+}
+
+bool jar_file::read(const jar_entry& entry, std::vector<uint8_t>& output) const {
+    if (entry.local_offset > size || size - entry.local_offset < LOCAL_SIZE)
+        return false;
+
+    auto local = base + entry.local_offset;
+    if (u4(local) != LOCAL_SIGNATURE)
+        return false;
+
+    // the local extra field may differ from the central one, so its own lengths count here
+    auto data_offset = entry.local_offset + LOCAL_SIZE + u2(local + 26) + u2(local + 28);
+    if (data_offset > size || size - data_offset < entry.compressed_size)
+        return false;
+
+    auto data = std::span(base + data_offset, entry.compressed_size);
+    output.resize(entry.size);
+
+    switch (entry.method) {
+    case 0:
+        if (entry.compressed_size != entry.size)
+            return false;
+
+        std::copy(data.begin(), data.end(), output.begin());
+        return true;
+    case 8:
+        return codec::inflate(data, output);
+    default:
+        return false;
+    }
+}
+
+std::ostream& operator<<(std::ostream& stream, jar_status status) {
+
+    switch (status) {
+    case jar_status::OK:
+        stream << "OK";
+        break;
+    case jar_status::OPEN_FAILED:
+        stream << "Open failed";
+        break;
+    case jar_status::MALFORMED:
+        stream << "Malformed";
+        break;
+    case jar_status::UNSUPPORTED:
+        stream << "Unsupported";
+        break;
+    }
+
+    return stream;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "jni.h"
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+enum class jar_status : uint8_t {
+    OK = 0,
+    OPEN_FAILED,
+    // no end of central directory, or one pointing outside the file
+    MALFORMED,
+    // zip64 and multi-disk archives
+    UNSUPPORTED
+};
+
+std::ostream& operator<<(std::ostream& stream, jar_status status);
+
+struct jar_entry {
+    // points into the mapping, valid while the jar is open
+    std::string_view name;
+
+    // 0 stored, 8 deflated, anything else can't be read
+    uint16_t method;
+    uint32_t compressed_size;
+    uint32_t size;
+    uint32_t local_offset;
+};
+
+// Read-only view of a zip archive. The file is mapped and the central
+// directory is parsed once on open, entries are then read straight out of the
+// mapping without going through any Java zip machinery.
+class jar_file {
+
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+
+    const uint8_t* base;
+    size_t size;
+
+    std::vector<jar_entry> entries;
+    std::unordered_map<std::string_view, size_t> by_name;
+
+public:
+
+    jar_file();
+    ~jar_file();
+
+    jar_file(const jar_file&) = delete;
+    jar_file& operator=(const jar_file&) = delete;
+
+    jar_status open(const std::filesystem::path& path);
+    void close();
+
+    const std::vector<jar_entry>& list() const;
+    const jar_entry* find(std::string_view name) const;
+
+    // false for corrupt entries and unsupported compression methods
+    bool read(const jar_entry& entry, std::vector<uint8_t>& output) const;
+
+};
+
+// EmbeddedClassLoader style callback of AgentClassLoader.findClass
+JNIEXPORT jclass JNICALL define_jar_class_j(JNIEnv* env, jobject loader, jlong jar, jstring j_name);
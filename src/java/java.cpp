@@ -1,11 +1,31 @@
 #include "java.hpp"
+#include "hook.hpp"
 #include "jni.h"
 #include "jvmti.h"
+#include "codec.hpp"
+#include "frame.hpp"
+#include "jar.hpp"
+#include "members.hpp"
+#include "pattern.hpp"
+#include "queue.hpp"
+#include "../probe/probe.hpp"
+#include "../profiler/alloc_profiler.hpp"
+#include "../profiler/async_sampler.hpp"
+#include "../profiler/contention_profiler.hpp"
+#include "../profiler/gc_monitor.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <filesystem>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <ostream>
+#include <shared_mutex>
+#include <span>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 #include "../lib/lib.hpp"
 
@@ -30,9 +50,15 @@ JNIEXPORT jint JNICALL redefine_class_s(JNIEnv* env, jclass owner, jstring j_cla
     auto jvm = java::get();
 
     const char* class_name = env->GetStringUTFChars(j_class_name, nullptr);
-    auto value = redefine_class_c(env, owner, jvm->get_class(class_name), new_bytes);
+    auto clazz = jvm->get_class(class_name);
     env->ReleaseStringUTFChars(j_class_name, class_name);
 
+    if (clazz == nullptr)
+        return JVMTI_ERROR_INVALID_CLASS;
+
+    auto value = redefine_class_c(env, owner, clazz, new_bytes);
+    env->DeleteLocalRef(clazz);
+
     return value;
 }
 
@@ -45,23 +71,198 @@ JNIEXPORT jint JNICALL retransform_class_s(JNIEnv* env, jclass owner, jstring j_
 
     const char* class_name = env->GetStringUTFChars(j_class_name, nullptr);
     std::cout << "attempting to retransform " << class_name << std::endl;
-    auto value = retransform_class_c(env, owner, jvm->get_class(class_name));
+    auto clazz = jvm->get_class(class_name);
     env->ReleaseStringUTFChars(j_class_name, class_name);
 
+    if (clazz == nullptr)
+        return JVMTI_ERROR_INVALID_CLASS;
+
+    auto value = retransform_class_c(env, owner, clazz);
+    env->DeleteLocalRef(clazz);
+
     return value;
 }
 
+JNIEXPORT jint JNICALL redefine_classes_j(JNIEnv* env, jclass owner, jobjectArray j_classes, jobjectArray j_bytes) {
+    auto count = env->GetArrayLength(j_classes);
+    if (env->GetArrayLength(j_bytes) != count) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"), "classes and data differ in length");
+        return JVMTI_ERROR_ILLEGAL_ARGUMENT;
+    }
+
+    static frame_counter counter("redefineClasses");
+
+    // every class ref has to live until the call, the default 16 slots aren't going to cut it
+    local_frame frame(env, counter, count + 1);
+
+    std::vector<jclass> classes(count);
+    std::vector<std::vector<jbyte>> buffers(count);
+    std::vector<jvmtiClassDefinition> definitions(count);
+
+    for (jsize i = 0; i < count; i++) {
+        classes[i] = local_frame::track(static_cast<jclass>(env->GetObjectArrayElement(j_classes, i)));
+        auto bytes = local_frame::track(static_cast<jbyteArray>(env->GetObjectArrayElement(j_bytes, i)));
+        if (classes[i] == nullptr || bytes == nullptr)
+            return JVMTI_ERROR_NULL_POINTER;
+
+        auto length = env->GetArrayLength(bytes);
+        buffers[i].resize(length);
+        env->GetByteArrayRegion(bytes, 0, length, buffers[i].data());
+        env->DeleteLocalRef(bytes);
+
+        definitions[i] = jvmtiClassDefinition {
+            .klass = classes[i],
+            .class_byte_count = length,
+            .class_bytes = reinterpret_cast<const unsigned char*>(buffers[i].data())
+        };
+    }
+
+    // all of them in one go, so one safepoint instead of one per class
+    return java::get()->ti()->RedefineClasses(count, definitions.data());
+}
+
+JNIEXPORT jint JNICALL retransform_classes_j(JNIEnv* env, jclass owner, jobjectArray j_classes) {
+    static frame_counter counter("retransformClasses");
+
+    auto count = env->GetArrayLength(j_classes);
+    local_frame frame(env, counter, count);
+
+    std::vector<jclass> classes(count);
+    for (jsize i = 0; i < count; i++) {
+        classes[i] = local_frame::track(static_cast<jclass>(env->GetObjectArrayElement(j_classes, i)));
+        if (classes[i] == nullptr)
+            return JVMTI_ERROR_NULL_POINTER;
+    }
+
+    return java::get()->ti()->RetransformClasses(count, classes.data());
+}
+
+JNIEXPORT jobjectArray JNICALL find_classes_j(JNIEnv* env, jclass owner, jstring j_pattern) {
+    auto jvm = java::get();
+
+    const char* pattern = env->GetStringUTFChars(j_pattern, nullptr);
+    auto found = jvm->find_classes(pattern);
+    env->ReleaseStringUTFChars(j_pattern, pattern);
+
+    auto array = env->NewObjectArray(found.size(), jvm->get_class("java.lang.Class"), nullptr);
+    for (size_t i = 0; i < found.size(); i++) {
+        env->SetObjectArrayElement(array, i, found[i].second);
+        env->DeleteLocalRef(found[i].second);
+    }
+
+    return array;
+}
+
 JNIEXPORT void JNICALL on_shutdown(JNIEnv* env, jclass owner) {
     lib::get()->uninit();
 }
 
-java::java() : dumped(false), caps({}), callbacks({}) {
+JNIEXPORT jclass JNICALL define_embedded_j(JNIEnv* env, jobject loader, jstring j_name) {
+    const char* chars = env->GetStringUTFChars(j_name, nullptr);
+    std::string name(chars);
+    env->ReleaseStringUTFChars(j_name, chars);
+
+    std::replace(name.begin(), name.end(), '.', '/');
+    return java::get()->define_embedded_class(name, loader);
+}
+
+using class_get_name = members::method<"java/lang/Class", "getName", members::string()>;
+using get_system_class_loader = members::static_method<"java/lang/ClassLoader", "getSystemClassLoader", members::object<"java/lang/ClassLoader">()>;
+using load_agent = members::static_method<"cat/psychward/goober/Utility", "loadAgent", members::object<"java/lang/Object">(members::string, members::string)>;
+
+using class_loader = members::object<"java/lang/ClassLoader">;
+using new_embedded_loader = members::constructor<"cat/psychward/goober/EmbeddedClassLoader", class_loader>;
+using load_class = members::method<"java/lang/ClassLoader", "loadClass", members::clazz(members::string)>;
+
+using new_agent_loader = members::constructor<"cat/psychward/goober/AgentClassLoader", class_loader, members::string>;
+using agent_loader_jar = members::field<"cat/psychward/goober/AgentClassLoader", "jar", jlong>;
+using start_agent = members::static_method<"cat/psychward/goober/Utility", "startAgent", members::object<"java/lang/Object">(class_loader, members::string)>;
+using stop_agent = members::static_method<"cat/psychward/goober/Utility", "stopAgent", void(members::object<"java/lang/Object">)>;
+
+// classes indexed per local frame in dump()
+static constexpr int DUMP_BATCH = 512;
+
+// embedded classes per thread when defining a level in parallel
+static constexpr size_t PARALLEL_LEVEL = 16;
+
+// agent jar classes per thread when defining them up front
+static constexpr size_t PARALLEL_JAR = 32;
+
+static constexpr std::string_view EMBEDDED_LOADER = "cat/psychward/goober/EmbeddedClassLoader";
+static constexpr std::string_view AGENT_LOADER = "cat/psychward/goober/AgentClassLoader";
+static constexpr std::string_view PROBES = "cat/psychward/goober/Probes";
+
+// decompressed class file of an embedded class, valid until the next call on this thread.
+// DefineClass copies it, so one buffer per thread is all it ever takes
+static std::span<const uint8_t> class_file(const embedded::class_info& info) {
+    static thread_local std::vector<uint8_t> scratch;
+    scratch.resize(info.size);
+
+    if (!codec::decompress(info.bytes, scratch)) {
+        std::cerr << "Failed to decompress embedded class " << info.name << std::endl;
+        return {};
+    }
+
+    return scratch;
+}
+
+// natives of the embedded classes, bound whenever one of them gets defined
+static void register_natives(JNIEnv* env, std::string_view name, jclass clazz) {
+    if (name == "cat/psychward/goober/Utility") {
+        const JNINativeMethod methods[] = {
+            { const_cast<char*>("redefineClass"), const_cast<char*>("(Ljava/lang/String;[B)I"), reinterpret_cast<void*>(&redefine_class_s) },
+            { const_cast<char*>("redefineClass"), const_cast<char*>("(Ljava/lang/Class;[B)I"), reinterpret_cast<void*>(&redefine_class_c) },
+            { const_cast<char*>("retransformClass"), const_cast<char*>("(Ljava/lang/String;)I"), reinterpret_cast<void*>(&retransform_class_s) },
+            { const_cast<char*>("retransformClass"), const_cast<char*>("(Ljava/lang/Class;)I"), reinterpret_cast<void*>(&retransform_class_c) },
+            { const_cast<char*>("redefineClasses"), const_cast<char*>("([Ljava/lang/Class;[[B)I"), reinterpret_cast<void*>(&redefine_classes_j) },
+            { const_cast<char*>("retransformClasses"), const_cast<char*>("([Ljava/lang/Class;)I"), reinterpret_cast<void*>(&retransform_classes_j) },
+            { const_cast<char*>("queueRetransform"), const_cast<char*>("(Ljava/lang/Class;Ljava/util/concurrent/CompletableFuture;)V"), reinterpret_cast<void*>(&queue_retransform_j) },
+            { const_cast<char*>("findClasses"), const_cast<char*>("(Ljava/lang/String;)[Ljava/lang/Class;"), reinterpret_cast<void*>(&find_classes_j) },
+            { const_cast<char*>("addLoadListener"), const_cast<char*>("(Lcat/psychward/goober/ClassLoadListener;ILjava/lang/String;[Ljava/lang/String;)V"), reinterpret_cast<void*>(&add_load_listener_j) },
+            { const_cast<char*>("addBufferListener"), const_cast<char*>("(Lcat/psychward/goober/ClassBufferListener;ILjava/lang/String;[Ljava/lang/String;)V"), reinterpret_cast<void*>(&add_buffer_listener_j) },
+            { const_cast<char*>("allocateClassBuffer"), const_cast<char*>("(I)Ljava/nio/ByteBuffer;"), reinterpret_cast<void*>(&allocate_class_buffer_j) },
+        };
+        env->RegisterNatives(clazz, methods, sizeof(methods) / sizeof(*methods));
+    } else if (name == PROBES) {
+        const JNINativeMethod methods[] = {
+            { const_cast<char*>("record"), const_cast<char*>("(IJ)V"), reinterpret_cast<void*>(&probe_record_j) },
+        };
+        env->RegisterNatives(clazz, methods, sizeof(methods) / sizeof(*methods));
+    } else if (name == EMBEDDED_LOADER) {
+        const JNINativeMethod methods[] = {
+            { const_cast<char*>("defineEmbedded"), const_cast<char*>("(Ljava/lang/String;)Ljava/lang/Class;"), reinterpret_cast<void*>(&define_embedded_j) },
+        };
+        env->RegisterNatives(clazz, methods, sizeof(methods) / sizeof(*methods));
+    } else if (name == AGENT_LOADER) {
+        const JNINativeMethod methods[] = {
+            { const_cast<char*>("defineJarClass"), const_cast<char*>("(JLjava/lang/String;)Ljava/lang/Class;"), reinterpret_cast<void*>(&define_jar_class_j) },
+        };
+        env->RegisterNatives(clazz, methods, sizeof(methods) / sizeof(*methods));
+    }
+}
+
+// JVMTI signatures look like "Lcom/acme/Foo;", the index uses Class.getName() style names
+static std::string dotted_name(std::string_view internal_name) {
+    std::string name(internal_name);
+    std::replace(name.begin(), name.end(), '/', '.');
+    return name;
+}
+
+static std::string signature_to_name(std::string_view signature) {
+    if (signature.size() > 2 && signature.front() == 'L' && signature.back() == ';')
+        signature = signature.substr(1, signature.size() - 2);
+
+    return dotted_name(signature);
+}
+
+java::java() : index_sorted(0), dumped(false), embedded_loader(nullptr), caps({}), callbacks({}) {
     if (JNI_GetCreatedJavaVMs(&m_jvm, 1, nullptr) != JNI_OK) {
         std::cerr << "Failed to get created Java VMs." << std::endl;
         exit(1);
     }
 
-    if (m_jvm->AttachCurrentThreadAsDaemon(reinterpret_cast<void**>(&m_env), nullptr) != JNI_OK) {
+    auto env = this->env();
+    if (env == nullptr) {
         std::cerr << "Failed to attach to thread." << std::endl;
         exit(1);
     }
@@ -71,52 +272,44 @@ java::java() : dumped(false), caps({}), callbacks({}) {
         exit(1);
     }
 
+    // members resolve through the class index, falling back to FindClass while it's still empty
+    members::registry::get()->bind([this](const std::string& name, bool define) {
+        return define ? find_class(name) : get_class(name);
+    });
+
     dump();
 
-    auto class_loader = get_class("java.lang.ClassLoader");
-    auto get_system_loader = m_env->GetStaticMethodID(class_loader, "getSystemClassLoader", "()Ljava/lang/ClassLoader;");
-    auto system_loader = m_env->CallStaticObjectMethod(class_loader, get_system_loader);
+    for (size_t i = 0; i < embedded::classes.size(); i++)
+        embedded_index.emplace(embedded::classes[i].name, i);
 
-    // TODO: will have to implement a sort of dependency-system so i can load the important classes first
-    for (int i = 1; i < embedded::classes.size(); i++) {
-        auto info = embedded::classes[i];
+    auto system_loader = get_system_class_loader::call(env);
 
-        auto clazz = define_class(
-            info.name,
-            system_loader,
-            reinterpret_cast<jbyte *>(info.bytes.data()),
-            info.bytes.size()
-        );
-
-        if (clazz == 0) {
-            std::cerr << "Failed to define class " << info.name << std::endl;
+    // the bootstrap loader has nothing to hook into, so Probes is defined up front with the loader bridge itself
+    define_embedded(system_loader, [](std::string_view name) { return name == EMBEDDED_LOADER || name == PROBES; });
 
-            if (m_env->ExceptionCheck()) {
-                m_env->ExceptionDescribe();
-            }
-        }
+    if (is_loaded("cat.psychward.goober.EmbeddedClassLoader")) {
+        auto loader = new_embedded_loader::create(env, system_loader);
+        if (loader != nullptr)
+            embedded_loader = env->NewGlobalRef(loader);
     }
 
-    auto utility_info = embedded::classes[0];
+    if (embedded_loader == nullptr) {
+        if (env->ExceptionCheck())
+            env->ExceptionDescribe();
 
-    auto clazz = define_class(
-        utility_info.name,
-        system_loader,
-        reinterpret_cast<jbyte *>(utility_info.bytes.data()),
-        utility_info.bytes.size()
-    );
-
-    if (clazz == 0) {
-        std::cerr << "Failed to define class " << utility_info.name << std::endl;
+        std::cerr << "Failed to create the embedded class loader, defining everything up front." << std::endl;
+        define_embedded(system_loader, [](std::string_view name) { return name != EMBEDDED_LOADER && name != PROBES; });
     }
 
-    const JNINativeMethod methods[] = {
-        { const_cast<char*>("redefineClass"), const_cast<char*>("(Ljava/lang/String;[B)I"), reinterpret_cast<void*>(&redefine_class_s) },
-        { const_cast<char*>("redefineClass"), const_cast<char*>("(Ljava/lang/Class;[B)I"), reinterpret_cast<void*>(&redefine_class_c) },
-        { const_cast<char*>("retransformClass"), const_cast<char*>("(Ljava/lang/String;)I"), reinterpret_cast<void*>(&retransform_class_s) },
-        { const_cast<char*>("retransformClass"), const_cast<char*>("(Ljava/lang/Class;)I"), reinterpret_cast<void*>(&retransform_class_c) },
-    };
-    m_env->RegisterNatives(clazz, reinterpret_cast<const JNINativeMethod *>(&methods), 4);
+    // whatever is loaded now gets its IDs here instead of in the middle of a hook, embedded classes on first use
+    if (!members::registry::get()->resolve_all(env))
+        std::cerr << "Failed to resolve some JNI members, retrying them on first use." << std::endl;
+
+    // JDK members that every class definition and retransform calls without checking
+    if (members::id_of(env, class_get_name::slot) == nullptr || !retransform_queue::resolve(env)) {
+        std::cerr << "Failed to resolve the JDK members the index and queue depend on." << std::endl;
+        exit(1);
+    }
 
     caps.can_retransform_any_class = 1;
     caps.can_retransform_classes = 1;
@@ -129,104 +322,249 @@ java::java() : dumped(false), caps({}), callbacks({}) {
         lib::get()->uninit();
     };
 
-    callbacks.ClassFileLoadHook = [](jvmtiEnv *jvmti_env, JNIEnv *jni_env, jclass class_being_redefined, jobject loader, const char *name, jobject protection_domain, jint class_data_len, const unsigned char *class_data, jint *new_class_data_len, unsigned char **new_class_data) {
-        static jclass Utility;
-        auto jvm = get();
-
-        if (Utility == nullptr)
-            Utility = jvm->get_class("cat.psychward.goober.Utility");
-
-        if (Utility != nullptr) {
-            auto data_array = jni_env->NewByteArray(class_data_len);
-            jni_env->SetByteArrayRegion(data_array, 0, class_data_len, reinterpret_cast<const jbyte*>(class_data));
-            jstring j_name = jni_env->NewStringUTF(name);
-
-            static auto ClassLoadListener = jvm->get_class("cat.psychward.goober.ClassLoadListener");
-            static auto onLoadMethod = jni_env->GetMethodID(ClassLoadListener, "onLoad", "(Ljava/lang/String;[B)[B");
-
-            static auto List = jvm->get_class("java.util.List");
-            static auto Iterator = jvm->get_class("java.util.Iterator");
-
-            static auto listenersField = jni_env->GetStaticFieldID(Utility, "loadListeners", "Ljava/util/List;");
-            static auto iteratorMethod = jni_env->GetMethodID(List, "iterator", "()Ljava/util/Iterator;");
-            static auto hasNextMethod = jni_env->GetMethodID(Iterator, "hasNext", "()Z");
-            static auto nextMethod = jni_env->GetMethodID(Iterator, "next", "()Ljava/lang/Object;");
-
-            auto listeners = jni_env->GetStaticObjectField(Utility, listenersField);
-            auto iter = jni_env->CallObjectMethod(listeners, iteratorMethod);
+    // keeps the class index current for classes loaded after injection
+    callbacks.ClassPrepare = [](jvmtiEnv *jvmti_env, JNIEnv* jni_env, jthread thread, jclass klass) {
+        char* signature;
+        if (jvmti_env->GetClassSignature(klass, &signature, nullptr) != JVMTI_ERROR_NONE)
+            return;
 
-            while (jni_env->CallBooleanMethod(iter, hasNextMethod)) {
-                auto listener = jni_env->CallObjectMethod(iter, nextMethod);
+        get()->index(jni_env, signature_to_name(signature), klass);
 
-                auto value = jni_env->CallObjectMethod(listener, onLoadMethod, j_name, data_array);
+        jvmti_env->Deallocate(reinterpret_cast<unsigned char*>(signature));
 
-                jni_env->DeleteLocalRef(listener);
-
-                if (value != nullptr) {
-                    jbyteArray outArray = static_cast<jbyteArray>(value);
-                    jsize outLen = jni_env->GetArrayLength(outArray);
+        async_sampler::get()->prepare(jvmti_env, klass);
+    };
 
-                    jbyte* outBytes = jni_env->GetByteArrayElements(outArray, nullptr);
+    // nothing to do, but AsyncGetCallTrace only works while somebody listens. enabled by the async sampler
+    callbacks.ClassLoad = [](jvmtiEnv *jvmti_env, JNIEnv* jni_env, jthread thread, jclass klass) {};
 
-                    unsigned char* buf;
-                    jvmti_env->Allocate(outLen, &buf);
-                    memcpy(buf, outBytes, outLen);
+    // only enabled while the allocation profiler runs
+    callbacks.SampledObjectAlloc = [](jvmtiEnv *jvmti_env, JNIEnv* jni_env, jthread thread, jobject object, jclass object_klass, jlong size) {
+        alloc_profiler::get()->on_alloc(jvmti_env, object_klass, size);
+    };
 
-                    *new_class_data_len = outLen;
-                    *new_class_data = buf;
+    // only enabled while the GC monitor runs, these come from inside the pause
+    callbacks.GarbageCollectionStart = [](jvmtiEnv *jvmti_env) {
+        gc_monitor::get()->on_start();
+    };
 
-                    jni_env->ReleaseByteArrayElements(outArray, outBytes, JNI_ABORT);
-                    break;
-                }
+    callbacks.GarbageCollectionFinish = [](jvmtiEnv *jvmti_env) {
+        gc_monitor::get()->on_finish();
+    };
 
-                jni_env->DeleteLocalRef(value);
-            }
+    // only enabled while the contention profiler runs
+    callbacks.MonitorContendedEnter = [](jvmtiEnv *jvmti_env, JNIEnv* jni_env, jthread thread, jobject object) {
+        contention_profiler::get()->on_enter();
+    };
 
-            jni_env->DeleteLocalRef(j_name);
-            jni_env->DeleteLocalRef(data_array);
-            jni_env->DeleteLocalRef(iter);
-            jni_env->DeleteLocalRef(listeners);
+    callbacks.MonitorContendedEntered = [](jvmtiEnv *jvmti_env, JNIEnv* jni_env, jthread thread, jobject object) {
+        contention_profiler::get()->on_entered(jvmti_env, jni_env, object);
+    };
 
-        }
+    callbacks.ClassFileLoadHook = [](jvmtiEnv *jvmti_env, JNIEnv *jni_env, jclass class_being_redefined, jobject loader, const char *name, jobject protection_domain, jint class_data_len, const unsigned char *class_data, jint *new_class_data_len, unsigned char **new_class_data) {
+        load_hook::get()->on_load(jvmti_env, jni_env, name, class_data_len, class_data, new_class_data_len, new_class_data);
     };
 
     m_ti->SetEventCallbacks(&callbacks, sizeof(jvmtiEventCallbacks));
     m_ti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_CLASS_FILE_LOAD_HOOK, nullptr);
+    m_ti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_CLASS_PREPARE, nullptr);
     m_ti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_VM_DEATH, nullptr);
 }
 
 java::~java() {
     if (m_ti) {
         m_ti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_CLASS_FILE_LOAD_HOOK, nullptr);
+        m_ti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_CLASS_PREPARE, nullptr);
         m_ti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_VM_DEATH, nullptr);
         m_ti->RelinquishCapabilities(&caps);
     }
 }
 
-jclass java::define_class(const char* name, jobject class_loader, jbyte* buffer, jsize size) {
-    auto clazz = m_env->DefineClass(name, class_loader, buffer, size);
+jclass java::define_class(const char* name, jobject class_loader, const jbyte* buffer, jsize size) {
+    auto env = this->env();
+    auto clazz = env->DefineClass(name, class_loader, buffer, size);
 
     if (clazz != nullptr) {
-        static jclass klass = m_env->FindClass("java/lang/Class");
-        static jmethodID getName = m_env->GetMethodID(klass, "getName", "()Ljava/lang/String;");
+        auto name = class_get_name::call(env, clazz);
+		const char* className = env->GetStringUTFChars(name, nullptr);
+
+		index(env, std::string(className), clazz);
+
+		env->ReleaseStringUTFChars(name, className);
+    }
+
+    return clazz;
+}
+
+void java::define_embedded(jobject system_loader, bool (*wanted)(std::string_view name)) {
+    auto& classes = embedded::classes;
+
+    // written by whichever thread defined the class, read by the next level after the join.
+    // classes defined by an earlier call count as well
+    std::vector<char> defined(classes.size(), false);
+    for (size_t i = 0; i < classes.size(); i++)
+        defined[i] = !wanted(classes[i].name) && is_loaded(dotted_name(classes[i].name));
 
-        auto name = static_cast<jstring>(m_env->CallObjectMethod(clazz, getName));
-		const char* className = m_env->GetStringUTFChars(name, nullptr);
+    // local refs don't cross threads
+    auto loader = env()->NewGlobalRef(system_loader);
 
-		class_map.emplace(std::string(className), clazz);
+    auto define = [&](size_t i) {
+        auto& info = classes[i];
+        if (!wanted(info.name))
+            return;
 
-		m_env->ReleaseStringUTFChars(name, className);
+        for (auto dependency : info.dependencies) {
+            if (!defined[dependency]) {
+                std::cerr << "Skipping class " << info.name << ", " << classes[dependency].name << " failed to define" << std::endl;
+                return;
+            }
+        }
+
+        auto env = this->env();
+
+        // probe calls get injected into classes from any loader, so that one goes where all of them can see it
+        auto is_probes = info.name == PROBES;
+
+        auto bytes = class_file(info);
+        if (bytes.empty())
+            return;
+
+        auto clazz = define_class(
+            info.name,
+            is_probes ? nullptr : loader,
+            reinterpret_cast<const jbyte*>(bytes.data()),
+            bytes.size()
+        );
+
+        if (clazz == nullptr) {
+            std::cerr << "Failed to define class " << info.name << std::endl;
+
+            if (env->ExceptionCheck()) {
+                env->ExceptionDescribe();
+            }
+
+            return;
+        }
+
+        register_natives(env, info.name, clazz);
+
+        env->DeleteLocalRef(clazz);
+        defined[i] = true;
+    };
+
+    // classes come sorted by level and only depend on lower ones, so each level can go all at once
+    for (size_t begin = 0; begin < classes.size();) {
+        auto end = begin;
+        while (end < classes.size() && classes[end].level == classes[begin].level)
+            end++;
+
+        std::atomic<size_t> next = begin;
+        auto work = [&] {
+            for (size_t i; (i = next.fetch_add(1)) < end;)
+                define(i);
+        };
+
+        // small levels aren't worth a thread, this thread always takes part
+        auto helpers = std::min<size_t>(std::thread::hardware_concurrency(), (end - begin) / PARALLEL_LEVEL);
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < helpers; i++)
+            threads.emplace_back(work);
+
+        work();
+
+        for (auto& thread : threads)
+            thread.join();
+
+        begin = end;
     }
 
+    env()->DeleteGlobalRef(loader);
+}
+
+jclass java::define_embedded_class(std::string_view name, jobject loader) {
+    auto pos = embedded_index.find(name);
+    if (pos == embedded_index.end())
+        return nullptr;
+
+    auto& info = embedded::classes[pos->second];
+
+    auto bytes = class_file(info);
+    if (bytes.empty())
+        return nullptr;
+
+    auto clazz = define_class(info.name, loader, reinterpret_cast<const jbyte*>(bytes.data()), bytes.size());
+    if (clazz != nullptr)
+        register_natives(env(), info.name, clazz);
+
+    // a failed definition leaves its LinkageError pending, which findClass rethrows as-is
     return clazz;
 }
 
+jclass java::find_class(std::string name) {
+    if (auto clazz = get_class(name))
+        return clazz;
+
+    auto internal_name = name;
+    std::replace(internal_name.begin(), internal_name.end(), '.', '/');
+    if (embedded_loader == nullptr || !embedded_index.contains(internal_name))
+        return nullptr;
+
+    auto env = this->env();
+
+    // through loadClass, so the loader's lock is held and nobody defines it twice
+    auto j_name = env->NewStringUTF(name.c_str());
+    auto clazz = load_class::call(env, embedded_loader, j_name);
+    env->DeleteLocalRef(j_name);
+
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        return nullptr;
+    }
+
+    env->DeleteLocalRef(clazz);
+
+    // defining it put it into the index
+    return get_class(name);
+}
+
 JavaVM* java::jvm() {
     return m_jvm;
 }
 
+// set for threads this library attached, which get detached again when they exit
+struct thread_env {
+    JNIEnv* env = nullptr;
+    // not java::get(), threads may exit while the constructor is still running
+    JavaVM* attached = nullptr;
+
+    ~thread_env() {
+        if (attached != nullptr)
+            attached->DetachCurrentThread();
+    }
+};
+
+static thread_local thread_env current_env;
+
 JNIEnv* java::env() {
-    return m_env;
+    if (current_env.env != nullptr)
+        return current_env.env;
+
+    JNIEnv* env;
+    auto status = m_jvm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6);
+
+    if (status == JNI_EDETACHED) {
+        // daemon, so our own threads never keep the JVM from shutting down
+        if (m_jvm->AttachCurrentThreadAsDaemon(reinterpret_cast<void**>(&env), nullptr) != JNI_OK)
+            return nullptr;
+
+        current_env.attached = m_jvm;
+    } else if (status != JNI_OK) {
+        return nullptr;
+    }
+
+    current_env.env = env;
+    return env;
 }
 
 jvmtiEnv* java::ti() {
@@ -249,47 +587,199 @@ void java::dump() {
         return;
     }
 
-    const jclass klass = m_env->FindClass("java/lang/Class");
-	const jmethodID getName = m_env->GetMethodID(klass, "getName", "()Ljava/lang/String;");
+    auto env = this->env();
+
+    if (members::id_of(env, class_get_name::slot) == nullptr)
+        return;
+
+    static frame_counter counter("dump");
+
+    for (int batch = 0; batch < count; batch += DUMP_BATCH) {
+        // one frame per batch, so the names of tens of thousands of classes never pile up at once
+        local_frame frame(env, counter, DUMP_BATCH);
 
-	if (getName == nullptr) {
-	    return;
-	}
+        for (int i = batch; i < std::min(count, batch + DUMP_BATCH); i++) {
+            auto clazz = loaded_classes[i];
 
-    for (int i = 0; i < count; i++) {
-        auto ref = reinterpret_cast<jclass>(m_env->NewGlobalRef(loaded_classes[i]));
+            const auto name = local_frame::track(class_get_name::call(env, clazz));
+            const char* className = env->GetStringUTFChars(name, nullptr);
 
-        const auto name = static_cast<jstring>(m_env->CallObjectMethod(ref, getName));
-		const char* className = m_env->GetStringUTFChars(name, nullptr);
+            index(env, std::string(className), clazz);
 
-		class_map.emplace(std::string(className), ref);
+            env->ReleaseStringUTFChars(name, className);
 
-		m_env->ReleaseStringUTFChars(name, className);
+            // GetLoadedClasses hands out a local ref per class in the caller's frame, drop them as we go
+            env->DeleteLocalRef(clazz);
+        }
     }
 
     m_ti->Deallocate(reinterpret_cast<unsigned char*>(loaded_classes));
 }
 
+bool java::index(JNIEnv* env, std::string name, jclass clazz) {
+    std::unique_lock lock(class_lock);
+
+    auto [pos, inserted] = class_map.try_emplace(std::move(name), nullptr);
+    if (!inserted) {
+        // a class of that name from a loader that has since been collected, the new one takes its place
+        if (!env->IsSameObject(pos->second, nullptr))
+            return false;
+
+        env->DeleteWeakGlobalRef(pos->second);
+        pos->second = static_cast<jclass>(env->NewWeakGlobalRef(clazz));
+        return true;
+    }
+
+    pos->second = static_cast<jclass>(env->NewWeakGlobalRef(clazz));
+    class_index.push_back(&*pos);
+
+    return true;
+}
+
+void java::sort_index() {
+    if (index_sorted == class_index.size())
+        return;
+
+    auto by_name = [](auto a, auto b) { return a->first < b->first; };
+    auto tail = class_index.begin() + index_sorted;
+
+    std::sort(tail, class_index.end(), by_name);
+    std::inplace_merge(class_index.begin(), tail, class_index.end(), by_name);
+
+    index_sorted = class_index.size();
+}
+
+void java::prune_index(JNIEnv* env, const std::unordered_set<class_entry*>& cleared) {
+    if (cleared.empty())
+        return;
+
+    // the index points into the map, so it goes first. erasing keeps it sorted
+    sort_index();
+    std::erase_if(class_index, [&](auto entry) { return cleared.contains(entry); });
+    index_sorted = class_index.size();
+
+    for (auto entry : cleared) {
+        env->DeleteWeakGlobalRef(entry->second);
+        class_map.erase(class_map.find(entry->first));
+    }
+}
+
 void java::cache(std::string name, jclass clazz) {
-    if (!class_map.contains(name))
-        class_map.emplace(name, clazz);
+    index(env(), std::move(name), clazz);
 }
 
 jclass java::get_class(std::string name) {
+    auto env = this->env();
+    std::shared_lock lock(class_lock);
+
     auto pos = class_map.find(name);
-    if (pos == class_map.end()) {
-        // dump();
-
-        // auto pos2 = class_map.find(name);
-        // if (pos2 == class_map.end()) {
-        //     return nullptr;
-        // } else {
-        //     return pos2->second;
-        // }
+    if (pos == class_map.end())
         return nullptr;
-    } else {
-        return pos->second;
+
+    // null once collected, the entry goes away with the next query that walks over it
+    return static_cast<jclass>(local_frame::track(env->NewLocalRef(pos->second)));
+}
+
+bool java::is_loaded(std::string name) {
+    auto env = this->env();
+    std::shared_lock lock(class_lock);
+
+    auto pos = class_map.find(name);
+    return pos != class_map.end() && !env->IsSameObject(pos->second, nullptr);
+}
+
+std::vector<std::pair<std::string, jclass>> java::find_classes(std::string_view query) {
+    auto env = this->env();
+    std::unique_lock lock(class_lock);
+
+    sort_index();
+
+    // everything matching the pattern shares its literal prefix, so only that range is walked
+    auto prefix = pattern::literal_prefix(query);
+    auto pos = std::lower_bound(class_index.begin(), class_index.end(), prefix, [](auto entry, auto& key) { return entry->first < key; });
+
+    std::vector<std::pair<std::string, jclass>> found;
+    std::unordered_set<class_entry*> cleared;
+
+    for (; pos != class_index.end() && (*pos)->first.starts_with(prefix); ++pos) {
+        auto& [name, clazz] = **pos;
+        if (!pattern::match(query, name))
+            continue;
+
+        // promoted right away, checking the weak ref first would race with the collector
+        auto local = static_cast<jclass>(local_frame::track(env->NewLocalRef(clazz)));
+        if (local == nullptr)
+            cleared.insert(*pos);
+        else
+            found.emplace_back(name, local);
     }
+
+    prune_index(env, cleared);
+    return found;
+}
+
+jvmtiError java::retransform_classes(std::string_view query, size_t& count) {
+    // the index only holds weak refs, JVMTI gets the strong local ones find_classes
+    // promoted them to, so nothing collected in between ends up in the batch
+    static frame_counter counter("retransform pattern");
+    local_frame frame(env(), counter, 256);
+
+    std::vector<jclass> classes;
+    for (auto& [name, clazz] : find_classes(query)) {
+        jboolean modifiable = false;
+        if (m_ti->IsModifiableClass(clazz, &modifiable) == JVMTI_ERROR_NONE && modifiable)
+            classes.push_back(clazz);
+    }
+
+    count = classes.size();
+    if (classes.empty())
+        return JVMTI_ERROR_NONE;
+
+    return m_ti->RetransformClasses(static_cast<jint>(classes.size()), classes.data());
+}
+
+jvmtiError java::redefine_classes(const std::vector<std::pair<std::string, std::vector<unsigned char>>>& classes) {
+    if (classes.size() > static_cast<size_t>(std::numeric_limits<jint>::max()))
+        return JVMTI_ERROR_ILLEGAL_ARGUMENT;
+
+    // a local ref per class from get_class, held until the call
+    static frame_counter counter("redefine by name");
+    local_frame frame(env(), counter, static_cast<jint>(classes.size()) + 1);
+
+    std::vector<jvmtiClassDefinition> definitions;
+    definitions.reserve(classes.size());
+
+    for (auto& [name, bytes] : classes) {
+        if (bytes.size() > static_cast<size_t>(std::numeric_limits<jint>::max()))
+            return JVMTI_ERROR_ILLEGAL_ARGUMENT;
+
+        auto clazz = get_class(name);
+        if (clazz == nullptr) {
+            std::cerr << "Can't redefine " << name << ", it isn't loaded (anymore)." << std::endl;
+            return JVMTI_ERROR_INVALID_CLASS;
+        }
+
+        definitions.push_back(jvmtiClassDefinition {
+            .klass = clazz,
+            .class_byte_count = static_cast<jint>(bytes.size()),
+            .class_bytes = bytes.data()
+        });
+    }
+
+    if (definitions.empty())
+        return JVMTI_ERROR_NONE;
+
+    return m_ti->RedefineClasses(static_cast<jint>(definitions.size()), definitions.data());
+}
+
+std::string java::error_name(jvmtiError error) {
+    char* name = nullptr;
+    if (m_ti->GetErrorName(error, &name) != JVMTI_ERROR_NONE || name == nullptr)
+        return std::to_string(error);
+
+    std::string value(name);
+    m_ti->Deallocate(reinterpret_cast<unsigned char*>(name));
+    return value;
 }
 
 java* java::get() {
@@ -298,29 +788,249 @@ java* java::get() {
     return &instance;
 }
 
-load_status java::load_jar(std::filesystem::path path, std::string agent_class) {
-    auto clazz = get_class("cat.psychward.goober.Utility");
+// the old way, for jars the native reader can't handle
+load_status java::load_jar_fallback(std::filesystem::path path, std::string agent_class, jobject& agent) {
+    auto env = this->env();
 
-    if (clazz == 0) {
+    if (members::id_of(env, load_agent::slot) == nullptr) {
         return load_status::CLASS_NOT_LOADED;
     }
 
-    auto load_agent = m_env->GetStaticMethodID(clazz, "loadAgent", "(Ljava/lang/String;Ljava/lang/String;)V");
+    // the IPC thread never returns to Java, so nothing would ever free these otherwise
+    static frame_counter counter("loadAgent");
+    local_frame frame(env, counter, 4);
+
+    auto path_str = path.string();
+
+    auto path_j_str = local_frame::track(env->NewStringUTF(path_str.c_str()));
+    auto agent_class_j_str = local_frame::track(env->NewStringUTF(agent_class.c_str()));
+
+    auto instance = local_frame::track(load_agent::call(env, path_j_str, agent_class_j_str));
+
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
+        return load_status::EXCEPTION_CAUGHT;
+    }
+
+    agent = env->NewGlobalRef(instance);
+    return load_status::OK;
+}
+
+void java::define_jar_classes(const jar_file& jar, jobject loader) {
+    std::vector<std::string> names;
+    for (auto& entry : jar.list()) {
+        if (!entry.name.ends_with(".class") || entry.name.starts_with("META-INF/")
+            || entry.name.ends_with("module-info.class") || entry.name.ends_with("package-info.class"))
+            continue;
+
+        names.push_back(dotted_name(entry.name.substr(0, entry.name.size() - 6)));
+    }
+
+    // through loadClass rather than DefineClass, so superclasses coming later in
+    // the jar get defined on demand and nothing is defined twice across threads
+    std::atomic<size_t> next = 0;
+    auto work = [&] {
+        auto env = this->env();
+
+        for (size_t i; (i = next.fetch_add(1)) < names.size();) {
+            auto j_name = env->NewStringUTF(names[i].c_str());
+            auto clazz = load_class::call(env, loader, j_name);
+            env->DeleteLocalRef(j_name);
+
+            if (env->ExceptionCheck()) {
+                std::cerr << "Failed to define agent class " << names[i] << std::endl;
+                env->ExceptionDescribe();
+                continue;
+            }
+
+            env->DeleteLocalRef(clazz);
+        }
+    };
+
+    auto helpers = std::min<size_t>(std::thread::hardware_concurrency(), names.size() / PARALLEL_JAR);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < helpers; i++)
+        threads.emplace_back(work);
+
+    work();
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+jobject java::define_jar(std::filesystem::path path) {
+    jar_file jar;
+    if (auto status = jar.open(path); status != jar_status::OK) {
+        std::cerr << "Failed to open " << path << " natively (" << status << "), using a URLClassLoader instead." << std::endl;
+        return nullptr;
+    }
+
+    auto env = this->env();
+
+    if (members::id_of(env, new_agent_loader::slot) == nullptr || members::id_of(env, agent_loader_jar::slot) == nullptr) {
+        return nullptr;
+    }
+
+    static frame_counter counter("defineJar");
+    local_frame frame(env, counter, 4);
+
+    // agents link against Utility, so the embedded loader has to be the parent if there is one
+    auto parent = embedded_loader != nullptr ? embedded_loader : local_frame::track(get_system_class_loader::call(env));
+
     auto path_str = path.string();
+    auto path_j_str = local_frame::track(env->NewStringUTF(path_str.c_str()));
+
+    auto loader = local_frame::track(new_agent_loader::create(env, parent, path_j_str));
+    if (loader == nullptr) {
+        env->ExceptionDescribe();
+        return nullptr;
+    }
+
+    // helper threads need a ref that isn't tied to this one
+    auto global_loader = env->NewGlobalRef(loader);
+
+    agent_loader_jar::set(env, global_loader, reinterpret_cast<jlong>(&jar));
+    define_jar_classes(jar, global_loader);
+    agent_loader_jar::set(env, global_loader, 0);
+
+    // whatever failed to define is gone with the jar, the agent gets a ClassNotFoundException for it
+    return global_loader;
+}
+
+load_status java::start_agent(jobject loader, std::string agent_class, jobject& agent) {
+    auto env = this->env();
+
+    if (members::id_of(env, start_agent::slot) == nullptr) {
+        return load_status::CLASS_NOT_LOADED;
+    }
 
-    auto path_j_str = m_env->NewStringUTF(path_str.c_str());
-    auto agent_class_j_str = m_env->NewStringUTF(agent_class.c_str());
+    static frame_counter counter("startAgent");
+    local_frame frame(env, counter, 4);
 
-    m_env->CallStaticVoidMethod(clazz, load_agent, path_j_str, agent_class_j_str);
+    auto agent_class_j_str = local_frame::track(env->NewStringUTF(agent_class.c_str()));
+    auto instance = local_frame::track(start_agent::call(env, loader, agent_class_j_str));
 
-    if (m_env->ExceptionCheck()) {
-        m_env->ExceptionDescribe();
+    if (env->ExceptionCheck()) {
+        env->ExceptionDescribe();
         return load_status::EXCEPTION_CAUGHT;
     }
 
+    agent = env->NewGlobalRef(instance);
     return load_status::OK;
 }
 
+load_status java::load_jar(std::filesystem::path path, std::string agent_class, jobject& agent) {
+    auto loader = define_jar(path);
+    if (loader == nullptr)
+        return load_jar_fallback(path, agent_class, agent);
+
+    auto status = start_agent(loader, agent_class, agent);
+
+    // the agent's classes keep their loader alive from here on
+    env()->DeleteGlobalRef(loader);
+    return status;
+}
+
+void java::stop_agent(jobject agent) {
+    auto env = this->env();
+
+    if (members::id_of(env, stop_agent::slot) == nullptr)
+        return;
+
+    stop_agent::call(env, agent);
+
+    // the agent is on its way out either way, a failing onAgentUnload doesn't change that
+    if (env->ExceptionCheck())
+        env->ExceptionDescribe();
+}
+
+size_t java::forget_loader(jobject loader) {
+    auto env = this->env();
+
+    // a GetClassLoader per indexed class takes a while, class loading only has to wait for the erase.
+    // collected classes go too while we're at it, they'd only get in the way of a reload
+    std::vector<std::pair<std::string, jclass>> candidates;
+    size_t count = 0;
+
+    {
+        std::shared_lock lock(class_lock);
+
+        for (auto& [name, clazz] : class_map) {
+            auto local = env->NewLocalRef(clazz);
+            if (local == nullptr) {
+                candidates.emplace_back(name, clazz);
+                continue;
+            }
+
+            jobject defining_loader = nullptr;
+            if (m_ti->GetClassLoader(static_cast<jclass>(local), &defining_loader) == JVMTI_ERROR_NONE && env->IsSameObject(defining_loader, loader)) {
+                candidates.emplace_back(name, clazz);
+                count++;
+            }
+
+            if (defining_loader != nullptr)
+                env->DeleteLocalRef(defining_loader);
+            env->DeleteLocalRef(local);
+        }
+    }
+
+    // IDs resolved against the loader's classes would outlive them otherwise, the registry
+    // holds their class and resolves against whatever has the name next time
+    for (auto& [name, clazz] : candidates) {
+        auto internal_name = name;
+        std::replace(internal_name.begin(), internal_name.end(), '.', '/');
+        members::registry::get()->invalidate(env, internal_name);
+    }
+
+    std::unique_lock lock(class_lock);
+
+    // entries pruned or replaced in the meantime aren't ours to drop anymore
+    std::unordered_set<class_entry*> defined;
+    for (auto& [name, clazz] : candidates) {
+        auto pos = class_map.find(name);
+        if (pos != class_map.end() && pos->second == clazz)
+            defined.insert(&*pos);
+    }
+
+    prune_index(env, defined);
+    return count;
+}
+
+size_t java::index_loader(jobject loader) {
+    auto env = this->env();
+
+    jint count = 0;
+    jclass* classes = nullptr;
+    if (m_ti->GetClassLoaderClasses(loader, &count, &classes) != JVMTI_ERROR_NONE) {
+        std::cerr << "Failed to list the classes of an agent loader." << std::endl;
+        return 0;
+    }
+
+    size_t indexed = 0;
+    for (jint i = 0; i < count; i++) {
+        auto clazz = classes[i];
+
+        // the loader is only the initiating one for everything it delegated
+        jobject defining_loader = nullptr;
+        char* signature = nullptr;
+        if (m_ti->GetClassLoader(clazz, &defining_loader) == JVMTI_ERROR_NONE && env->IsSameObject(defining_loader, loader)
+            && m_ti->GetClassSignature(clazz, &signature, nullptr) == JVMTI_ERROR_NONE) {
+            if (index(env, signature_to_name(signature), clazz))
+                indexed++;
+
+            m_ti->Deallocate(reinterpret_cast<unsigned char*>(signature));
+        }
+
+        if (defining_loader != nullptr)
+            env->DeleteLocalRef(defining_loader);
+        env->DeleteLocalRef(clazz);
+    }
+
+    m_ti->Deallocate(reinterpret_cast<unsigned char*>(classes));
+    return indexed;
+}
+
 std::ostream& operator<<(std::ostream& stream, load_status status) {
 
     switch (status) {
@@ -333,6 +1043,9 @@ std::ostream& operator<<(std::ostream& stream, load_status status) {
     case load_status::CLASS_NOT_LOADED:
         stream << "Class not loaded";
         break;
+    case load_status::AGENT_NOT_FOUND:
+        stream << "Agent not found";
+        break;
     }
 
     return stream;
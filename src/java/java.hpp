@@ -4,24 +4,49 @@
 #include "jvmti.h"
 #include <cstdint>
 #include <filesystem>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class jar_file;
 
 enum class load_status : uint8_t {
     OK = 0,
     EXCEPTION_CAUGHT,
-    CLASS_NOT_LOADED
+    CLASS_NOT_LOADED,
+    AGENT_NOT_FOUND
 };
 
 std::ostream& operator<<(std::ostream& stream, load_status status);
 
+// name and weak global ref of one indexed class
+using class_entry = std::pair<const std::string, jclass>;
+
 class java {
 
+    // weak global refs, so the index never keeps a class or its loader alive.
+    // cleared ones are pruned as queries come across them
     std::unordered_map<std::string, jclass> class_map;
+
+    // ordered view over the class_map entries for prefix/glob lookups. new
+    // entries are appended after the first `index_sorted`, queries sort just
+    // that tail and merge it in
+    std::vector<class_entry*> class_index;
+    size_t index_sorted;
+
+    std::shared_mutex class_lock;
     bool dumped;
 
+    // EmbeddedClassLoader instance, null if everything was defined up front instead
+    jobject embedded_loader;
+    // internal name -> index into embedded::classes
+    std::unordered_map<std::string_view, size_t> embedded_index;
+
     JavaVM* m_jvm;
-    JNIEnv* m_env;
     jvmtiEnv* m_ti;
 
     jvmtiCapabilities caps;
@@ -29,22 +54,82 @@ class java {
 
     java();
 
-    jclass define_class(const char* name, jobject class_loader, jbyte* buffer, jsize size);
+    jclass define_class(const char* name, jobject class_loader, const jbyte* buffer, jsize size);
+
+    // the wanted embedded classes level by level, the classes within a level in parallel
+    void define_embedded(jobject system_loader, bool (*wanted)(std::string_view name));
 
     void dump();
 
+    load_status load_jar_fallback(std::filesystem::path path, std::string agent_class, jobject& agent);
+
+    // every class of the jar, in parallel through the AgentClassLoader
+    void define_jar_classes(const jar_file& jar, jobject loader);
+
+    // takes a weak ref of its own, false if the name is already indexed by a live class
+    bool index(JNIEnv* env, std::string name, jclass clazz);
+
+    // class_lock held exclusively
+    void sort_index();
+    void prune_index(JNIEnv* env, const std::unordered_set<class_entry*>& cleared);
+
 public:
 
     static java* get();
     ~java();
 
-    load_status load_jar(std::filesystem::path path, std::string agent_class);
+    // define_jar and start_agent, or a URLClassLoader if the jar can't be read natively.
+    // `agent` is a global ref to the started agent
+    load_status load_jar(std::filesystem::path path, std::string agent_class, jobject& agent);
+
+    // global ref to an AgentClassLoader with every class of the jar defined, null
+    // if the jar can't be read natively
+    jobject define_jar(std::filesystem::path path);
+
+    // instantiates the agent class and calls its onAgentLoad
+    load_status start_agent(jobject loader, std::string agent_class, jobject& agent);
+
+    // onAgentUnload, if the agent has one, then closes its loader
+    void stop_agent(jobject agent);
+
+    // drops the index entries and member IDs of every class the loader defined, so
+    // they don't pin it. returns how many there were
+    size_t forget_loader(jobject loader);
+
+    // indexes every class the loader defined, for classes that were prepared while
+    // an older class of the same name was still indexed. returns how many it took
+    size_t index_loader(jobject loader);
 
     void cache(std::string name, jclass clazz);
 
+    // a new local ref, null if the class isn't loaded or has been collected since.
+    // callers that hold on to it past the current frame need a global ref of their own
     jclass get_class(std::string name);
 
+    // get_class without handing out a ref
+    bool is_loaded(std::string name);
+
+    // get_class, defining the class first if it's an embedded one nobody has used yet
+    jclass find_class(std::string name);
+
+    // called back by EmbeddedClassLoader.findClass
+    jclass define_embedded_class(std::string_view name, jobject loader);
+
+    // local refs like get_class, one per class found. bulk callers push a local_frame around it
+    std::vector<std::pair<std::string, jclass>> find_classes(std::string_view pattern);
+
+    // every modifiable class matching the pattern in a single RetransformClasses call
+    jvmtiError retransform_classes(std::string_view pattern, size_t& count);
+
+    // by Class.getName() style name, all in a single RedefineClasses call
+    jvmtiError redefine_classes(const std::vector<std::pair<std::string, std::vector<unsigned char>>>& classes);
+
+    std::string error_name(jvmtiError error);
+
     JavaVM* jvm();
+
+    // env of the calling thread, attaching it as a daemon first if needed.
+    // threads attached this way are detached again when they exit
     JNIEnv* env();
     jvmtiEnv* ti();
 
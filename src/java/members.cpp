@@ -0,0 +1,150 @@
+#include "members.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace members {
+
+member_slot::member_slot(const char* class_name, const char* name, const char* descriptor, member_kind kind)
+    : class_name(class_name), name(name), descriptor(descriptor), kind(kind), clazz(nullptr), id(nullptr) {
+    registry::get()->add(this);
+}
+
+registry* registry::get() {
+    static registry instance;
+    return &instance;
+}
+
+void registry::add(member_slot* slot) {
+    std::lock_guard guard(lock);
+    slots.push_back(slot);
+}
+
+void registry::bind(std::function<jclass(const std::string&, bool define)> finder) {
+    std::lock_guard guard(lock);
+    find_class = std::move(finder);
+}
+
+jclass registry::class_of(JNIEnv* env, const std::string& name, bool define) {
+    auto pos = classes.find(name);
+    if (pos != classes.end())
+        return pos->second;
+
+    jclass found = nullptr;
+    if (find_class) {
+        auto dotted = name;
+        std::replace(dotted.begin(), dotted.end(), '/', '.');
+        found = find_class(dotted, define);
+    }
+
+    // not loaded yet, which is fine until somebody actually uses it
+    if (found == nullptr && !define)
+        return nullptr;
+
+    if (found == nullptr) {
+        found = env->FindClass(name.c_str());
+
+        if (env->ExceptionCheck())
+            env->ExceptionClear();
+    }
+
+    if (found == nullptr)
+        return nullptr;
+
+    // both the index and FindClass hand out local refs
+    auto ref = static_cast<jclass>(env->NewGlobalRef(found));
+    env->DeleteLocalRef(found);
+
+    classes.emplace(name, ref);
+    return ref;
+}
+
+bool registry::resolve_locked(JNIEnv* env, member_slot* slot, bool define) {
+    if (slot->id.load(std::memory_order_relaxed) != nullptr)
+        return true;
+
+    auto clazz = class_of(env, slot->class_name, define);
+    if (clazz == nullptr) {
+        if (define)
+            std::cerr << "Failed to find class " << slot->class_name << std::endl;
+
+        return !define;
+    }
+
+    void* id = nullptr;
+    switch (slot->kind) {
+    case member_kind::METHOD:
+        id = env->GetMethodID(clazz, slot->name, slot->descriptor);
+        break;
+    case member_kind::STATIC_METHOD:
+        id = env->GetStaticMethodID(clazz, slot->name, slot->descriptor);
+        break;
+    case member_kind::FIELD:
+        id = env->GetFieldID(clazz, slot->name, slot->descriptor);
+        break;
+    }
+
+    if (id == nullptr) {
+        // NoSuchMethodError and friends, nothing the caller could do about them
+        if (env->ExceptionCheck())
+            env->ExceptionClear();
+
+        std::cerr << "Failed to find " << slot->class_name << "." << slot->name << slot->descriptor << std::endl;
+        return false;
+    }
+
+    slot->clazz.store(clazz, std::memory_order_relaxed);
+    slot->id.store(id, std::memory_order_release);
+    return true;
+}
+
+bool registry::resolve_all(JNIEnv* env) {
+    std::lock_guard guard(lock);
+
+    bool resolved = true;
+    for (auto slot : slots)
+        resolved &= resolve_locked(env, slot, false);
+
+    return resolved;
+}
+
+void* registry::resolve(JNIEnv* env, member_slot* slot) {
+    std::lock_guard guard(lock);
+
+    resolve_locked(env, slot, true);
+    return slot->id.load(std::memory_order_relaxed);
+}
+
+void registry::invalidate(JNIEnv* env, std::string_view class_name) {
+    std::lock_guard guard(lock);
+
+    auto pos = classes.find(std::string(class_name));
+    if (pos == classes.end())
+        return;
+
+    for (auto slot : slots) {
+        if (slot->class_name != class_name)
+            continue;
+
+        slot->id.store(nullptr, std::memory_order_relaxed);
+        slot->clazz.store(nullptr, std::memory_order_relaxed);
+    }
+
+    env->DeleteGlobalRef(pos->second);
+    classes.erase(pos);
+}
+
+void registry::clear(JNIEnv* env) {
+    std::lock_guard guard(lock);
+
+    for (auto slot : slots) {
+        slot->id.store(nullptr, std::memory_order_relaxed);
+        slot->clazz.store(nullptr, std::memory_order_relaxed);
+    }
+
+    for (auto& [name, clazz] : classes)
+        env->DeleteGlobalRef(clazz);
+
+    classes.clear();
+}
+
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "jni.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Typed JNI members. A member is declared once with its C++ signature,
+//
+//     using on_load = members::method<"cat/psychward/goober/ClassLoadListener", "onLoad", members::bytes(members::string, members::bytes)>;
+//
+// the descriptor ("(Ljava/lang/String;[B)[B") is built at compile time from
+// it, and the ID lives in a slot owned by the registry. Slots are resolved in
+// one go at startup, so a call costs a load and a never-taken branch. jmethodIDs
+// survive RedefineClasses, the registry only has to start over once the class
+// itself goes away.
+namespace members {
+
+template<size_t N>
+struct fixed_string {
+    char value[N] {};
+
+    constexpr fixed_string() = default;
+
+    constexpr fixed_string(const char (&text)[N]) {
+        std::copy_n(text, N, value);
+    }
+};
+
+template<size_t A, size_t B>
+constexpr fixed_string<A + B - 1> operator+(const fixed_string<A>& left, const fixed_string<B>& right) {
+    fixed_string<A + B - 1> joined;
+    std::copy_n(left.value, A - 1, joined.value);
+    std::copy_n(right.value, B, joined.value + A - 1);
+    return joined;
+}
+
+// reference types, by internal name
+template<fixed_string Name>
+struct object {};
+
+template<typename T>
+struct array {};
+
+using string = object<"java/lang/String">;
+using clazz = object<"java/lang/Class">;
+using bytes = array<jbyte>;
+
+template<typename T>
+struct java_type;
+
+template<> struct java_type<void> { using jni = void; static constexpr fixed_string descriptor = "V"; };
+template<> struct java_type<jboolean> { using jni = jboolean; static constexpr fixed_string descriptor = "Z"; };
+template<> struct java_type<jbyte> { using jni = jbyte; static constexpr fixed_string descriptor = "B"; };
+template<> struct java_type<jchar> { using jni = jchar; static constexpr fixed_string descriptor = "C"; };
+template<> struct java_type<jshort> { using jni = jshort; static constexpr fixed_string descriptor = "S"; };
+template<> struct java_type<jint> { using jni = jint; static constexpr fixed_string descriptor = "I"; };
+template<> struct java_type<jlong> { using jni = jlong; static constexpr fixed_string descriptor = "J"; };
+template<> struct java_type<jfloat> { using jni = jfloat; static constexpr fixed_string descriptor = "F"; };
+template<> struct java_type<jdouble> { using jni = jdouble; static constexpr fixed_string descriptor = "D"; };
+
+template<fixed_string Name>
+struct java_type<object<Name>> {
+    using jni = jobject;
+    static constexpr auto descriptor = fixed_string("L") + Name + fixed_string(";");
+};
+
+template<> struct java_type<string> { using jni = jstring; static constexpr fixed_string descriptor = "Ljava/lang/String;"; };
+template<> struct java_type<clazz> { using jni = jclass; static constexpr fixed_string descriptor = "Ljava/lang/Class;"; };
+
+template<typename T>
+struct java_type<array<T>> {
+    using jni = jobjectArray;
+    static constexpr auto descriptor = fixed_string("[") + java_type<T>::descriptor;
+};
+
+template<> struct java_type<array<jboolean>> { using jni = jbooleanArray; static constexpr fixed_string descriptor = "[Z"; };
+template<> struct java_type<array<jbyte>> { using jni = jbyteArray; static constexpr fixed_string descriptor = "[B"; };
+template<> struct java_type<array<jchar>> { using jni = jcharArray; static constexpr fixed_string descriptor = "[C"; };
+template<> struct java_type<array<jshort>> { using jni = jshortArray; static constexpr fixed_string descriptor = "[S"; };
+template<> struct java_type<array<jint>> { using jni = jintArray; static constexpr fixed_string descriptor = "[I"; };
+template<> struct java_type<array<jlong>> { using jni = jlongArray; static constexpr fixed_string descriptor = "[J"; };
+template<> struct java_type<array<jfloat>> { using jni = jfloatArray; static constexpr fixed_string descriptor = "[F"; };
+template<> struct java_type<array<jdouble>> { using jni = jdoubleArray; static constexpr fixed_string descriptor = "[D"; };
+
+template<typename T>
+using jni_t = typename java_type<T>::jni;
+
+enum class member_kind : uint8_t {
+    METHOD = 0,
+    STATIC_METHOD,
+    FIELD
+};
+
+struct member_slot {
+    const char* class_name;
+    const char* name;
+    const char* descriptor;
+    member_kind kind;
+
+    // global ref, shared by every slot of the same class
+    std::atomic<jclass> clazz;
+    // jmethodID or jfieldID, published after clazz
+    std::atomic<void*> id;
+
+    member_slot(const char* class_name, const char* name, const char* descriptor, member_kind kind);
+};
+
+// Owns every slot and the class refs behind them. Holding the class keeps its
+// IDs valid, invalidate() lets go of it again.
+class registry {
+
+    // recursive, resolving may define a class whose definition needs a member in turn
+    std::recursive_mutex lock;
+    std::vector<member_slot*> slots;
+    // internal name -> global ref
+    std::unordered_map<std::string, jclass> classes;
+
+    // the class index of java, FindClass is only the fallback. `define` allows
+    // lazily defined embedded classes to be defined on the spot
+    std::function<jclass(const std::string&, bool define)> find_class;
+
+    registry() = default;
+
+    jclass class_of(JNIEnv* env, const std::string& name, bool define);
+    bool resolve_locked(JNIEnv* env, member_slot* slot, bool define);
+
+public:
+
+    static registry* get();
+
+    void add(member_slot* slot);
+    void bind(std::function<jclass(const std::string&, bool define)> finder);
+
+    // members of classes that are loaded already, everything else resolves on
+    // first use. false if any of them couldn't be found
+    bool resolve_all(JNIEnv* env);
+    void* resolve(JNIEnv* env, member_slot* slot);
+
+    // for a class that is about to go away, its members resolve again on next use
+    void invalidate(JNIEnv* env, std::string_view class_name);
+    void clear(JNIEnv* env);
+
+};
+
+inline void* id_of(JNIEnv* env, member_slot& slot) {
+    auto id = slot.id.load(std::memory_order_acquire);
+    if (id == nullptr) [[unlikely]]
+        id = registry::get()->resolve(env, &slot);
+
+    return id;
+}
+
+template<fixed_string Class, fixed_string Name, typename Signature>
+class method;
+
+template<fixed_string Class, fixed_string Name, typename R, typename... Args>
+class method<Class, Name, R(Args...)> {
+
+public:
+
+    static constexpr auto descriptor = (fixed_string("(") + ... + java_type<Args>::descriptor) + fixed_string(")") + java_type<R>::descriptor;
+
+    static inline member_slot slot { Class.value, Name.value, descriptor.value, member_kind::METHOD };
+
+    static jni_t<R> call(JNIEnv* env, jobject self, jni_t<Args>... args) {
+        auto id = static_cast<jmethodID>(id_of(env, slot));
+
+        if constexpr (std::is_void_v<R>)
+            env->CallVoidMethod(self, id, args...);
+        else if constexpr (std::is_same_v<R, jboolean>)
+            return env->CallBooleanMethod(self, id, args...);
+        else if constexpr (std::is_same_v<R, jbyte>)
+            return env->CallByteMethod(self, id, args...);
+        else if constexpr (std::is_same_v<R, jchar>)
+            return env->CallCharMethod(self, id, args...);
+        else if constexpr (std::is_same_v<R, jshort>)
+            return env->CallShortMethod(self, id, args...);
+        else if constexpr (std::is_same_v<R, jint>)
+            return env->CallIntMethod(self, id, args...);
+        else if constexpr (std::is_same_v<R, jlong>)
+            return env->CallLongMethod(self, id, args...);
+        else if constexpr (std::is_same_v<R, jfloat>)
+            return env->CallFloatMethod(self, id, args...);
+        else if constexpr (std::is_same_v<R, jdouble>)
+            return env->CallDoubleMethod(self, id, args...);
+        else
+            return static_cast<jni_t<R>>(env->CallObjectMethod(self, id, args...));
+    }
+
+};
+
+template<fixed_string Class, fixed_string Name, typename Signature>
+class static_method;
+
+template<fixed_string Class, fixed_string Name, typename R, typename... Args>
+class static_method<Class, Name, R(Args...)> {
+
+public:
+
+    static constexpr auto descriptor = (fixed_string("(") + ... + java_type<Args>::descriptor) + fixed_string(")") + java_type<R>::descriptor;
+
+    static inline member_slot slot { Class.value, Name.value, descriptor.value, member_kind::STATIC_METHOD };
+
+    static jni_t<R> call(JNIEnv* env, jni_t<Args>... args) {
+        auto id = static_cast<jmethodID>(id_of(env, slot));
+        auto owner = slot.clazz.load(std::memory_order_relaxed);
+
+        if constexpr (std::is_void_v<R>)
+            env->CallStaticVoidMethod(owner, id, args...);
+        else if constexpr (std::is_same_v<R, jboolean>)
+            return env->CallStaticBooleanMethod(owner, id, args...);
+        else if constexpr (std::is_same_v<R, jbyte>)
+            return env->CallStaticByteMethod(owner, id, args...);
+        else if constexpr (std::is_same_v<R, jchar>)
+            return env->CallStaticCharMethod(owner, id, args...);
+        else if constexpr (std::is_same_v<R, jshort>)
+            return env->CallStaticShortMethod(owner, id, args...);
+        else if constexpr (std::is_same_v<R, jint>)
+            return env->CallStaticIntMethod(owner, id, args...);
+        else if constexpr (std::is_same_v<R, jlong>)
+            return env->CallStaticLongMethod(owner, id, args...);
+        else if constexpr (std::is_same_v<R, jfloat>)
+            return env->CallStaticFloatMethod(owner, id, args...);
+        else if constexpr (std::is_same_v<R, jdouble>)
+            return env->CallStaticDoubleMethod(owner, id, args...);
+        else
+            return static_cast<jni_t<R>>(env->CallStaticObjectMethod(owner, id, args...));
+    }
+
+};
+
+template<fixed_string Class, typename... Args>
+class constructor {
+
+public:
+
+    static constexpr auto descriptor = (fixed_string("(") + ... + java_type<Args>::descriptor) + fixed_string(")V");
+
+    static inline member_slot slot { Class.value, "<init>", descriptor.value, member_kind::METHOD };
+
+    static jobject create(JNIEnv* env, jni_t<Args>... args) {
+        auto id = static_cast<jmethodID>(id_of(env, slot));
+        return env->NewObject(slot.clazz.load(std::memory_order_relaxed), id, args...);
+    }
+
+};
+
+template<fixed_string Class, fixed_string Name, typename T>
+class field {
+
+public:
+
+    static constexpr auto descriptor = java_type<T>::descriptor;
+
+    static inline member_slot slot { Class.value, Name.value, descriptor.value, member_kind::FIELD };
+
+    static jni_t<T> get(JNIEnv* env, jobject self) {
+        auto id = static_cast<jfieldID>(id_of(env, slot));
+
+        if constexpr (std::is_same_v<T, jboolean>)
+            return env->GetBooleanField(self, id);
+        else if constexpr (std::is_same_v<T, jbyte>)
+            return env->GetByteField(self, id);
+        else if constexpr (std::is_same_v<T, jchar>)
+            return env->GetCharField(self, id);
+        else if constexpr (std::is_same_v<T, jshort>)
+            return env->GetShortField(self, id);
+        else if constexpr (std::is_same_v<T, jint>)
+            return env->GetIntField(self, id);
+        else if constexpr (std::is_same_v<T, jlong>)
+            return env->GetLongField(self, id);
+        else if constexpr (std::is_same_v<T, jfloat>)
+            return env->GetFloatField(self, id);
+        else if constexpr (std::is_same_v<T, jdouble>)
+            return env->GetDoubleField(self, id);
+        else
+            return static_cast<jni_t<T>>(env->GetObjectField(self, id));
+    }
+
+    static void set(JNIEnv* env, jobject self, jni_t<T> value) {
+        auto id = static_cast<jfieldID>(id_of(env, slot));
+
+        if constexpr (std::is_same_v<T, jboolean>)
+            env->SetBooleanField(self, id, value);
+        else if constexpr (std::is_same_v<T, jbyte>)
+            env->SetByteField(self, id, value);
+        else if constexpr (std::is_same_v<T, jchar>)
+            env->SetCharField(self, id, value);
+        else if constexpr (std::is_same_v<T, jshort>)
+            env->SetShortField(self, id, value);
+        else if constexpr (std::is_same_v<T, jint>)
+            env->SetIntField(self, id, value);
+        else if constexpr (std::is_same_v<T, jlong>)
+            env->SetLongField(self, id, value);
+        else if constexpr (std::is_same_v<T, jfloat>)
+            env->SetFloatField(self, id, value);
+        else if constexpr (std::is_same_v<T, jdouble>)
+            env->SetDoubleField(self, id, value);
+        else
+            env->SetObjectField(self, id, value);
+    }
+
+};
+
+}
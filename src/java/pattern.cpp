@@ -0,0 +1,49 @@
+#include "pattern.hpp"
+#include <string_view>
+
+namespace pattern {
+
+bool is_glob(std::string_view pattern) {
+    return pattern.find_first_of("*?") != std::string_view::npos;
+}
+
+std::string_view literal_prefix(std::string_view pattern) {
+    return pattern.substr(0, pattern.find_first_of("*?"));
+}
+
+static bool match_glob(std::string_view pattern, std::string_view name, char separator) {
+    while (!pattern.empty()) {
+        if (pattern[0] == '*') {
+            bool crosses = pattern.size() > 1 && pattern[1] == '*';
+            auto rest = pattern.substr(crosses ? 2 : 1);
+
+            for (size_t i = 0;; i++) {
+                if (match_glob(rest, name.substr(i), separator))
+                    return true;
+
+                if (i == name.size() || (!crosses && name[i] == separator))
+                    return false;
+            }
+        }
+
+        if (name.empty())
+            return false;
+
+        if (pattern[0] != name[0] && (pattern[0] != '?' || name[0] == separator))
+            return false;
+
+        pattern.remove_prefix(1);
+        name.remove_prefix(1);
+    }
+
+    return name.empty();
+}
+
+bool match(std::string_view pattern, std::string_view name, char separator) {
+    if (!is_glob(pattern))
+        return name.starts_with(pattern);
+
+    return match_glob(pattern, name, separator);
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string_view>
+
+// Class name patterns shared by the class index and the load hook filters.
+//
+// A pattern without any wildcard is treated as a plain prefix, so "com.acme."
+// matches everything under that package. Otherwise it's a glob where `*`
+// matches within a single package segment, `**` matches across segments and
+// `?` matches exactly one non-separator character.
+namespace pattern {
+
+bool is_glob(std::string_view pattern);
+
+// the part of the pattern before the first wildcard, usable as a range key
+std::string_view literal_prefix(std::string_view pattern);
+
+bool match(std::string_view pattern, std::string_view name, char separator = '.');
+
+}
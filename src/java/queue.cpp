@@ -0,0 +1,187 @@
+#include "queue.hpp"
+#include "frame.hpp"
+#include "java.hpp"
+#include "members.hpp"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+JNIEXPORT void JNICALL queue_retransform_j(JNIEnv* env, jclass owner, jclass j_class, jobject future) {
+    retransform_queue::get()->enqueue(env, j_class, future);
+}
+
+retransform_queue::retransform_queue() : worker(nullptr), running(false), starting(false), attached(false) {}
+
+retransform_queue* retransform_queue::get() {
+    static retransform_queue instance;
+    return &instance;
+}
+
+using integer_value_of = members::static_method<"java/lang/Integer", "valueOf", members::object<"java/lang/Integer">(jint)>;
+using future_complete = members::method<"java/util/concurrent/CompletableFuture", "complete", jboolean(members::object<"java/lang/Object">)>;
+
+bool retransform_queue::resolve(JNIEnv* env) {
+    return members::id_of(env, integer_value_of::slot) != nullptr && members::id_of(env, future_complete::slot) != nullptr;
+}
+
+static void complete(JNIEnv* env, const retransform_request& request, jvmtiError error) {
+    auto value = local_frame::track(integer_value_of::call(env, static_cast<jint>(error)));
+    future_complete::call(env, request.future, value);
+
+    if (env->ExceptionCheck())
+        env->ExceptionDescribe();
+
+    env->DeleteLocalRef(value);
+    env->DeleteGlobalRef(request.future);
+    env->DeleteGlobalRef(request.clazz);
+}
+
+void retransform_queue::enqueue(JNIEnv* env, jclass clazz, jobject future) {
+    std::unique_lock guard(lock);
+
+    pending.push_back(retransform_request {
+        .clazz = static_cast<jclass>(env->NewGlobalRef(clazz)),
+        .future = env->NewGlobalRef(future)
+    });
+
+    // started on first use, most agents never retransform asynchronously
+    if (worker == nullptr && !start(guard)) {
+        // nobody to hand them to, so they fail right here instead of hanging. the next request tries again
+        auto failed = std::exchange(pending, {});
+        guard.unlock();
+
+        for (auto& request : failed)
+            complete(env, request, JVMTI_ERROR_INTERNAL);
+
+        return;
+    }
+
+    wakeup.notify_one();
+}
+
+bool retransform_queue::start(std::unique_lock<std::mutex>& guard) {
+    running = true;
+    starting = true;
+
+    try {
+        worker = std::make_unique<std::thread>([this] { run(); });
+    } catch (const std::system_error&) {
+        std::cerr << "Failed to start the retransform queue thread." << std::endl;
+        running = false;
+        starting = false;
+        return false;
+    }
+
+    // a worker that can't attach would leave every future hanging, so find out before handing it anything
+    wakeup.wait(guard, [this] { return !starting; });
+    if (attached)
+        return true;
+
+    // it's past the lock already and only has to return
+    worker->join();
+    worker.reset();
+    running = false;
+    return false;
+}
+
+void retransform_queue::submit(JNIEnv* env, jvmtiEnv* ti, std::vector<retransform_request>& batch) {
+    // the worker never returns to Java, so its local refs are only ever freed by popping a frame
+    static frame_counter counter("retransform queue");
+    local_frame frame(env, counter, 8);
+
+    // identity hash buckets, so duplicates cost an IsSameObject each instead of comparing all pairs
+    std::unordered_multimap<jint, size_t> seen;
+    std::vector<jclass> classes;
+    std::vector<size_t> slot_of(batch.size());
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        jint hash = 0;
+        ti->GetObjectHashCode(batch[i].clazz, &hash);
+
+        auto [first, last] = seen.equal_range(hash);
+        auto duplicate = std::find_if(first, last, [&](auto& entry) {
+            return env->IsSameObject(classes[entry.second], batch[i].clazz);
+        });
+
+        if (duplicate != last) {
+            slot_of[i] = duplicate->second;
+            continue;
+        }
+
+        slot_of[i] = classes.size();
+        seen.emplace(hash, classes.size());
+        classes.push_back(batch[i].clazz);
+    }
+
+    std::vector<jvmtiError> results(classes.size());
+
+    auto error = ti->RetransformClasses(classes.size(), classes.data());
+    if (error == JVMTI_ERROR_NONE || classes.size() == 1) {
+        std::fill(results.begin(), results.end(), error);
+    } else {
+        // one bad class fails the whole batch, so find out which ones it was
+        for (size_t i = 0; i < classes.size(); i++)
+            results[i] = ti->RetransformClasses(1, &classes[i]);
+    }
+
+    for (size_t i = 0; i < batch.size(); i++)
+        complete(env, batch[i], results[slot_of[i]]);
+}
+
+void retransform_queue::run() {
+    auto jvm = java::get();
+
+    auto env = jvm->env();
+
+    std::unique_lock guard(lock);
+
+    starting = false;
+    attached = env != nullptr;
+    wakeup.notify_all();
+
+    if (env == nullptr) {
+        std::cerr << "Failed to attach the retransform queue thread." << std::endl;
+        return;
+    }
+
+    while (running) {
+        wakeup.wait(guard, [this] { return !pending.empty() || !running; });
+        if (!running)
+            break;
+
+        // let the rest of the burst arrive, shutdown cuts the window short
+        wakeup.wait_for(guard, WINDOW, [this] { return !running; });
+
+        auto batch = std::exchange(pending, {});
+
+        guard.unlock();
+        submit(env, jvm->ti(), batch);
+        guard.lock();
+    }
+
+    auto abandoned = std::exchange(pending, {});
+    guard.unlock();
+
+    // completing runs dependent stages, which may well enqueue again, so never under the lock.
+    // nobody is going to retransform these anymore, but the futures still shouldn't hang
+    for (auto& request : abandoned)
+        complete(env, request, JVMTI_ERROR_NOT_AVAILABLE);
+}
+
+void retransform_queue::shutdown() {
+    {
+        std::lock_guard guard(lock);
+        running = false;
+    }
+
+    wakeup.notify_all();
+
+    if (worker != nullptr && worker->joinable())
+        worker->join();
+
+    worker.reset();
+}
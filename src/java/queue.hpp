@@ -0,0 +1,57 @@
+#pragma once
+
+#include "jni.h"
+#include "jvmti.h"
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct retransform_request {
+    // global refs, released once the future is completed
+    jclass clazz;
+    jobject future;
+};
+
+// Collects retransform requests on a background thread. The first request
+// opens a short window, everything arriving within it is deduplicated and
+// submitted as one RetransformClasses call, and each request's
+// CompletableFuture is completed with the resulting JVMTI error code.
+class retransform_queue {
+
+    static constexpr std::chrono::milliseconds WINDOW { 20 };
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::vector<retransform_request> pending;
+
+    std::unique_ptr<std::thread> worker;
+    bool running;
+    // set by the worker once it tried to attach, start() waits for that
+    bool starting;
+    bool attached;
+
+    retransform_queue();
+
+    // lock held, false if the worker couldn't be created or attached
+    bool start(std::unique_lock<std::mutex>& guard);
+    void run();
+    void submit(JNIEnv* env, jvmtiEnv* ti, std::vector<retransform_request>& batch);
+
+public:
+
+    static retransform_queue* get();
+
+    // the members completing a future needs, false if any of them is missing
+    static bool resolve(JNIEnv* env);
+
+    void enqueue(JNIEnv* env, jclass clazz, jobject future);
+
+    // completes whatever is still queued and stops the thread
+    void shutdown();
+
+};
+
+JNIEXPORT void JNICALL queue_retransform_j(JNIEnv* env, jclass owner, jclass j_class, jobject future);
@@ -1,5 +1,14 @@
 #include "lib.hpp"
+#include "../java/java.hpp"
+#include "../java/members.hpp"
+#include "../java/queue.hpp"
 #include "../network/network.hpp"
+#include "../profiler/alloc_profiler.hpp"
+#include "../profiler/async_sampler.hpp"
+#include "../profiler/contention_profiler.hpp"
+#include "../profiler/gc_monitor.hpp"
+#include "../profiler/sampler.hpp"
+#include "../profiler/thread_top.hpp"
 #include <memory>
 
 void lib::init() {
@@ -14,6 +23,16 @@ void lib::uninit() {
     if (!initialized) return;
 
     network::get()->shutdown();
+    retransform_queue::get()->shutdown();
+    sampler::get()->stop();
+    async_sampler::get()->stop();
+    alloc_profiler::get()->stop();
+    gc_monitor::get()->stop();
+    contention_profiler::get()->stop();
+    thread_top::get()->stop();
+
+    // lets go of the pinned classes, anything still calling in resolves them again
+    members::registry::get()->clear(java::get()->env());
 
     initialized = false;
 }
@@ -4,10 +4,179 @@
 
 enum class message_type : uint8_t {
     LOAD_JAR = 0,
-    SHUTDOWN
+    SHUTDOWN,
+    FIND_CLASSES,
+    LOAD_PLUGIN,
+    ENABLE_PROBES,
+    DISABLE_PROBES,
+    PROBE_REPORT,
+    OPEN_CACHE,
+    RETRANSFORM_CLASSES,
+    REDEFINE_CLASSES,
+    // no payload, answered with "peak\tframes\toperation" lines: the most local
+    // refs a single frame of that operation created and how many frames it pushed
+    LOCAL_REF_REPORT,
+    // no payload, answered with "id\tagent class\tpath" lines
+    LIST_AGENTS,
+    UNLOAD_AGENT,
+    RELOAD_AGENT,
+    START_SAMPLER,
+    // no payload, not answered
+    STOP_SAMPLER,
+    SAMPLER_REPORT,
+    START_ASYNC_SAMPLER,
+    // no payload, not answered
+    STOP_ASYNC_SAMPLER,
+    ASYNC_SAMPLER_REPORT,
+    START_ALLOC_PROFILER,
+    // no payload, not answered
+    STOP_ALLOC_PROFILER,
+    ALLOC_REPORT,
+    // no payload, answered with the gc_status
+    START_GC_MONITOR,
+    // no payload, not answered
+    STOP_GC_MONITOR,
+    GC_REPORT,
+    // no payload, answered with the contention_status
+    START_CONTENTION_PROFILER,
+    // no payload, not answered
+    STOP_CONTENTION_PROFILER,
+    // takes a sampler_report_message, answered with "monitor class;outer;...;inner micros"
+    // lines, the time threads spent blocked entering synchronized monitors
+    CONTENTION_REPORT,
+    START_THREAD_TOP,
+    // no payload, not answered
+    STOP_THREAD_TOP,
+    THREAD_TOP_REPORT
 };
 
+// every response is a response_header followed by `size` bytes of payload
+struct response_header {
+    uint32_t size;
+};
+
+// answered with the load status, followed by the agent's id if it loaded, e.g. "OK 3"
 struct load_jar_message {
     char path[512];
     char entrypoint[256];
 };
+
+// answered with the load_status
+struct unload_agent_message {
+    uint32_t id;
+};
+
+// the agent's listeners are removed, onAgentUnload runs and the entrypoint is
+// started again from `path`, or from the jar it came from if that's empty.
+// answered with the load_status
+struct reload_agent_message {
+    uint32_t id;
+    char path[512];
+};
+
+// prefix ("com.acme.") or glob ("com.acme.**Service") over loaded class names,
+// answered with the matching names separated by newlines
+struct find_classes_message {
+    char pattern[256];
+};
+
+// native transformer plugin, see src/plugin/goober.h
+struct load_plugin_message {
+    char path[512];
+};
+
+// "com.acme.**Service#handle*", class pattern as in find_classes_message and an
+// optional method name pattern after the '#'. answered with the probe_status.
+// PROBE_REPORT has no payload and is answered with "calls\tnanos\tmethod" lines
+struct probe_message {
+    char pattern[256];
+};
+
+// persistent transform cache for listeners registered with a cache key. the
+// file is created or resized to `size` bytes (at most 64 GiB), an empty path
+// closes the cache. answered with the cache_status
+struct open_cache_message {
+    char path[512];
+    uint64_t size;
+};
+
+// every modifiable class matching the pattern (as in find_classes_message) in a
+// single RetransformClasses call. answered with the JVMTI error name and the
+// number of classes, e.g. "JVMTI_ERROR_NONE 120"
+struct retransform_classes_message {
+    char pattern[256];
+};
+
+// followed by `count` redefine_class_entry headers, each directly followed by
+// `size` bytes of class file. submitted as a single RedefineClasses call and
+// answered like RETRANSFORM_CLASSES. a count or size above the limits is
+// answered with JVMTI_ERROR_ILLEGAL_ARGUMENT and the connection is dropped,
+// since the rest of the payload is never read
+constexpr uint32_t MAX_REDEFINE_CLASSES = 65535;
+constexpr uint32_t MAX_REDEFINE_CLASS_SIZE = 64 << 20;
+
+struct redefine_classes_message {
+    uint32_t count;
+};
+
+struct redefine_class_entry {
+    char name[256];
+    uint32_t size;
+};
+
+// GetAllStackTraces every `interval` microseconds (at least 1000) until
+// STOP_SAMPLER, restarting the sampler if it's already running. answered with
+// the sampler_status
+struct start_sampler_message {
+    uint32_t interval;
+};
+
+// answered with the samples so far as collapsed stacks, "outer;...;inner count"
+// lines. a non-zero reset starts a new profile afterwards. ASYNC_SAMPLER_REPORT
+// takes the same, and adds "[gc_active]" style lines for samples
+// AsyncGetCallTrace couldn't walk and "[dropped]" for full rings
+struct sampler_report_message {
+    uint8_t reset;
+};
+
+// SIGPROF every `interval` microseconds of process CPU time (at least 1000),
+// stacks taken with AsyncGetCallTrace. answered with the async_status
+struct start_async_sampler_message {
+    uint32_t interval;
+};
+
+// SampledObjectAlloc about once every `interval` allocated bytes per thread,
+// 0 for the JVM's default of 512k. answered with the alloc_status
+struct start_alloc_profiler_message {
+    int32_t interval;
+};
+
+// answered with the `limit` allocation sites with the most sampled bytes,
+// "bytes\tsamples\tclass\touter;...;inner" lines. sizes are those of
+// the sampled objects only, so compare sites against each other rather than
+// reading them as totals. a non-zero reset starts a new profile afterwards
+struct alloc_report_message {
+    uint32_t limit;
+    uint8_t reset;
+};
+
+// answered with "pauses", "sum", "max", "p50", "p90", "p99" and "p999" as
+// "name\tmicros" lines (the count for "pauses"), an empty line, then
+// "start epoch micros\tmicros" per recent pause, oldest first. a non-zero
+// reset starts over afterwards
+struct gc_report_message {
+    uint8_t reset;
+};
+
+// GetThreadCpuTime of every live thread every `interval` milliseconds (at
+// least 100), restarting if already running. answered with the thread_top_status
+struct start_thread_top_message {
+    uint32_t interval;
+};
+
+// answered with the `limit` threads that used the most CPU in the last
+// interval, "id\tcpu percent\ttotal cpu millis\tname" each followed by its
+// current top frames as "\tframe" lines. percent is of one core
+struct thread_top_report_message {
+    uint32_t limit;
+};
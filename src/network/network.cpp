@@ -1,11 +1,27 @@
 #include "network.hpp"
+#include <chrono>
 #include <cstring>
 #include <filesystem>
 #include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
+#include "../java/agent.hpp"
+#include "../java/cache.hpp"
+#include "../java/frame.hpp"
 #include "../java/java.hpp"
 #include "../ipc/ipc.hpp"
 #include "../lib/lib.hpp"
+#include "../plugin/plugin.hpp"
+#include "../probe/probe.hpp"
+#include "../profiler/alloc_profiler.hpp"
+#include "../profiler/async_sampler.hpp"
+#include "../profiler/contention_profiler.hpp"
+#include "../profiler/gc_monitor.hpp"
+#include "../profiler/sampler.hpp"
+#include "../profiler/thread_top.hpp"
 #include "messages.hpp"
 
 #ifdef _WIN32
@@ -14,6 +30,13 @@
 #define PIPE_PATH "/tmp/meow.ipc"
 #endif
 
+static void respond(ipc_pipe& ipc, std::string_view payload) {
+    auto header = response_header { .size = static_cast<uint32_t>(payload.size()) };
+
+    if (ipc.write_or_close(&header, sizeof(header)) == sizeof(header))
+        ipc.write_or_close(payload.data(), payload.size());
+}
+
 std::shared_ptr<network>& network::get() {
     static std::shared_ptr<network> g_network = std::make_shared<network>();
     return g_network;
@@ -45,9 +68,257 @@ void network::startup() {
                             auto load = load_jar_message{};
                             memset(&load, 0, size);
                             if (ipc.read_or_close(&load, size) == size) {
-                                // TODO: respond to pipe
-                                jvm->load_jar(std::filesystem::path(std::string(load.path, 512)), std::string(load.entrypoint, 256));
+                                uint32_t id = 0;
+                                auto status = agents::get()->load(
+                                    std::filesystem::path(std::string(load.path, strnlen(load.path, sizeof(load.path)))),
+                                    std::string(load.entrypoint, strnlen(load.entrypoint, sizeof(load.entrypoint))),
+                                    id
+                                );
+
+                                std::ostringstream message;
+                                message << status;
+                                if (status == load_status::OK)
+                                    message << ' ' << id;
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::FIND_CLASSES: {
+                            auto size = sizeof(find_classes_message);
+                            auto find = find_classes_message{};
+                            memset(&find, 0, size);
+                            if (ipc.read_or_close(&find, size) == size) {
+                                std::string names;
+                                for (auto& [name, clazz] : jvm->find_classes(std::string_view(find.pattern, strnlen(find.pattern, sizeof(find.pattern))))) {
+                                    names.append(name).push_back('\n');
+                                    jvm->env()->DeleteLocalRef(clazz);
+                                }
+
+                                respond(ipc, names);
+                            }
+                        } break;
+                        case message_type::LOAD_PLUGIN: {
+                            auto size = sizeof(load_plugin_message);
+                            auto load = load_plugin_message{};
+                            memset(&load, 0, size);
+                            if (ipc.read_or_close(&load, size) == size) {
+                                auto status = plugins::get()->load(std::filesystem::path(std::string(load.path, strnlen(load.path, sizeof(load.path)))));
+                                std::ostringstream message;
+                                message << status;
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::ENABLE_PROBES:
+                        case message_type::DISABLE_PROBES: {
+                            auto size = sizeof(probe_message);
+                            auto probe = probe_message{};
+                            memset(&probe, 0, size);
+                            if (ipc.read_or_close(&probe, size) == size) {
+                                auto pattern = std::string_view(probe.pattern, strnlen(probe.pattern, sizeof(probe.pattern)));
+                                auto status = type == message_type::ENABLE_PROBES ? probes::get()->enable(pattern) : probes::get()->disable(pattern);
+                                std::ostringstream message;
+                                message << status;
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::PROBE_REPORT: {
+                            respond(ipc, probes::get()->report());
+                        } break;
+                        case message_type::OPEN_CACHE: {
+                            auto size = sizeof(open_cache_message);
+                            auto open = open_cache_message{};
+                            memset(&open, 0, size);
+                            if (ipc.read_or_close(&open, size) == size) {
+                                auto path = std::string(open.path, strnlen(open.path, sizeof(open.path)));
+
+                                auto status = cache_status::OK;
+                                if (path.empty())
+                                    transform_cache::get()->close();
+                                else
+                                    status = transform_cache::get()->open(std::filesystem::path(path), open.size);
+
+                                std::ostringstream message;
+                                message << status;
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::RETRANSFORM_CLASSES: {
+                            auto size = sizeof(retransform_classes_message);
+                            auto retransform = retransform_classes_message{};
+                            memset(&retransform, 0, size);
+                            if (ipc.read_or_close(&retransform, size) == size) {
+                                size_t count = 0;
+                                auto error = jvm->retransform_classes(std::string_view(retransform.pattern, strnlen(retransform.pattern, sizeof(retransform.pattern))), count);
+                                respond(ipc, jvm->error_name(error) + " " + std::to_string(count));
+                            }
+                        } break;
+                        case message_type::REDEFINE_CLASSES: {
+                            auto redefine = redefine_classes_message{};
+                            if (ipc.read_or_close(&redefine, sizeof(redefine)) != sizeof(redefine))
+                                break;
+
+                            // nothing is allocated off the client's word, the stream
+                            // can't be resynchronised past a rejected header either
+                            auto reject = [&] {
+                                respond(ipc, jvm->error_name(JVMTI_ERROR_ILLEGAL_ARGUMENT) + " 0");
+                                ipc.close_client();
+                            };
+
+                            if (redefine.count > MAX_REDEFINE_CLASSES) {
+                                reject();
+                                break;
+                            }
+
+                            std::vector<std::pair<std::string, std::vector<unsigned char>>> classes;
+                            classes.reserve(redefine.count);
+                            bool complete = true;
+
+                            for (uint32_t i = 0; i < redefine.count && complete; i++) {
+                                auto entry = redefine_class_entry{};
+                                memset(&entry, 0, sizeof(entry));
+                                if (ipc.read_or_close(&entry, sizeof(entry)) != sizeof(entry)) {
+                                    complete = false;
+                                    break;
+                                }
+
+                                if (entry.size > MAX_REDEFINE_CLASS_SIZE) {
+                                    reject();
+                                    complete = false;
+                                    break;
+                                }
+
+                                std::vector<unsigned char> bytes(entry.size);
+                                for (size_t read = 0; read < bytes.size() && complete;) {
+                                    auto count = ipc.read_or_close(bytes.data() + read, bytes.size() - read);
+                                    if (count == 0 || count > bytes.size() - read)
+                                        complete = false;
+                                    else
+                                        read += count;
+                                }
+
+                                classes.emplace_back(std::string(entry.name, strnlen(entry.name, sizeof(entry.name))), std::move(bytes));
                             }
+
+                            // the client went away halfway or was rejected, nothing to answer
+                            if (!complete)
+                                break;
+
+                            auto error = jvm->redefine_classes(classes);
+                            respond(ipc, jvm->error_name(error) + " " + std::to_string(classes.size()));
+                        } break;
+                        case message_type::LOCAL_REF_REPORT: {
+                            respond(ipc, frame_counter::report());
+                        } break;
+                        case message_type::LIST_AGENTS: {
+                            respond(ipc, agents::get()->list());
+                        } break;
+                        case message_type::UNLOAD_AGENT: {
+                            auto unload = unload_agent_message{};
+                            if (ipc.read_or_close(&unload, sizeof(unload)) == sizeof(unload)) {
+                                std::ostringstream message;
+                                message << agents::get()->unload(unload.id);
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::RELOAD_AGENT: {
+                            auto size = sizeof(reload_agent_message);
+                            auto reload = reload_agent_message{};
+                            memset(&reload, 0, size);
+                            if (ipc.read_or_close(&reload, size) == size) {
+                                auto path = std::string(reload.path, strnlen(reload.path, sizeof(reload.path)));
+                                std::ostringstream message;
+                                message << agents::get()->reload(reload.id, std::filesystem::path(path));
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::START_SAMPLER: {
+                            auto start = start_sampler_message{};
+                            if (ipc.read_or_close(&start, sizeof(start)) == sizeof(start)) {
+                                std::ostringstream message;
+                                message << sampler::get()->start(std::chrono::microseconds(start.interval));
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::STOP_SAMPLER: {
+                            sampler::get()->stop();
+                        } break;
+                        case message_type::SAMPLER_REPORT: {
+                            auto report = sampler_report_message{};
+                            if (ipc.read_or_close(&report, sizeof(report)) == sizeof(report))
+                                respond(ipc, sampler::get()->report(report.reset != 0));
+                        } break;
+                        case message_type::START_ASYNC_SAMPLER: {
+                            auto start = start_async_sampler_message{};
+                            if (ipc.read_or_close(&start, sizeof(start)) == sizeof(start)) {
+                                std::ostringstream message;
+                                message << async_sampler::get()->start(std::chrono::microseconds(start.interval));
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::STOP_ASYNC_SAMPLER: {
+                            async_sampler::get()->stop();
+                        } break;
+                        case message_type::ASYNC_SAMPLER_REPORT: {
+                            auto report = sampler_report_message{};
+                            if (ipc.read_or_close(&report, sizeof(report)) == sizeof(report))
+                                respond(ipc, async_sampler::get()->report(report.reset != 0));
+                        } break;
+                        case message_type::START_ALLOC_PROFILER: {
+                            auto start = start_alloc_profiler_message{};
+                            if (ipc.read_or_close(&start, sizeof(start)) == sizeof(start)) {
+                                std::ostringstream message;
+                                message << alloc_profiler::get()->start(start.interval);
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::STOP_ALLOC_PROFILER: {
+                            alloc_profiler::get()->stop();
+                        } break;
+                        case message_type::ALLOC_REPORT: {
+                            auto report = alloc_report_message{};
+                            if (ipc.read_or_close(&report, sizeof(report)) == sizeof(report))
+                                respond(ipc, alloc_profiler::get()->report(report.limit, report.reset != 0));
+                        } break;
+                        case message_type::START_GC_MONITOR: {
+                            std::ostringstream message;
+                            message << gc_monitor::get()->start();
+                            respond(ipc, message.str());
+                        } break;
+                        case message_type::STOP_GC_MONITOR: {
+                            gc_monitor::get()->stop();
+                        } break;
+                        case message_type::GC_REPORT: {
+                            auto report = gc_report_message{};
+                            if (ipc.read_or_close(&report, sizeof(report)) == sizeof(report))
+                                respond(ipc, gc_monitor::get()->report(report.reset != 0));
+                        } break;
+                        case message_type::START_CONTENTION_PROFILER: {
+                            std::ostringstream message;
+                            message << contention_profiler::get()->start();
+                            respond(ipc, message.str());
+                        } break;
+                        case message_type::STOP_CONTENTION_PROFILER: {
+                            contention_profiler::get()->stop();
+                        } break;
+                        case message_type::CONTENTION_REPORT: {
+                            auto report = sampler_report_message{};
+                            if (ipc.read_or_close(&report, sizeof(report)) == sizeof(report))
+                                respond(ipc, contention_profiler::get()->report(report.reset != 0));
+                        } break;
+                        case message_type::START_THREAD_TOP: {
+                            auto start = start_thread_top_message{};
+                            if (ipc.read_or_close(&start, sizeof(start)) == sizeof(start)) {
+                                std::ostringstream message;
+                                message << thread_top::get()->start(std::chrono::milliseconds(start.interval));
+                                respond(ipc, message.str());
+                            }
+                        } break;
+                        case message_type::STOP_THREAD_TOP: {
+                            thread_top::get()->stop();
+                        } break;
+                        case message_type::THREAD_TOP_REPORT: {
+                            auto report = thread_top_report_message{};
+                            if (ipc.read_or_close(&report, sizeof(report)) == sizeof(report))
+                                respond(ipc, thread_top::get()->report(report.limit));
                         } break;
                         case message_type::SHUTDOWN: {
                             lib::get()->uninit();
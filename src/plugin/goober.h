@@ -0,0 +1,80 @@
+/*
+ * C ABI for native goober plugins.
+ *
+ * A plugin is a shared library exporting GOOBER_PLUGIN_ENTRY. It gets loaded
+ * through the LOAD_PLUGIN IPC command and can register transformers that run
+ * inside the ClassFileLoadHook alongside the Java listeners, operating on the
+ * raw class bytes without ever touching the Java heap.
+ */
+#ifndef GOOBER_H
+#define GOOBER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jni.h"
+#include "jvmti.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GOOBER_API_VERSION 1
+
+#define GOOBER_PLUGIN_ENTRY "goober_plugin_load"
+
+typedef enum goober_transform_result {
+    /* leave the class as the previous stage produced it */
+    GOOBER_UNCHANGED = 0,
+    /* *new_class_data holds a buffer from goober_api.allocate */
+    GOOBER_TRANSFORMED = 1
+} goober_transform_result;
+
+/*
+ * Called on the class loading thread. `name` is the internal class name
+ * ("com/acme/Foo") and may be null for hidden classes. `class_data` is only
+ * valid for the duration of the call and must not be written to.
+ */
+typedef goober_transform_result (*goober_transform_fn)(
+    void* user_data,
+    const char* name,
+    const unsigned char* class_data,
+    int32_t class_data_len,
+    unsigned char** new_class_data,
+    int32_t* new_class_data_len);
+
+typedef struct goober_transformer {
+    /* transformers run in ascending priority together with the Java listeners */
+    int32_t priority;
+
+    /* same syntax as Utility.findClasses, no patterns means every class */
+    const char* const* patterns;
+    size_t pattern_count;
+
+    goober_transform_fn transform;
+    void* user_data;
+} goober_transformer;
+
+typedef struct goober_api {
+    uint32_t version;
+
+    JavaVM* jvm;
+    jvmtiEnv* jvmti;
+
+    /* returns an id for unregister_transformer, or -1 on failure */
+    int32_t (*register_transformer)(const goober_transformer* transformer);
+    void (*unregister_transformer)(int32_t id);
+
+    /* JVMTI memory, the only kind a transformer may hand back */
+    unsigned char* (*allocate)(int64_t size);
+    void (*deallocate)(unsigned char* buffer);
+} goober_api;
+
+/* returns 0 on success, anything else unloads the plugin again */
+typedef int32_t (*goober_plugin_load_fn)(const goober_api* api);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,143 @@
+#include "plugin.hpp"
+#include "../java/hook.hpp"
+#include "../java/java.hpp"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+// transformers registered by the plugin currently inside its entrypoint on this thread
+static thread_local std::vector<int32_t>* loading_ids = nullptr;
+
+static int32_t register_transformer(const goober_transformer* transformer) {
+    if (transformer == nullptr || transformer->transform == nullptr)
+        return -1;
+
+    std::vector<std::string> patterns;
+    for (size_t i = 0; i < transformer->pattern_count; i++) {
+        std::string pattern(transformer->patterns[i]);
+        std::replace(pattern.begin(), pattern.end(), '.', '/');
+        patterns.push_back(std::move(pattern));
+    }
+
+    auto id = load_hook::get()->add(transformer->transform, transformer->user_data, transformer->priority, std::move(patterns));
+    if (loading_ids != nullptr)
+        loading_ids->push_back(id);
+
+    return id;
+}
+
+static void unregister_transformer(int32_t id) {
+    load_hook::get()->remove(id);
+}
+
+static unsigned char* allocate(int64_t size) {
+    unsigned char* buf;
+    if (size < 0 || java::get()->ti()->Allocate(size, &buf) != JVMTI_ERROR_NONE)
+        return nullptr;
+
+    return buf;
+}
+
+static void deallocate(unsigned char* buffer) {
+    java::get()->ti()->Deallocate(buffer);
+}
+
+plugins::plugins() {
+    auto jvm = java::get();
+
+    api = goober_api {
+        .version = GOOBER_API_VERSION,
+        .jvm = jvm->jvm(),
+        .jvmti = jvm->ti(),
+        .register_transformer = &register_transformer,
+        .unregister_transformer = &unregister_transformer,
+        .allocate = &allocate,
+        .deallocate = &deallocate
+    };
+}
+
+plugins* plugins::get() {
+    static plugins instance;
+    return &instance;
+}
+
+plugin_status plugins::load(std::filesystem::path path) {
+    std::lock_guard guard(lock);
+
+#ifdef _WIN32
+    auto handle = LoadLibraryW(path.c_str());
+    if (handle == nullptr) {
+        std::cerr << "Failed to load plugin " << path << ": " << GetLastError() << std::endl;
+        return plugin_status::LOAD_FAILED;
+    }
+
+    auto entry = reinterpret_cast<goober_plugin_load_fn>(GetProcAddress(handle, GOOBER_PLUGIN_ENTRY));
+#else
+    auto handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+        std::cerr << "Failed to load plugin " << path << ": " << dlerror() << std::endl;
+        return plugin_status::LOAD_FAILED;
+    }
+
+    auto entry = reinterpret_cast<goober_plugin_load_fn>(dlsym(handle, GOOBER_PLUGIN_ENTRY));
+#endif
+
+    if (entry == nullptr) {
+        std::cerr << "Plugin " << path << " doesn't export " << GOOBER_PLUGIN_ENTRY << std::endl;
+#ifdef _WIN32
+        FreeLibrary(handle);
+#else
+        dlclose(handle);
+#endif
+        return plugin_status::NO_ENTRYPOINT;
+    }
+
+    std::vector<int32_t> ids;
+    loading_ids = &ids;
+    auto result = entry(&api);
+    loading_ids = nullptr;
+
+    // a failed plugin stays mapped, the hook might still be running one of its
+    // transformers on another thread
+    handles.push_back(reinterpret_cast<void*>(handle));
+
+    if (result != 0) {
+        std::cerr << "Plugin " << path << " failed to initialize." << std::endl;
+
+        for (auto id : ids)
+            load_hook::get()->remove(id);
+
+        return plugin_status::INIT_FAILED;
+    }
+
+    return plugin_status::OK;
+}
+
+std::ostream& operator<<(std::ostream& stream, plugin_status status) {
+
+    switch (status) {
+    case plugin_status::OK:
+        stream << "OK";
+        break;
+    case plugin_status::LOAD_FAILED:
+        stream << "Load failed";
+        break;
+    case plugin_status::NO_ENTRYPOINT:
+        stream << "No entrypoint";
+        break;
+    case plugin_status::INIT_FAILED:
+        stream << "Init failed";
+        break;
+    }
+
+    return stream;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "goober.h"
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+enum class plugin_status : uint8_t {
+    OK = 0,
+    LOAD_FAILED,
+    NO_ENTRYPOINT,
+    INIT_FAILED
+};
+
+std::ostream& operator<<(std::ostream& stream, plugin_status status);
+
+// Loads native plugins and hands them the goober_api table. Plugins stay
+// mapped for the rest of the process since the hook may be inside their code
+// at any time.
+class plugins {
+
+    std::vector<void*> handles;
+    std::mutex lock;
+
+    goober_api api;
+
+    plugins();
+
+public:
+
+    static plugins* get();
+
+    plugin_status load(std::filesystem::path path);
+
+};
@@ -0,0 +1,420 @@
+#include "probe.hpp"
+#include "../classfile/classfile.hpp"
+#include "../classfile/code.hpp"
+#include "../java/frame.hpp"
+#include "../java/hook.hpp"
+#include "../java/java.hpp"
+#include "../java/pattern.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// classes the probe call can't be linked from (named JDK modules don't read the
+// bootstrap unnamed module) or that Probes.record itself depends on
+static constexpr std::string_view excluded[] = {
+    "java/", "javax/", "jdk/", "sun/", "com/sun/", "cat/psychward/goober/"
+};
+
+static bool is_excluded(std::string_view name) {
+    return std::any_of(std::begin(excluded), std::end(excluded), [name](auto prefix) {
+        return name.starts_with(prefix);
+    });
+}
+
+static thread_local thread_counters counters;
+
+thread_counters::thread_counters() {
+    for (auto& chunk : chunks)
+        chunk.store(nullptr, std::memory_order_relaxed);
+
+    probes::get()->attach(this);
+}
+
+thread_counters::~thread_counters() {
+    probes::get()->detach(this);
+
+    for (auto& chunk : chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+probe_slot* thread_counters::slot(int32_t id) {
+    auto index = static_cast<size_t>(id) / CHUNK_SIZE;
+    if (id < 0 || index >= MAX_CHUNKS)
+        return nullptr;
+
+    auto chunk = chunks[index].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        chunk = new probe_slot[CHUNK_SIZE]{};
+        chunks[index].store(chunk, std::memory_order_release);
+    }
+
+    return &chunk[id % CHUNK_SIZE];
+}
+
+JNIEXPORT void JNICALL probe_record_j(JNIEnv* env, jclass owner, jint id, jlong nanos) {
+    auto slot = counters.slot(id);
+    if (slot == nullptr)
+        return;
+
+    slot->calls.store(slot->calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    slot->nanos.store(slot->nanos.load(std::memory_order_relaxed) + nanos, std::memory_order_relaxed);
+}
+
+// wraps the body as
+//   long start = System.nanoTime();
+//   try { ...; } Probes.record(id, System.nanoTime() - start); return;
+//   catch (Throwable t) { Probes.record(id, System.nanoTime() - start); throw t; }
+// the catch-all covers the body but none of the record calls, so a throwing
+// record isn't counted a second time on its way out
+static void instrument(classfile::class_file& clazz, classfile::code& body, int32_t id) {
+    using namespace classfile;
+
+    auto nano_time = clazz.pool.add_methodref("java/lang/System", "nanoTime", "()J");
+    auto record = clazz.pool.add_methodref("cat/psychward/goober/Probes", "record", "(IJ)V");
+
+    auto slot = body.max_locals;
+    body.max_locals += 2;
+    body.declare_local(slot, vtype::of(vtype_kind::LONG));
+
+    auto report = [&](std::vector<instruction>& out) {
+        if (id <= 0x7fff)
+            out.push_back(instruction::of(op::SIPUSH, id));
+        else
+            out.push_back(instruction::of(op::LDC, clazz.pool.add_integer(id)));
+
+        out.push_back(instruction::of(op::INVOKESTATIC, nano_time));
+        out.push_back(instruction::of(op::LLOAD, slot));
+        out.push_back(instruction::of(op::LSUB));
+        out.push_back(instruction::of(op::INVOKESTATIC, record));
+    };
+
+    auto handler = body.new_label();
+
+    // one protected range per stretch of body between two returns, empty ones are dropped on write
+    std::vector<std::pair<label, label>> ranges;
+    ranges.emplace_back(body.new_label(), label());
+
+    std::vector<instruction> rewritten;
+    rewritten.reserve(body.instructions.size() + 16);
+
+    rewritten.push_back(instruction::of(op::INVOKESTATIC, nano_time));
+    rewritten.push_back(instruction::of(op::LSTORE, slot));
+    rewritten.push_back(instruction::mark(ranges.back().first));
+
+    for (auto& insn : body.instructions) {
+        if (insn.opcode >= op::IRETURN && insn.opcode <= op::RETURN) {
+            ranges.back().second = body.new_label();
+            rewritten.push_back(instruction::mark(ranges.back().second));
+
+            report(rewritten);
+            rewritten.push_back(std::move(insn));
+
+            ranges.emplace_back(body.new_label(), label());
+            rewritten.push_back(instruction::mark(ranges.back().first));
+            continue;
+        }
+
+        rewritten.push_back(std::move(insn));
+    }
+
+    ranges.back().second = body.new_label();
+    rewritten.push_back(instruction::mark(ranges.back().second));
+    rewritten.push_back(instruction::mark(handler));
+    report(rewritten);
+    rewritten.push_back(instruction::of(op::ATHROW));
+
+    body.instructions = std::move(rewritten);
+
+    // last, so the method's own handlers still get their exceptions first
+    for (auto& [start, end] : ranges) {
+        body.handlers.push_back(exception_handler {
+            .start = start,
+            .end = end,
+            .handler = handler,
+            .catch_type = 0
+        });
+    }
+}
+
+static goober_transform_result transform(void* user_data, const char* name, const unsigned char* class_data, int32_t class_data_len, unsigned char** new_class_data, int32_t* new_class_data_len) {
+    if (name == nullptr || is_excluded(name))
+        return GOOBER_UNCHANGED;
+
+    auto registry = probes::get();
+    if (!registry->matches(name))
+        return GOOBER_UNCHANGED;
+
+    auto clazz = classfile::class_file::parse(std::span(class_data, class_data_len));
+    if (!clazz.has_value())
+        return GOOBER_UNCHANGED;
+
+    bool changed = false;
+    for (auto& method : clazz->methods) {
+        auto method_name = clazz->pool.utf8(method.name_index);
+
+        // constructors can't have a handler around the super() call
+        if (method_name.starts_with('<') || (method.access & (classfile::access::ABSTRACT | classfile::access::NATIVE | classfile::access::BRIDGE)))
+            continue;
+
+        if (!registry->matches(name, method_name))
+            continue;
+
+        auto body = clazz->body(method);
+        if (body == nullptr)
+            continue;
+
+        auto id = registry->id_of(std::string(name) + "." + std::string(method_name) + std::string(clazz->pool.utf8(method.descriptor_index)));
+        if (id < 0)
+            continue;
+
+        instrument(*clazz, *body, id);
+        changed = true;
+    }
+
+    if (!changed)
+        return GOOBER_UNCHANGED;
+
+    auto bytes = clazz->write();
+    if (!bytes.has_value()) {
+        std::cerr << "Failed to instrument " << name << ", leaving it alone." << std::endl;
+        return GOOBER_UNCHANGED;
+    }
+
+    unsigned char* buf;
+    if (java::get()->ti()->Allocate(bytes->size(), &buf) != JVMTI_ERROR_NONE)
+        return GOOBER_UNCHANGED;
+
+    memcpy(buf, bytes->data(), bytes->size());
+    *new_class_data = buf;
+    *new_class_data_len = bytes->size();
+
+    return GOOBER_TRANSFORMED;
+}
+
+probes::probes() : hook_id(-1) {}
+
+probes* probes::get() {
+    static probes instance;
+    return &instance;
+}
+
+static bool parse_set(std::string_view pattern, probe_set& set) {
+    auto split = pattern.find('#');
+
+    auto classes = pattern.substr(0, split);
+    if (classes.empty())
+        return false;
+
+    set.pattern = std::string(pattern);
+    set.classes = std::string(classes);
+    std::replace(set.classes.begin(), set.classes.end(), '.', '/');
+    set.methods = split != std::string_view::npos ? std::string(pattern.substr(split + 1)) : "";
+
+    return true;
+}
+
+probe_status probes::retransform(std::string_view classes) {
+    auto jvm = java::get();
+
+    // the class index uses Class.getName() style names
+    std::string query(classes);
+    std::replace(query.begin(), query.end(), '/', '.');
+
+    // find_classes hands out a local ref per class, they all go with the frame
+    static frame_counter counter("probe retransform");
+    local_frame frame(jvm->env(), counter, 256);
+
+    std::vector<jclass> targets;
+    for (auto& [name, clazz] : jvm->find_classes(query)) {
+        std::string internal(name);
+        std::replace(internal.begin(), internal.end(), '.', '/');
+
+        jboolean modifiable = false;
+        if (is_excluded(internal) || jvm->ti()->IsModifiableClass(clazz, &modifiable) != JVMTI_ERROR_NONE || !modifiable)
+            continue;
+
+        targets.push_back(clazz);
+    }
+
+    if (targets.empty())
+        return probe_status::OK;
+
+    // one call for the whole set, so one safepoint
+    auto error = jvm->ti()->RetransformClasses(targets.size(), targets.data());
+    if (error != JVMTI_ERROR_NONE) {
+        std::cerr << "Failed to retransform " << targets.size() << " classes for probes: " << error << std::endl;
+        return probe_status::RETRANSFORM_FAILED;
+    }
+
+    return probe_status::OK;
+}
+
+probe_status probes::enable(std::string_view pattern) {
+    probe_set set;
+    if (!parse_set(pattern, set))
+        return probe_status::INVALID_PATTERN;
+
+    {
+        std::unique_lock guard(lock);
+
+        if (std::any_of(sets.begin(), sets.end(), [&](auto& other) { return other.pattern == set.pattern; }))
+            return probe_status::ALREADY_ENABLED;
+
+        sets.push_back(set);
+
+        // filtering happens in matches(), the sets change too often for fixed hook patterns
+        if (hook_id < 0)
+            hook_id = load_hook::get()->add(&transform, nullptr, 0, {});
+    }
+
+    return retransform(set.classes);
+}
+
+probe_status probes::disable(std::string_view pattern) {
+    probe_set set;
+    if (!parse_set(pattern, set))
+        return probe_status::INVALID_PATTERN;
+
+    {
+        std::unique_lock guard(lock);
+
+        auto removed = std::erase_if(sets, [&](auto& other) { return other.pattern == set.pattern; });
+        if (removed == 0)
+            return probe_status::NOT_ENABLED;
+    }
+
+    // retransforming starts over from the original bytes, so whatever no other set matches comes out clean
+    return retransform(set.classes);
+}
+
+bool probes::matches(std::string_view class_name) {
+    std::shared_lock guard(lock);
+
+    return std::any_of(sets.begin(), sets.end(), [&](auto& set) {
+        return pattern::match(set.classes, class_name, '/');
+    });
+}
+
+bool probes::matches(std::string_view class_name, std::string_view method_name) {
+    std::shared_lock guard(lock);
+
+    return std::any_of(sets.begin(), sets.end(), [&](auto& set) {
+        return pattern::match(set.classes, class_name, '/') && (set.methods.empty() || pattern::match(set.methods, method_name));
+    });
+}
+
+int32_t probes::id_of(std::string name) {
+    std::unique_lock guard(lock);
+
+    auto pos = ids.find(name);
+    if (pos != ids.end())
+        return pos->second;
+
+    if (names.size() >= thread_counters::CHUNK_SIZE * thread_counters::MAX_CHUNKS)
+        return -1;
+
+    auto id = static_cast<int32_t>(names.size());
+    names.push_back(name);
+    ids.emplace(std::move(name), id);
+
+    return id;
+}
+
+void probes::attach(thread_counters* counters) {
+    std::lock_guard guard(threads_lock);
+    threads.push_back(counters);
+}
+
+void probes::detach(thread_counters* counters) {
+    std::lock_guard guard(threads_lock);
+
+    std::erase(threads, counters);
+
+    // keep what the thread counted, the probes outlive it
+    for (size_t chunk = 0; chunk < thread_counters::MAX_CHUNKS; chunk++) {
+        auto slots = counters->chunks[chunk].load(std::memory_order_acquire);
+        if (slots == nullptr)
+            continue;
+
+        for (size_t i = 0; i < thread_counters::CHUNK_SIZE; i++) {
+            auto id = chunk * thread_counters::CHUNK_SIZE + i;
+            if (retired.size() <= id)
+                retired.resize(id + 1);
+
+            retired[id].first += slots[i].calls.load(std::memory_order_relaxed);
+            retired[id].second += slots[i].nanos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+std::string probes::report() {
+    std::vector<std::pair<uint64_t, uint64_t>> totals;
+    {
+        std::lock_guard guard(threads_lock);
+
+        totals = retired;
+        for (auto counters : threads) {
+            for (size_t chunk = 0; chunk < thread_counters::MAX_CHUNKS; chunk++) {
+                auto slots = counters->chunks[chunk].load(std::memory_order_acquire);
+                if (slots == nullptr)
+                    continue;
+
+                for (size_t i = 0; i < thread_counters::CHUNK_SIZE; i++) {
+                    auto id = chunk * thread_counters::CHUNK_SIZE + i;
+                    if (totals.size() <= id)
+                        totals.resize(id + 1);
+
+                    totals[id].first += slots[i].calls.load(std::memory_order_relaxed);
+                    totals[id].second += slots[i].nanos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+
+    std::vector<size_t> order;
+    for (size_t id = 0; id < totals.size(); id++) {
+        if (totals[id].first > 0)
+            order.push_back(id);
+    }
+
+    std::sort(order.begin(), order.end(), [&](auto a, auto b) { return totals[a].second > totals[b].second; });
+
+    std::shared_lock guard(lock);
+
+    std::ostringstream out;
+    for (auto id : order) {
+        if (id < names.size())
+            out << totals[id].first << '\t' << totals[id].second << '\t' << names[id] << '\n';
+    }
+
+    return out.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, probe_status status) {
+
+    switch (status) {
+    case probe_status::OK:
+        stream << "OK";
+        break;
+    case probe_status::INVALID_PATTERN:
+        stream << "Invalid pattern";
+        break;
+    case probe_status::ALREADY_ENABLED:
+        stream << "Already enabled";
+        break;
+    case probe_status::NOT_ENABLED:
+        stream << "Not enabled";
+        break;
+    case probe_status::RETRANSFORM_FAILED:
+        stream << "Retransform failed";
+        break;
+    }
+
+    return stream;
+}
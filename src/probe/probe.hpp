@@ -0,0 +1,100 @@
+#pragma once
+
+#include "jni.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class probe_status : uint8_t {
+    OK = 0,
+    INVALID_PATTERN,
+    ALREADY_ENABLED,
+    NOT_ENABLED,
+    RETRANSFORM_FAILED
+};
+
+std::ostream& operator<<(std::ostream& stream, probe_status status);
+
+struct probe_slot {
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> nanos;
+};
+
+// Counters of one thread. Only the owning thread writes, so updates are plain
+// relaxed stores and reporting just reads whatever is there. Slots come in
+// fixed chunks that never move once published.
+class thread_counters {
+
+public:
+
+    static constexpr size_t CHUNK_SIZE = 256;
+    static constexpr size_t MAX_CHUNKS = 256;
+
+    std::array<std::atomic<probe_slot*>, MAX_CHUNKS> chunks;
+
+    thread_counters();
+    ~thread_counters();
+
+    probe_slot* slot(int32_t id);
+
+};
+
+struct probe_set {
+    // "com.acme.**Service#handle*" as given
+    std::string pattern;
+
+    // internal name glob for the class part, name glob for the method part
+    std::string classes;
+    std::string methods;
+};
+
+// Method timing probes. Matching methods are rewritten on load to take
+// System.nanoTime() on entry and hand the elapsed time to Probes.record on
+// every return or throw. One native transformer serves every probe set, so a
+// method matched by several of them is still only instrumented once.
+class probes {
+
+    std::shared_mutex lock;
+    std::vector<probe_set> sets;
+    int32_t hook_id;
+
+    // "com/acme/Foo.bar(I)V" -> id, kept across disable/enable so counts add up
+    std::unordered_map<std::string, int32_t> ids;
+    std::vector<std::string> names;
+
+    std::mutex threads_lock;
+    std::vector<thread_counters*> threads;
+    // counts of threads that have exited, by id
+    std::vector<std::pair<uint64_t, uint64_t>> retired;
+
+    probes();
+
+    probe_status retransform(std::string_view classes);
+
+public:
+
+    static probes* get();
+
+    probe_status enable(std::string_view pattern);
+    probe_status disable(std::string_view pattern);
+
+    // "calls\tnanos\tname" per probe with any calls, most total time first
+    std::string report();
+
+    bool matches(std::string_view class_name);
+    bool matches(std::string_view class_name, std::string_view method_name);
+    int32_t id_of(std::string name);
+
+    void attach(thread_counters* counters);
+    void detach(thread_counters* counters);
+
+};
+
+JNIEXPORT void JNICALL probe_record_j(JNIEnv* env, jclass owner, jint id, jlong nanos);
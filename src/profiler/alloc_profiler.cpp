@@ -0,0 +1,192 @@
+#include "alloc_profiler.hpp"
+#include "call_tree.hpp"
+#include "../java/java.hpp"
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+
+alloc_table::alloc_table() : sites(std::make_unique<alloc_site[]>(SITES)), overflow_samples(0), overflow_bytes(0) {}
+
+uint64_t alloc_table::hash_of(uint32_t clazz, const jvmtiFrameInfo* frames, jint depth) {
+    // FNV-1a over the class and the method IDs
+    uint64_t hash = 0xcbf29ce484222325 ^ clazz;
+    for (jint i = 0; i < depth; i++)
+        hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i].method)) * 0x100000001b3;
+
+    return hash | 1;
+}
+
+void alloc_table::record(uint64_t hash, uint32_t clazz, const jvmtiFrameInfo* frames, jint depth, jlong size) {
+    for (size_t probe = 0; probe < PROBES; probe++) {
+        auto& site = sites[(hash + probe) % SITES];
+
+        auto claimed = site.hash.load(std::memory_order_acquire);
+        if (claimed == 0 && site.hash.compare_exchange_strong(claimed, hash, std::memory_order_acq_rel)) {
+            site.clazz = clazz;
+            site.depth = depth;
+            for (jint i = 0; i < depth; i++)
+                site.frames[i] = frames[i].method;
+
+            site.ready.store(true, std::memory_order_release);
+            claimed = hash;
+        }
+
+        if (claimed != hash)
+            continue;
+
+        site.samples.fetch_add(1, std::memory_order_relaxed);
+        site.bytes.fetch_add(size, std::memory_order_relaxed);
+        return;
+    }
+
+    overflow_samples.fetch_add(1, std::memory_order_relaxed);
+    overflow_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void alloc_table::clear() {
+    for (size_t i = 0; i < SITES; i++) {
+        sites[i].ready.store(false, std::memory_order_relaxed);
+        sites[i].samples.store(0, std::memory_order_relaxed);
+        sites[i].bytes.store(0, std::memory_order_relaxed);
+        sites[i].hash.store(0, std::memory_order_release);
+    }
+
+    overflow_samples.store(0, std::memory_order_relaxed);
+    overflow_bytes.store(0, std::memory_order_relaxed);
+}
+
+alloc_profiler::alloc_profiler() : current(0), running(false) {}
+
+alloc_profiler* alloc_profiler::get() {
+    static alloc_profiler instance;
+    return &instance;
+}
+
+void alloc_profiler::on_alloc(jvmtiEnv* ti, jclass clazz, jlong size) {
+    jvmtiFrameInfo frames[alloc_site::MAX_DEPTH];
+    jint depth = 0;
+
+    // the current thread's own stack, no safepoint involved
+    if (ti->GetStackTrace(nullptr, 0, alloc_site::MAX_DEPTH, frames, &depth) != JVMTI_ERROR_NONE)
+        depth = 0;
+
+    auto id = class_tags::get()->id_of(ti, clazz);
+    tables[current.load(std::memory_order_acquire)].record(alloc_table::hash_of(id, frames, depth), id, frames, depth, size);
+}
+
+alloc_status alloc_profiler::start(jint interval) {
+    std::lock_guard guard(lock);
+
+    if (interval < 0)
+        return alloc_status::INVALID_INTERVAL;
+
+    auto ti = java::get()->ti();
+
+    jvmtiCapabilities wanted {};
+    wanted.can_generate_sampled_object_alloc_events = 1;
+    wanted.can_tag_objects = 1;
+
+    if (ti->AddCapabilities(&wanted) != JVMTI_ERROR_NONE)
+        return alloc_status::UNSUPPORTED;
+
+    if (ti->SetHeapSamplingInterval(interval == 0 ? DEFAULT_INTERVAL : interval) != JVMTI_ERROR_NONE)
+        return alloc_status::INVALID_INTERVAL;
+
+    if (!running && ti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_SAMPLED_OBJECT_ALLOC, nullptr) != JVMTI_ERROR_NONE)
+        return alloc_status::UNSUPPORTED;
+
+    running = true;
+    return alloc_status::OK;
+}
+
+void alloc_profiler::stop() {
+    std::lock_guard guard(lock);
+
+    if (!running)
+        return;
+
+    java::get()->ti()->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_SAMPLED_OBJECT_ALLOC, nullptr);
+    running = false;
+}
+
+std::string alloc_profiler::report(size_t limit, bool reset) {
+    std::lock_guard guard(lock);
+
+    auto ti = java::get()->ti();
+
+    auto index = current.load(std::memory_order_relaxed);
+    auto& table = tables[index];
+
+    // new samples go to the other table while this one is read. that one was left
+    // behind a whole profile ago, so nothing is still writing to it by now
+    if (reset) {
+        tables[index ^ 1].clear();
+        current.store(index ^ 1, std::memory_order_release);
+    }
+
+    // the counters keep moving unless we just switched away, so they're read once
+    struct sampled {
+        uint64_t bytes;
+        uint64_t samples;
+        alloc_site* site;
+    };
+
+    std::vector<sampled> sites;
+    for (size_t i = 0; i < alloc_table::SITES; i++) {
+        auto& site = table.sites[i];
+        if (!site.ready.load(std::memory_order_acquire))
+            continue;
+
+        auto samples = site.samples.load(std::memory_order_relaxed);
+        if (samples > 0)
+            sites.push_back(sampled { site.bytes.load(std::memory_order_relaxed), samples, &site });
+    }
+
+    auto count = std::min(limit, sites.size());
+    std::partial_sort(sites.begin(), sites.begin() + count, sites.end(), [](auto& a, auto& b) { return a.bytes > b.bytes; });
+
+    std::unordered_map<jmethodID, std::string> names;
+    auto name_of = [&](jmethodID method) -> const std::string& {
+        auto [pos, inserted] = names.emplace(method, std::string());
+        if (inserted)
+            pos->second = method_name(ti, method);
+
+        return pos->second;
+    };
+
+    std::stringstream stream;
+    for (size_t i = 0; i < count; i++) {
+        auto site = sites[i].site;
+        stream << sites[i].bytes << '\t' << sites[i].samples << '\t' << class_tags::get()->name_of(site->clazz) << '\t';
+
+        for (auto frame = site->depth - 1; frame >= 0; frame--) {
+            stream << name_of(site->frames[frame]);
+            if (frame > 0)
+                stream << ';';
+        }
+
+        stream << '\n';
+    }
+
+    if (auto overflow = table.overflow_samples.load(std::memory_order_relaxed); overflow > 0)
+        stream << table.overflow_bytes.load(std::memory_order_relaxed) << '\t' << overflow << "\t[other]\t\n";
+
+    return stream.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, alloc_status status) {
+
+    switch (status) {
+    case alloc_status::OK:
+        stream << "OK";
+        break;
+    case alloc_status::UNSUPPORTED:
+        stream << "Unsupported";
+        break;
+    case alloc_status::INVALID_INTERVAL:
+        stream << "Invalid interval";
+        break;
+    }
+
+    return stream;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "jni.h"
+#include "jvmti.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+enum class alloc_status : uint8_t {
+    OK = 0,
+    // the JVM doesn't offer SampledObjectAlloc (before 11) or object tags
+    UNSUPPORTED,
+    INVALID_INTERVAL
+};
+
+std::ostream& operator<<(std::ostream& stream, alloc_status status);
+
+// One allocating class and stack. Claimed by swapping its hash in and only
+// read once ready, counters are plain atomics so threads hitting the same
+// site never wait for each other.
+struct alloc_site {
+    static constexpr jint MAX_DEPTH = 64;
+
+    // 0 while free
+    std::atomic<uint64_t> hash;
+    std::atomic<bool> ready;
+
+    uint32_t clazz;
+    jint depth;
+    jmethodID frames[MAX_DEPTH];
+
+    std::atomic<uint64_t> samples;
+    std::atomic<uint64_t> bytes;
+};
+
+// Open addressing over a fixed number of sites, allocated once. Sites that
+// find no free slot within a few probes are only counted as a total. The
+// contention profiler keeps its waits in one too, microseconds for bytes.
+class alloc_table {
+
+public:
+
+    static constexpr size_t SITES = 4096;
+    static constexpr size_t PROBES = 32;
+
+    std::unique_ptr<alloc_site[]> sites;
+
+    std::atomic<uint64_t> overflow_samples;
+    std::atomic<uint64_t> overflow_bytes;
+
+    alloc_table();
+
+    // never 0, which marks a free site
+    static uint64_t hash_of(uint32_t clazz, const jvmtiFrameInfo* frames, jint depth);
+
+    void record(uint64_t hash, uint32_t clazz, const jvmtiFrameInfo* frames, jint depth, jlong size);
+    void clear();
+
+};
+
+// Allocation sites from JVMTI SampledObjectAlloc. The JVM picks roughly one
+// allocation per `interval` bytes per thread, the event takes that thread's
+// stack and adds the object's size to the site of its class and stack.
+// Classes are told apart by their class_tags id, which costs a lock and a name
+// lookup only the first time a class is sampled. Methods stay raw jmethodIDs
+// until a report asks for them.
+class alloc_profiler {
+
+    static constexpr jint DEFAULT_INTERVAL = 512 * 1024;
+
+    // the one being recorded into and the one to switch to on reset, which is
+    // cleared right before the switch rather than right after the last one
+    alloc_table tables[2];
+    std::atomic<size_t> current;
+
+    std::mutex lock;
+    bool running;
+
+    alloc_profiler();
+
+public:
+
+    static alloc_profiler* get();
+
+    // an interval of 0 means the default of 512k
+    alloc_status start(jint interval);
+    void stop();
+
+    // SampledObjectAlloc callback
+    void on_alloc(jvmtiEnv* ti, jclass clazz, jlong size);
+
+    // "bytes\tsamples\tclass\touter;...;inner" per site, the `limit` sites with
+    // the most sampled bytes first. reset starts a new profile
+    std::string report(size_t limit, bool reset);
+
+};
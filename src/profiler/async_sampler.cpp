@@ -0,0 +1,297 @@
+#include "async_sampler.hpp"
+#include "../java/java.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <string_view>
+#include <system_error>
+
+#ifndef _WIN32
+#include <csignal>
+#include <dlfcn.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using asgct_fn = void (*)(asgct_trace* trace, jint depth, void* context);
+
+// read by the signal handler, so plain globals set before the timer is armed
+static asgct_fn asgct = nullptr;
+static JavaVM* handler_vm = nullptr;
+static std::atomic<uint64_t> dropped = 0;
+
+// AsyncGetCallTrace failures by -frame_count
+static constexpr std::string_view failures[] = {
+    "[no_java_frame]", "[no_class_load]", "[gc_active]", "[unknown_not_java]", "[not_walkable_not_java]",
+    "[unknown_java]", "[not_walkable_java]", "[unknown_state]", "[thread_exit]", "[deopt]", "[safepoint]"
+};
+
+sample_ring::sample_ring() : tail(0), head(0) {
+    for (size_t i = 0; i < SLOTS; i++)
+        samples[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+async_sample* sample_ring::reserve(size_t& position) {
+    position = tail.load(std::memory_order_relaxed);
+
+    while (true) {
+        auto sample = &samples[position % SLOTS];
+        auto sequence = sample->sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        if (difference == 0) {
+            if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                return sample;
+        } else if (difference < 0) {
+            // the drain thread hasn't caught up yet
+            return nullptr;
+        } else {
+            position = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void sample_ring::publish(async_sample* sample, size_t position) {
+    sample->sequence.store(position + 1, std::memory_order_release);
+}
+
+async_sample* sample_ring::peek() {
+    auto sample = &samples[head % SLOTS];
+    if (sample->sequence.load(std::memory_order_acquire) != head + 1)
+        return nullptr;
+
+    return sample;
+}
+
+void sample_ring::release(async_sample* sample) {
+    sample->sequence.store(head + SLOTS, std::memory_order_release);
+    head++;
+}
+
+#ifndef _WIN32
+static void on_sigprof(int signal, siginfo_t* info, void* context) {
+    auto saved = errno;
+
+    // GetEnv only reads the current thread, threads the JVM doesn't know have no stack for us
+    JNIEnv* env = nullptr;
+    if (handler_vm == nullptr || handler_vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        errno = saved;
+        return;
+    }
+
+    auto ring = async_sampler::get()->ring_of(syscall(SYS_gettid));
+
+    size_t position;
+    auto sample = ring != nullptr ? ring->reserve(position) : nullptr;
+    if (sample == nullptr) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        errno = saved;
+        return;
+    }
+
+    auto trace = asgct_trace { .env = env, .frame_count = 0, .frames = sample->frames };
+    asgct(&trace, async_sample::MAX_DEPTH, context);
+
+    sample->frame_count = trace.frame_count;
+    ring->publish(sample, position);
+
+    errno = saved;
+}
+#endif
+
+async_sampler::async_sampler() : tree(MAX_NODES), running(false), preparing(false) {}
+
+async_sampler* async_sampler::get() {
+    static async_sampler instance;
+    return &instance;
+}
+
+sample_ring* async_sampler::ring_of(uint64_t thread_id) {
+    auto shards = rings.get();
+    return shards != nullptr ? &(*shards)[thread_id % SHARDS] : nullptr;
+}
+
+void async_sampler::prepare(jvmtiEnv* ti, jclass clazz) {
+    if (!preparing.load(std::memory_order_relaxed))
+        return;
+
+    // asking for the methods is what makes the JVM create their IDs
+    jint count = 0;
+    jmethodID* methods = nullptr;
+    if (ti->GetClassMethods(clazz, &count, &methods) == JVMTI_ERROR_NONE)
+        ti->Deallocate(reinterpret_cast<unsigned char*>(methods));
+}
+
+async_status async_sampler::start(std::chrono::microseconds interval) {
+#ifdef _WIN32
+    return async_status::UNSUPPORTED;
+#else
+    stop();
+
+    if (asgct == nullptr)
+        asgct = reinterpret_cast<asgct_fn>(dlsym(RTLD_DEFAULT, "AsyncGetCallTrace"));
+
+    if (asgct == nullptr)
+        return async_status::UNSUPPORTED;
+
+    auto jvm = java::get();
+    auto env = jvm->env();
+    auto ti = jvm->ti();
+
+    if (rings == nullptr)
+        rings = std::make_unique<std::array<sample_ring, SHARDS>>();
+
+    handler_vm = jvm->jvm();
+
+    // stays installed after stop, a SIGPROF still pending somewhere would kill the process under the default action
+    struct sigaction action {};
+    action.sa_sigaction = on_sigprof;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    struct sigaction previous {};
+    if (sigaction(SIGPROF, &action, &previous) != 0)
+        return async_status::TIMER_FAILED;
+
+    // classes prepared from here on get their IDs in the ClassPrepare hook, everything older right now
+    preparing.store(true, std::memory_order_relaxed);
+
+    jint count = 0;
+    jclass* classes = nullptr;
+    if (ti->GetLoadedClasses(&count, &classes) == JVMTI_ERROR_NONE) {
+        for (jint i = 0; i < count; i++) {
+            prepare(ti, classes[i]);
+            env->DeleteLocalRef(classes[i]);
+        }
+
+        ti->Deallocate(reinterpret_cast<unsigned char*>(classes));
+    }
+
+    // HotSpot refuses to walk stacks unless somebody listens for class loads
+    ti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_CLASS_LOAD, nullptr);
+
+    {
+        std::lock_guard guard(lock);
+        running = true;
+    }
+
+    try {
+        drainer = std::make_unique<std::thread>([this] { run(); });
+    } catch (const std::system_error&) {
+        // the timer isn't armed yet, so no SIGPROF of ours can be pending and the old action is safe to restore
+        stop();
+        sigaction(SIGPROF, &previous, nullptr);
+        return async_status::THREAD_FAILED;
+    }
+
+    auto micros = std::max<int64_t>(interval.count(), 1000);
+    auto timer = itimerval {
+        .it_interval = { .tv_sec = static_cast<time_t>(micros / 1000000), .tv_usec = static_cast<suseconds_t>(micros % 1000000) },
+        .it_value = { .tv_sec = static_cast<time_t>(micros / 1000000), .tv_usec = static_cast<suseconds_t>(micros % 1000000) }
+    };
+
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        stop();
+        return async_status::TIMER_FAILED;
+    }
+
+    return async_status::OK;
+#endif
+}
+
+void async_sampler::stop() {
+#ifndef _WIN32
+    {
+        std::lock_guard guard(lock);
+        if (!running)
+            return;
+
+        running = false;
+    }
+
+    auto disarmed = itimerval {};
+    setitimer(ITIMER_PROF, &disarmed, nullptr);
+
+    java::get()->ti()->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_CLASS_LOAD, nullptr);
+    preparing.store(false, std::memory_order_relaxed);
+
+    wakeup.notify_all();
+
+    if (drainer != nullptr && drainer->joinable())
+        drainer->join();
+
+    drainer.reset();
+#endif
+}
+
+void async_sampler::drain(jvmtiEnv* ti) {
+    jvmtiFrameInfo frames[async_sample::MAX_DEPTH];
+
+    for (auto& ring : *rings) {
+        for (async_sample* sample; (sample = ring.peek()) != nullptr;) {
+            auto count = sample->frame_count;
+
+            if (count > 0) {
+                for (jint i = 0; i < count; i++)
+                    frames[i] = jvmtiFrameInfo { .method = sample->frames[i].method, .location = sample->frames[i].line };
+
+                tree.add(ti, frames, count);
+            } else {
+                auto failure = static_cast<size_t>(-count);
+                tree.add(ti, failure < std::size(failures) ? failures[failure] : "[unknown_failure]", nullptr, 0);
+            }
+
+            ring.release(sample);
+        }
+    }
+
+    auto lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0)
+        tree.add(ti, "[dropped]", nullptr, 0, lost);
+}
+
+void async_sampler::run() {
+    auto jvm = java::get();
+
+    // attached, name lookups are JVMTI calls
+    jvm->env();
+    auto ti = jvm->ti();
+
+    std::unique_lock guard(lock);
+    while (running) {
+        wakeup.wait_for(guard, std::chrono::milliseconds(10), [this] { return !running; });
+
+        guard.unlock();
+        drain(ti);
+        guard.lock();
+    }
+}
+
+std::string async_sampler::report(bool reset) {
+    auto collapsed = tree.collapsed();
+    if (reset)
+        tree.clear();
+
+    return collapsed;
+}
+
+std::ostream& operator<<(std::ostream& stream, async_status status) {
+
+    switch (status) {
+    case async_status::OK:
+        stream << "OK";
+        break;
+    case async_status::UNSUPPORTED:
+        stream << "Unsupported";
+        break;
+    case async_status::TIMER_FAILED:
+        stream << "Timer failed";
+        break;
+    case async_status::THREAD_FAILED:
+        stream << "Thread failed";
+        break;
+    }
+
+    return stream;
+}
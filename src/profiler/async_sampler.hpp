@@ -0,0 +1,124 @@
+#pragma once
+
+#include "call_tree.hpp"
+#include "jni.h"
+#include "jvmti.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+enum class async_status : uint8_t {
+    OK = 0,
+    // no AsyncGetCallTrace in this JVM, or no SIGPROF on this platform
+    UNSUPPORTED,
+    TIMER_FAILED,
+    // the drainer thread couldn't be created
+    THREAD_FAILED
+};
+
+std::ostream& operator<<(std::ostream& stream, async_status status);
+
+// frames of HotSpot's AsyncGetCallTrace, which no header declares
+struct asgct_frame {
+    // bci, or negative for native and unknown frames
+    jint line;
+    jmethodID method;
+};
+
+struct asgct_trace {
+    JNIEnv* env;
+    // negative numbers are the reasons no stack could be taken
+    jint frame_count;
+    asgct_frame* frames;
+};
+
+// One raw stack from the signal handler, waiting for the drain thread.
+struct async_sample {
+    static constexpr jint MAX_DEPTH = 128;
+
+    // Vyukov style: equal to the ring position once free, position + 1 once filled
+    std::atomic<size_t> sequence;
+
+    jint frame_count;
+    asgct_frame frames[MAX_DEPTH];
+};
+
+// Bounded multi producer, single consumer queue. Producers are signal
+// handlers, so reserving and publishing a slot is nothing but atomics.
+class sample_ring {
+
+public:
+
+    static constexpr size_t SLOTS = 512;
+
+    std::atomic<size_t> tail;
+    size_t head;
+
+    std::array<async_sample, SLOTS> samples;
+
+    sample_ring();
+
+    // null if the ring is full
+    async_sample* reserve(size_t& position);
+    void publish(async_sample* sample, size_t position);
+
+    // drain thread only, null if nothing is published
+    async_sample* peek();
+    void release(async_sample* sample);
+
+};
+
+// CPU sampling without safepoint bias. SIGPROF fires on whichever thread is
+// burning process CPU time, and the handler has AsyncGetCallTrace walk that
+// thread's stack right where it was interrupted. Raw method IDs go into
+// preallocated rings sharded by thread id, a background thread moves them
+// into a call tree and resolves names there.
+class async_sampler {
+
+    static constexpr size_t SHARDS = 8;
+    static constexpr size_t MAX_NODES = 1 << 20;
+
+    // the handler may still be running on some thread after stop, so the rings
+    // stay around for the rest of the process once created
+    std::unique_ptr<std::array<sample_ring, SHARDS>> rings;
+
+    call_tree tree;
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::unique_ptr<std::thread> drainer;
+    bool running;
+
+    // AsyncGetCallTrace only walks stacks once every method has its jmethodID
+    std::atomic<bool> preparing;
+
+    async_sampler();
+
+    void drain(jvmtiEnv* ti);
+    void run();
+
+public:
+
+    static async_sampler* get();
+
+    // restarts with the new interval if already running. the interval is in
+    // process CPU time, across all threads
+    async_status start(std::chrono::microseconds interval);
+    void stop();
+
+    // from ClassPrepare, creates the jmethodIDs of the class while the sampler is on
+    void prepare(jvmtiEnv* ti, jclass clazz);
+
+    std::string report(bool reset);
+
+    // signal handler side
+    sample_ring* ring_of(uint64_t thread_id);
+
+};
@@ -0,0 +1,185 @@
+#include "call_tree.hpp"
+#include <algorithm>
+#include <sstream>
+
+std::string class_name(std::string_view signature) {
+    if (signature.size() > 2 && signature.front() == 'L' && signature.back() == ';')
+        signature = signature.substr(1, signature.size() - 2);
+
+    std::string name(signature);
+    std::replace(name.begin(), name.end(), '/', '.');
+
+    return name;
+}
+
+std::string method_name(jvmtiEnv* ti, jmethodID method) {
+    char* name = nullptr;
+    if (ti->GetMethodName(method, &name, nullptr, nullptr) != JVMTI_ERROR_NONE)
+        return "[unknown]";
+
+    std::string result;
+
+    jclass clazz = nullptr;
+    char* signature = nullptr;
+    if (ti->GetMethodDeclaringClass(method, &clazz) == JVMTI_ERROR_NONE && ti->GetClassSignature(clazz, &signature, nullptr) == JVMTI_ERROR_NONE) {
+        result = class_name(signature);
+        result.push_back('.');
+
+        ti->Deallocate(reinterpret_cast<unsigned char*>(signature));
+    }
+
+    result.append(name);
+    ti->Deallocate(reinterpret_cast<unsigned char*>(name));
+
+    // the collapsed format separates frames with ';' and the count with ' '
+    std::replace(result.begin(), result.end(), ';', ':');
+    std::replace(result.begin(), result.end(), ' ', '_');
+
+    return result;
+}
+
+class_tags::class_tags() {}
+
+class_tags* class_tags::get() {
+    static class_tags instance;
+    return &instance;
+}
+
+uint32_t class_tags::id_of(jvmtiEnv* ti, jclass clazz) {
+    jlong tag = 0;
+    if (ti->GetTag(clazz, &tag) == JVMTI_ERROR_NONE && tag != 0)
+        return static_cast<uint32_t>(tag - 1);
+
+    std::lock_guard guard(lock);
+
+    // another thread may have tagged it while this one waited, a class only ever gets one id
+    if (ti->GetTag(clazz, &tag) == JVMTI_ERROR_NONE && tag != 0)
+        return static_cast<uint32_t>(tag - 1);
+
+    // first time this class shows up, the only time its name is looked up
+    char* signature = nullptr;
+    std::string name = "[unknown]";
+    if (ti->GetClassSignature(clazz, &signature, nullptr) == JVMTI_ERROR_NONE) {
+        name = class_name(signature);
+        ti->Deallocate(reinterpret_cast<unsigned char*>(signature));
+    }
+
+    auto id = static_cast<uint32_t>(names.size());
+    names.push_back(std::move(name));
+    ti->SetTag(clazz, static_cast<jlong>(id) + 1);
+
+    return id;
+}
+
+std::string class_tags::name_of(uint32_t id) {
+    std::lock_guard guard(lock);
+    return id < names.size() ? names[id] : "[unknown]";
+}
+
+call_tree::call_tree(size_t max_nodes) : max_nodes(max_nodes), nodes { node { 0, ROOT, 0 } }, samples(0) {}
+
+uint32_t call_tree::intern(jvmtiEnv* ti, jmethodID method) {
+    auto [pos, inserted] = frame_ids.emplace(method, frame_names.size());
+    if (inserted)
+        frame_names.push_back(method_name(ti, method));
+
+    return pos->second;
+}
+
+uint32_t call_tree::intern(std::string_view name) {
+    std::string frame(name);
+    std::replace(frame.begin(), frame.end(), ';', ':');
+    std::replace(frame.begin(), frame.end(), ' ', '_');
+
+    auto [pos, inserted] = named_ids.emplace(frame, frame_names.size());
+    if (inserted)
+        frame_names.push_back(std::move(frame));
+
+    return pos->second;
+}
+
+uint32_t call_tree::child(uint32_t parent, uint32_t frame) {
+    auto key = static_cast<uint64_t>(parent) << 32 | frame;
+
+    auto pos = children.find(key);
+    if (pos != children.end())
+        return pos->second;
+
+    // full, the sample is counted at the deepest node that already exists
+    if (nodes.size() >= max_nodes)
+        return parent;
+
+    auto id = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(node { frame, parent, 0 });
+    children.emplace(key, id);
+
+    return id;
+}
+
+void call_tree::add_locked(jvmtiEnv* ti, uint32_t current, const jvmtiFrameInfo* frames, jint depth, uint64_t weight) {
+    for (auto i = depth - 1; i >= 0; i--) {
+        auto next = child(current, intern(ti, frames[i].method));
+        if (next == current)
+            break;
+
+        current = next;
+    }
+
+    nodes[current].self += weight;
+    samples += weight;
+}
+
+void call_tree::add(jvmtiEnv* ti, const jvmtiFrameInfo* frames, jint depth, uint64_t weight) {
+    std::lock_guard guard(lock);
+    add_locked(ti, ROOT, frames, depth, weight);
+}
+
+void call_tree::add(jvmtiEnv* ti, std::string_view root, const jvmtiFrameInfo* frames, jint depth, uint64_t weight) {
+    std::lock_guard guard(lock);
+    add_locked(ti, child(ROOT, intern(root)), frames, depth, weight);
+}
+
+std::string call_tree::collapsed() {
+    std::lock_guard guard(lock);
+
+    std::stringstream stream;
+    std::vector<uint32_t> path;
+
+    for (uint32_t id = 1; id < nodes.size(); id++) {
+        if (nodes[id].self == 0)
+            continue;
+
+        path.clear();
+        for (auto at = id; at != ROOT; at = nodes[at].parent)
+            path.push_back(nodes[at].frame);
+
+        for (auto frame = path.rbegin(); frame != path.rend(); ++frame) {
+            if (frame != path.rbegin())
+                stream << ';';
+
+            stream << frame_names[*frame];
+        }
+
+        stream << ' ' << nodes[id].self << '\n';
+    }
+
+    return stream.str();
+}
+
+uint64_t call_tree::total() {
+    std::lock_guard guard(lock);
+    return samples;
+}
+
+void call_tree::clear() {
+    std::lock_guard guard(lock);
+
+    frame_ids.clear();
+    named_ids.clear();
+    frame_names.clear();
+
+    nodes.assign(1, node { 0, ROOT, 0 });
+    children.clear();
+
+    samples = 0;
+}
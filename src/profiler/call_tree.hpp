@@ -0,0 +1,95 @@
+#pragma once
+
+#include "jvmti.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Stacks aggregated by path. Every distinct method becomes one interned frame
+// and every distinct path from the root one node with its own count, so memory
+// grows with the number of unique stacks and never with the number of
+// samples. Names are resolved once, the first time a method shows up.
+class call_tree {
+
+    struct node {
+        uint32_t frame;
+        uint32_t parent;
+        // samples ending exactly here
+        uint64_t self;
+    };
+
+    // node 0 is the root and has no frame
+    static constexpr uint32_t ROOT = 0;
+
+    size_t max_nodes;
+
+    std::mutex lock;
+
+    std::unordered_map<jmethodID, uint32_t> frame_ids;
+    // synthetic frames, by name
+    std::unordered_map<std::string, uint32_t> named_ids;
+    std::vector<std::string> frame_names;
+
+    std::vector<node> nodes;
+    // parent node << 32 | frame -> child node
+    std::unordered_map<uint64_t, uint32_t> children;
+
+    uint64_t samples;
+
+    uint32_t intern(jvmtiEnv* ti, jmethodID method);
+    uint32_t intern(std::string_view name);
+    uint32_t child(uint32_t parent, uint32_t frame);
+
+    void add_locked(jvmtiEnv* ti, uint32_t current, const jvmtiFrameInfo* frames, jint depth, uint64_t weight);
+
+public:
+
+    call_tree(size_t max_nodes);
+
+    // frames as JVMTI hands them out, innermost first
+    void add(jvmtiEnv* ti, const jvmtiFrameInfo* frames, jint depth, uint64_t weight = 1);
+
+    // same, with a synthetic outermost frame such as a thread or lock name
+    void add(jvmtiEnv* ti, std::string_view root, const jvmtiFrameInfo* frames, jint depth, uint64_t weight = 1);
+
+    // "outer;...;inner count" per path with samples of its own, the format
+    // flamegraph.pl and most viewers take as-is
+    std::string collapsed();
+
+    uint64_t total();
+
+    void clear();
+
+};
+
+// Classes told apart by an object tag holding an interned id, so events can
+// key by class without a global ref or a name lookup each time. Shared by
+// every profiler, they'd overwrite each other's tags otherwise. The caller
+// needs can_tag_objects.
+class class_tags {
+
+    std::mutex lock;
+    // by tag - 1
+    std::vector<std::string> names;
+
+    class_tags();
+
+public:
+
+    static class_tags* get();
+
+    // a GetTag once the class has an id. the first sighting takes the lock and
+    // looks up the name, everyone else seeing it then waits for that id
+    uint32_t id_of(jvmtiEnv* ti, jclass clazz);
+    std::string name_of(uint32_t id);
+
+};
+
+// "Lcom/acme/Foo;" and "bar" as "com.acme.Foo.bar"
+std::string method_name(jvmtiEnv* ti, jmethodID method);
+
+// "Lcom/acme/Foo;" as "com.acme.Foo", arrays stay in descriptor form
+std::string class_name(std::string_view signature);
@@ -0,0 +1,139 @@
+#include "contention_profiler.hpp"
+#include "call_tree.hpp"
+#include "../java/java.hpp"
+#include <algorithm>
+#include <chrono>
+
+// when the current thread started waiting, 0 if it isn't. only counts under the generation it was noted in
+static thread_local uint64_t wait_start = 0;
+static thread_local uint32_t wait_generation = 0;
+
+static uint64_t now_nanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+contention_profiler::contention_profiler() : current(0), generation(0), running(false) {}
+
+contention_profiler* contention_profiler::get() {
+    static contention_profiler instance;
+    return &instance;
+}
+
+contention_status contention_profiler::start() {
+    std::lock_guard guard(lock);
+
+    if (running)
+        return contention_status::OK;
+
+    auto ti = java::get()->ti();
+
+    jvmtiCapabilities wanted {};
+    wanted.can_generate_monitor_events = 1;
+    wanted.can_tag_objects = 1;
+
+    if (ti->AddCapabilities(&wanted) != JVMTI_ERROR_NONE)
+        return contention_status::UNSUPPORTED;
+
+    generation.fetch_add(1, std::memory_order_relaxed);
+
+    ti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_MONITOR_CONTENDED_ENTER, nullptr);
+    ti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_MONITOR_CONTENDED_ENTERED, nullptr);
+
+    running = true;
+    return contention_status::OK;
+}
+
+void contention_profiler::stop() {
+    std::lock_guard guard(lock);
+
+    if (!running)
+        return;
+
+    auto ti = java::get()->ti();
+    ti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_MONITOR_CONTENDED_ENTER, nullptr);
+    ti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_MONITOR_CONTENDED_ENTERED, nullptr);
+
+    // waits that began before this never get their entered event, their timestamps are stale from here on
+    generation.fetch_add(1, std::memory_order_relaxed);
+    running = false;
+}
+
+void contention_profiler::on_enter() {
+    wait_start = now_nanos();
+    wait_generation = generation.load(std::memory_order_relaxed);
+}
+
+void contention_profiler::on_entered(jvmtiEnv* ti, JNIEnv* env, jobject monitor) {
+    // enabled while this thread was already waiting, or left over from before a restart
+    if (wait_start == 0 || wait_generation != generation.load(std::memory_order_relaxed)) {
+        wait_start = 0;
+        return;
+    }
+
+    // rounded up, so short waits still leave their stack in the profile
+    auto micros = (now_nanos() - wait_start + 999) / 1000;
+    wait_start = 0;
+
+    jvmtiFrameInfo frames[alloc_site::MAX_DEPTH];
+    jint depth = 0;
+    if (ti->GetStackTrace(nullptr, 0, alloc_site::MAX_DEPTH, frames, &depth) != JVMTI_ERROR_NONE)
+        depth = 0;
+
+    auto clazz = env->GetObjectClass(monitor);
+    auto id = class_tags::get()->id_of(ti, clazz);
+    env->DeleteLocalRef(clazz);
+
+    tables[current.load(std::memory_order_acquire)].record(alloc_table::hash_of(id, frames, depth), id, frames, depth, micros);
+}
+
+std::string contention_profiler::report(bool reset) {
+    std::lock_guard guard(lock);
+
+    auto ti = java::get()->ti();
+
+    auto index = current.load(std::memory_order_relaxed);
+    auto& table = tables[index];
+
+    if (reset) {
+        tables[index ^ 1].clear();
+        current.store(index ^ 1, std::memory_order_release);
+    }
+
+    // names are only looked up here, once per method per report
+    call_tree tree(MAX_NODES);
+    jvmtiFrameInfo frames[alloc_site::MAX_DEPTH];
+
+    for (size_t i = 0; i < alloc_table::SITES; i++) {
+        auto& site = table.sites[i];
+        if (!site.ready.load(std::memory_order_acquire))
+            continue;
+
+        auto micros = site.bytes.load(std::memory_order_relaxed);
+        if (micros == 0)
+            continue;
+
+        for (jint frame = 0; frame < site.depth; frame++)
+            frames[frame] = jvmtiFrameInfo { .method = site.frames[frame], .location = 0 };
+
+        tree.add(ti, class_tags::get()->name_of(site.clazz), frames, site.depth, micros);
+    }
+
+    if (auto overflow = table.overflow_bytes.load(std::memory_order_relaxed); overflow > 0)
+        tree.add(ti, "[other]", nullptr, 0, overflow);
+
+    return tree.collapsed();
+}
+
+std::ostream& operator<<(std::ostream& stream, contention_status status) {
+
+    switch (status) {
+    case contention_status::OK:
+        stream << "OK";
+        break;
+    case contention_status::UNSUPPORTED:
+        stream << "Unsupported";
+        break;
+    }
+
+    return stream;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "alloc_profiler.hpp"
+#include "jni.h"
+#include "jvmti.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+enum class contention_status : uint8_t {
+    OK = 0,
+    // no monitor events or object tags in this JVM
+    UNSUPPORTED
+};
+
+std::ostream& operator<<(std::ostream& stream, contention_status status);
+
+// Time spent blocked on contended synchronized monitors. MonitorContendedEnter
+// notes when a thread starts waiting, MonitorContendedEntered on the same
+// thread adds the microseconds blocked to the site of the monitor's class and
+// the raw stack, without a lock, so the profiler doesn't serialize the very
+// threads it measures. Names are resolved and the call tree is built when a
+// report asks for it. Uncontended locking never raises an event, so the cost
+// scales with contention only, and nothing at all while it's off.
+// java.util.concurrent locks park instead and don't show up here.
+class contention_profiler {
+
+    static constexpr size_t MAX_NODES = 1 << 18;
+
+    // switched like the alloc_profiler's on reset, the other one is cleared right before
+    alloc_table tables[2];
+    std::atomic<size_t> current;
+
+    // bumped on every start and stop, a wait noted under an older one is dropped
+    std::atomic<uint32_t> generation;
+
+    std::mutex lock;
+    bool running;
+
+    contention_profiler();
+
+public:
+
+    static contention_profiler* get();
+
+    contention_status start();
+    void stop();
+
+    void on_enter();
+    void on_entered(jvmtiEnv* ti, JNIEnv* env, jobject monitor);
+
+    // collapsed stacks rooted at the monitor class, "class;outer;...;inner micros"
+    std::string report(bool reset);
+
+};
@@ -0,0 +1,193 @@
+#include "gc_monitor.hpp"
+#include "../java/java.hpp"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+pause_histogram::pause_histogram() : total(0), sum(0), max(0) {
+    for (auto& count : counts)
+        count.store(0, std::memory_order_relaxed);
+}
+
+size_t pause_histogram::bucket_of(uint64_t micros) {
+    if (micros < SUB_BUCKETS)
+        return micros;
+
+    // 4 for the first range above the exact buckets, 16..31
+    uint32_t exponent = std::min<uint32_t>(std::bit_width(micros) - 1, MAX_EXPONENT);
+    auto sub_bucket = std::min<uint64_t>((micros >> (exponent - 4)) - SUB_BUCKETS, SUB_BUCKETS - 1);
+
+    return SUB_BUCKETS + (exponent - 4) * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t pause_histogram::upper_bound(size_t bucket) {
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    auto exponent = (bucket - SUB_BUCKETS) / SUB_BUCKETS + 4;
+    auto sub_bucket = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+
+    return ((SUB_BUCKETS + sub_bucket + 1) << (exponent - 4)) - 1;
+}
+
+void pause_histogram::record(uint64_t micros) {
+    counts[bucket_of(micros)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(micros, std::memory_order_relaxed);
+
+    auto previous = max.load(std::memory_order_relaxed);
+    while (micros > previous && !max.compare_exchange_weak(previous, micros, std::memory_order_relaxed));
+}
+
+uint64_t pause_histogram::percentile(double fraction) {
+    auto count = total.load(std::memory_order_relaxed);
+    if (count == 0)
+        return 0;
+
+    auto wanted = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * count)));
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; bucket++) {
+        seen += counts[bucket].load(std::memory_order_relaxed);
+        if (seen >= wanted)
+            return std::min(upper_bound(bucket), max.load(std::memory_order_relaxed));
+    }
+
+    return max.load(std::memory_order_relaxed);
+}
+
+void pause_histogram::clear() {
+    for (auto& count : counts)
+        count.store(0, std::memory_order_relaxed);
+
+    total.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+gc_monitor::gc_monitor() : recent {}, claimed(0), written(0), reported(0), start_nanos(0), start_epoch_micros(0), running(false) {}
+
+gc_monitor* gc_monitor::get() {
+    static gc_monitor instance;
+    return &instance;
+}
+
+gc_status gc_monitor::start() {
+    std::lock_guard guard(lock);
+
+    if (running)
+        return gc_status::OK;
+
+    auto ti = java::get()->ti();
+
+    jvmtiCapabilities wanted {};
+    wanted.can_generate_garbage_collection_events = 1;
+
+    if (ti->AddCapabilities(&wanted) != JVMTI_ERROR_NONE)
+        return gc_status::UNSUPPORTED;
+
+    ti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_GARBAGE_COLLECTION_START, nullptr);
+    ti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_GARBAGE_COLLECTION_FINISH, nullptr);
+
+    running = true;
+    return gc_status::OK;
+}
+
+void gc_monitor::stop() {
+    std::lock_guard guard(lock);
+
+    if (!running)
+        return;
+
+    auto ti = java::get()->ti();
+    ti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_GARBAGE_COLLECTION_START, nullptr);
+    ti->SetEventNotificationMode(JVMTI_DISABLE, JVMTI_EVENT_GARBAGE_COLLECTION_FINISH, nullptr);
+
+    running = false;
+}
+
+void gc_monitor::on_start() {
+    start_nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    start_epoch_micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void gc_monitor::on_finish() {
+    // enabled in the middle of a pause, there's no start to pair this with
+    if (start_nanos == 0)
+        return;
+
+    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    auto micros = (now - start_nanos) / 1000;
+    start_nanos = 0;
+
+    histogram.record(micros);
+
+    // the only writer, a report racing with this finds out through claimed which slots it lost
+    auto at = written.load(std::memory_order_relaxed);
+    claimed.store(at + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    auto& slot = recent[at % RECENT];
+    slot.start_epoch_micros.store(start_epoch_micros, std::memory_order_relaxed);
+    slot.micros.store(micros, std::memory_order_relaxed);
+
+    written.store(at + 1, std::memory_order_release);
+}
+
+std::string gc_monitor::report(bool reset) {
+    std::stringstream stream;
+
+    stream << "pauses\t" << histogram.total.load(std::memory_order_relaxed) << '\n';
+    stream << "sum\t" << histogram.sum.load(std::memory_order_relaxed) << '\n';
+    stream << "max\t" << histogram.max.load(std::memory_order_relaxed) << '\n';
+    stream << "p50\t" << histogram.percentile(0.5) << '\n';
+    stream << "p90\t" << histogram.percentile(0.9) << '\n';
+    stream << "p99\t" << histogram.percentile(0.99) << '\n';
+    stream << "p999\t" << histogram.percentile(0.999) << '\n';
+    stream << '\n';
+
+    std::lock_guard guard(lock);
+
+    // copied without stopping the pause, then checked against what it claimed since
+    auto end = written.load(std::memory_order_acquire);
+    auto first = std::max(reported, end > RECENT ? end - RECENT : 0);
+
+    std::array<gc_pause, RECENT> pauses;
+    for (auto i = first; i < end; i++) {
+        auto& slot = recent[i % RECENT];
+        pauses[i - first] = gc_pause {
+            .start_epoch_micros = slot.start_epoch_micros.load(std::memory_order_relaxed),
+            .micros = slot.micros.load(std::memory_order_relaxed)
+        };
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto overwritten = claimed.load(std::memory_order_relaxed);
+    auto valid = std::max(first, overwritten > RECENT ? overwritten - RECENT : 0);
+
+    for (auto i = valid; i < end; i++)
+        stream << pauses[i - first].start_epoch_micros << '\t' << pauses[i - first].micros << '\n';
+
+    if (reset) {
+        histogram.clear();
+        reported = end;
+    }
+
+    return stream.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, gc_status status) {
+
+    switch (status) {
+    case gc_status::OK:
+        stream << "OK";
+        break;
+    case gc_status::UNSUPPORTED:
+        stream << "Unsupported";
+        break;
+    }
+
+    return stream;
+}
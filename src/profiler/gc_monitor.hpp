@@ -0,0 +1,101 @@
+#pragma once
+
+#include "jvmti.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+enum class gc_status : uint8_t {
+    OK = 0,
+    // no can_generate_garbage_collection_events in this JVM
+    UNSUPPORTED
+};
+
+std::ostream& operator<<(std::ostream& stream, gc_status status);
+
+// Log-linear buckets of microseconds, HdrHistogram style: exact below 16,
+// above that 16 buckets per power of two, so any value is off by at most 1/16.
+class pause_histogram {
+
+public:
+
+    static constexpr uint32_t SUB_BUCKETS = 16;
+    static constexpr uint32_t MAX_EXPONENT = 40;
+    static constexpr size_t BUCKETS = SUB_BUCKETS + (MAX_EXPONENT - 3) * SUB_BUCKETS;
+
+    std::array<std::atomic<uint64_t>, BUCKETS> counts;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+
+    pause_histogram();
+
+    static size_t bucket_of(uint64_t micros);
+    // the highest value that lands in the bucket
+    static uint64_t upper_bound(size_t bucket);
+
+    void record(uint64_t micros);
+    uint64_t percentile(double fraction);
+    void clear();
+
+};
+
+struct gc_pause {
+    // system clock, to line pauses up with latency graphs elsewhere
+    uint64_t start_epoch_micros;
+    uint64_t micros;
+};
+
+// Stop-the-world pauses from JVMTI GarbageCollectionStart / Finish. The pair
+// is timed with a monotonic clock, each pause goes into a histogram and a ring
+// of the most recent ones. The callbacks run inside the pause, where JNI is
+// off limits, so they do nothing beyond taking the time and a few atomics.
+class gc_monitor {
+
+    static constexpr size_t RECENT = 256;
+
+    pause_histogram histogram;
+
+    struct recent_slot {
+        std::atomic<uint64_t> start_epoch_micros;
+        std::atomic<uint64_t> micros;
+    };
+
+    // written by the pause alone, reports copy it out and drop whatever the
+    // pause overwrote in the meantime
+    std::array<recent_slot, RECENT> recent;
+    // pauses that started overwriting a slot, and pauses done with theirs. the
+    // next one goes to written % RECENT
+    std::atomic<uint64_t> claimed;
+    std::atomic<uint64_t> written;
+    // report side, pauses before it were reset away
+    uint64_t reported;
+
+    // set by GarbageCollectionStart, the JVM never has two pauses going at once
+    uint64_t start_nanos;
+    uint64_t start_epoch_micros;
+
+    std::mutex lock;
+    bool running;
+
+    gc_monitor();
+
+public:
+
+    static gc_monitor* get();
+
+    gc_status start();
+    void stop();
+
+    void on_start();
+    void on_finish();
+
+    // "name\tvalue" lines for the count, sum, max and percentiles in
+    // microseconds, then an empty line and "start\tmicros" per recent pause,
+    // oldest first. reset starts over afterwards
+    std::string report(bool reset);
+
+};
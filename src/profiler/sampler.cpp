@@ -0,0 +1,121 @@
+#include "sampler.hpp"
+#include "../java/frame.hpp"
+#include "../java/java.hpp"
+#include <algorithm>
+#include <system_error>
+
+// a thread ref per live thread, the frame grows past this if there are more
+static constexpr jint SAMPLER_FRAME_CAPACITY = 256;
+
+sampler::sampler() : tree(MAX_NODES), running(false), interval(0) {}
+
+sampler* sampler::get() {
+    static sampler instance;
+    return &instance;
+}
+
+sampler_status sampler::start(std::chrono::microseconds interval) {
+    stop();
+
+    std::lock_guard guard(lock);
+
+    // below this the safepoints alone would eat the target alive
+    this->interval = std::max(interval, std::chrono::microseconds(1000));
+    running = true;
+
+    try {
+        worker = std::make_unique<std::thread>([this] { run(); });
+    } catch (const std::system_error&) {
+        running = false;
+        return sampler_status::THREAD_FAILED;
+    }
+
+    return sampler_status::OK;
+}
+
+void sampler::stop() {
+    {
+        std::lock_guard guard(lock);
+        running = false;
+    }
+
+    wakeup.notify_all();
+
+    if (worker != nullptr && worker->joinable())
+        worker->join();
+
+    worker.reset();
+}
+
+void sampler::run() {
+    auto jvm = java::get();
+
+    // attached as a daemon, and detached again once this thread exits
+    auto env = jvm->env();
+    auto ti = jvm->ti();
+
+    std::unique_lock guard(lock);
+
+    // fixed rate, a slow snapshot doesn't push every later one back
+    auto next = std::chrono::steady_clock::now();
+    while (running) {
+        next += interval;
+
+        guard.unlock();
+        sample(env, ti);
+        guard.lock();
+
+        if (next < std::chrono::steady_clock::now())
+            next = std::chrono::steady_clock::now();
+
+        wakeup.wait_until(guard, next, [this] { return !running; });
+    }
+}
+
+void sampler::sample(JNIEnv* env, jvmtiEnv* ti) {
+    jvmtiStackInfo* stacks = nullptr;
+    jint count = 0;
+
+    // every thread of the snapshot comes back as a local ref
+    static frame_counter counter("sampler");
+    local_frame frame(env, counter, SAMPLER_FRAME_CAPACITY);
+
+    if (ti->GetAllStackTraces(MAX_DEPTH, &stacks, &count) != JVMTI_ERROR_NONE)
+        return;
+
+    for (jint i = 0; i < count; i++) {
+        auto& stack = stacks[i];
+        local_frame::track(stack.thread);
+
+        // blocked, waiting and parked threads aren't burning any cpu
+        if ((stack.state & JVMTI_THREAD_STATE_RUNNABLE) == 0 || stack.frame_count == 0)
+            continue;
+
+        tree.add(ti, stack.frame_buffer, stack.frame_count);
+    }
+
+    // one allocation holding the stack infos and every frame buffer
+    ti->Deallocate(reinterpret_cast<unsigned char*>(stacks));
+}
+
+std::string sampler::report(bool reset) {
+    auto collapsed = tree.collapsed();
+    if (reset)
+        tree.clear();
+
+    return collapsed;
+}
+
+std::ostream& operator<<(std::ostream& stream, sampler_status status) {
+
+    switch (status) {
+    case sampler_status::OK:
+        stream << "OK";
+        break;
+    case sampler_status::THREAD_FAILED:
+        stream << "Thread failed";
+        break;
+    }
+
+    return stream;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "call_tree.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+enum class sampler_status : uint8_t {
+    OK = 0,
+    // the sampling thread couldn't be created
+    THREAD_FAILED
+};
+
+std::ostream& operator<<(std::ostream& stream, sampler_status status);
+
+// Wall clock sampling of running Java threads. Every interval a background
+// thread takes one GetAllStackTraces snapshot, a single safepoint however many
+// threads there are, and adds the stacks of the RUNNABLE ones to a call tree.
+// Threads that are waiting, sleeping or parked are left out, so the result
+// approximates where CPU time goes.
+class sampler {
+
+    static constexpr jint MAX_DEPTH = 256;
+    static constexpr size_t MAX_NODES = 1 << 20;
+
+    call_tree tree;
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::unique_ptr<std::thread> worker;
+    bool running;
+
+    std::chrono::microseconds interval;
+
+    sampler();
+
+    void run();
+    void sample(JNIEnv* env, jvmtiEnv* ti);
+
+public:
+
+    static sampler* get();
+
+    // restarts with the new interval if already running
+    sampler_status start(std::chrono::microseconds interval);
+    void stop();
+
+    // collapsed stacks, see call_tree::collapsed. reset starts a new profile afterwards
+    std::string report(bool reset);
+
+};
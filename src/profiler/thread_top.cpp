@@ -0,0 +1,209 @@
+#include "thread_top.hpp"
+#include "call_tree.hpp"
+#include "../java/frame.hpp"
+#include "../java/java.hpp"
+#include "../java/members.hpp"
+#include <algorithm>
+#include <sstream>
+#include <system_error>
+#include <vector>
+
+using thread_get_id = members::method<"java/lang/Thread", "getId", jlong()>;
+
+// a ref per live thread, the frame grows past this if there are more
+static constexpr jint THREAD_TOP_FRAME_CAPACITY = 256;
+
+thread_top::thread_top() : tick(0), last_tick(std::chrono::steady_clock::now()), elapsed(0), running(false), interval(0) {}
+
+thread_top* thread_top::get() {
+    static thread_top instance;
+    return &instance;
+}
+
+thread_top_status thread_top::start(std::chrono::milliseconds interval) {
+    stop();
+
+    jvmtiCapabilities wanted {};
+    wanted.can_get_thread_cpu_time = 1;
+
+    if (java::get()->ti()->AddCapabilities(&wanted) != JVMTI_ERROR_NONE)
+        return thread_top_status::UNSUPPORTED;
+
+    std::lock_guard guard(lock);
+
+    this->interval = std::max(interval, std::chrono::milliseconds(100));
+    running = true;
+
+    try {
+        worker = std::make_unique<std::thread>([this] { run(); });
+    } catch (const std::system_error&) {
+        running = false;
+        return thread_top_status::THREAD_FAILED;
+    }
+
+    return thread_top_status::OK;
+}
+
+void thread_top::stop() {
+    {
+        std::lock_guard guard(lock);
+        running = false;
+    }
+
+    wakeup.notify_all();
+
+    if (worker != nullptr && worker->joinable())
+        worker->join();
+
+    worker.reset();
+
+    // the next start begins from scratch, stale deltas would only mislead
+    auto env = java::get()->env();
+
+    std::lock_guard guard(lock);
+    for (auto& [id, usage] : threads)
+        env->DeleteGlobalRef(usage.thread);
+
+    threads.clear();
+}
+
+void thread_top::run() {
+    auto jvm = java::get();
+
+    // attached as a daemon, and detached again once this thread exits
+    auto env = jvm->env();
+    auto ti = jvm->ti();
+
+    std::unique_lock guard(lock);
+    while (running) {
+        guard.unlock();
+        sample(env, ti);
+        guard.lock();
+
+        wakeup.wait_for(guard, interval, [this] { return !running; });
+    }
+}
+
+void thread_top::sample(JNIEnv* env, jvmtiEnv* ti) {
+    static frame_counter counter("thread top");
+    local_frame frame(env, counter, THREAD_TOP_FRAME_CAPACITY);
+
+    if (members::id_of(env, thread_get_id::slot) == nullptr)
+        return;
+
+    jint count = 0;
+    jthread* live = nullptr;
+    if (ti->GetAllThreads(&count, &live) != JVMTI_ERROR_NONE)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard guard(lock);
+
+    tick++;
+    elapsed = now - last_tick;
+    last_tick = now;
+
+    for (jint i = 0; i < count; i++) {
+        auto thread = local_frame::track(live[i]);
+
+        jlong cpu = 0;
+        if (ti->GetThreadCpuTime(thread, &cpu) != JVMTI_ERROR_NONE)
+            continue;
+
+        auto id = thread_get_id::call(env, thread);
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            continue;
+        }
+
+        auto [pos, inserted] = threads.try_emplace(id);
+        auto& usage = pos->second;
+
+        if (inserted) {
+            usage.thread = env->NewGlobalRef(thread);
+            usage.cpu_nanos = cpu;
+        }
+
+        // threads can be renamed at any point
+        jvmtiThreadInfo info {};
+        if (ti->GetThreadInfo(thread, &info) == JVMTI_ERROR_NONE) {
+            usage.name = info.name != nullptr ? info.name : "";
+            ti->Deallocate(reinterpret_cast<unsigned char*>(info.name));
+
+            if (info.thread_group != nullptr)
+                env->DeleteLocalRef(info.thread_group);
+            if (info.context_class_loader != nullptr)
+                env->DeleteLocalRef(info.context_class_loader);
+        }
+
+        usage.delta_nanos = cpu - usage.cpu_nanos;
+        usage.cpu_nanos = cpu;
+        usage.tick = tick;
+    }
+
+    ti->Deallocate(reinterpret_cast<unsigned char*>(live));
+
+    // whatever wasn't in this snapshot has exited
+    std::erase_if(threads, [&](auto& entry) {
+        if (entry.second.tick == tick)
+            return false;
+
+        env->DeleteGlobalRef(entry.second.thread);
+        return true;
+    });
+}
+
+std::string thread_top::report(size_t limit) {
+    auto jvm = java::get();
+    auto ti = jvm->ti();
+
+    std::lock_guard guard(lock);
+
+    std::vector<std::pair<jlong, thread_usage*>> ranked;
+    for (auto& [id, usage] : threads)
+        ranked.emplace_back(id, &usage);
+
+    auto count = std::min(limit, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), [](auto& a, auto& b) {
+        return a.second->delta_nanos > b.second->delta_nanos;
+    });
+
+    auto window = std::max<int64_t>(elapsed.count(), 1);
+
+    std::stringstream stream;
+    for (size_t i = 0; i < count; i++) {
+        auto [id, usage] = ranked[i];
+
+        auto percent = 100.0 * usage->delta_nanos / window;
+        stream << id << '\t' << static_cast<int64_t>(percent * 10) / 10.0 << '\t' << usage->cpu_nanos / 1000000 << '\t' << usage->name << '\n';
+
+        // the stack right now, not averaged over the interval
+        jvmtiFrameInfo frames[STACK_DEPTH];
+        jint depth = 0;
+        if (ti->GetStackTrace(usage->thread, 0, STACK_DEPTH, frames, &depth) != JVMTI_ERROR_NONE)
+            continue;
+
+        for (jint frame = 0; frame < depth; frame++)
+            stream << '\t' << method_name(ti, frames[frame].method) << '\n';
+    }
+
+    return stream.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, thread_top_status status) {
+
+    switch (status) {
+    case thread_top_status::OK:
+        stream << "OK";
+        break;
+    case thread_top_status::UNSUPPORTED:
+        stream << "Unsupported";
+        break;
+    case thread_top_status::THREAD_FAILED:
+        stream << "Thread failed";
+        break;
+    }
+
+    return stream;
+}
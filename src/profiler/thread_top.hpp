@@ -0,0 +1,77 @@
+#pragma once
+
+#include "jni.h"
+#include "jvmti.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+enum class thread_top_status : uint8_t {
+    OK = 0,
+    // no can_get_thread_cpu_time in this JVM
+    UNSUPPORTED,
+    // the sampling thread couldn't be created
+    THREAD_FAILED
+};
+
+std::ostream& operator<<(std::ostream& stream, thread_top_status status);
+
+struct thread_usage {
+    // global ref, dropped with the entry once the thread is gone
+    jobject thread;
+    std::string name;
+
+    uint64_t cpu_nanos;
+    // over the last interval
+    uint64_t delta_nanos;
+
+    // last tick the thread was alive in
+    uint64_t tick;
+};
+
+// "top" for Java threads. Every interval GetThreadCpuTime is read for every
+// live thread and compared with the previous reading, the table is keyed by
+// Thread.getId() and only ever holds live threads, so cost and memory follow
+// the thread count and nothing accumulates over time.
+class thread_top {
+
+    static constexpr jint STACK_DEPTH = 16;
+
+    std::unordered_map<jlong, thread_usage> threads;
+    uint64_t tick;
+    std::chrono::steady_clock::time_point last_tick;
+    // between the last two ticks, what the deltas are relative to
+    std::chrono::nanoseconds elapsed;
+
+    std::mutex lock;
+    std::condition_variable wakeup;
+    std::unique_ptr<std::thread> worker;
+    bool running;
+
+    std::chrono::milliseconds interval;
+
+    thread_top();
+
+    void run();
+    void sample(JNIEnv* env, jvmtiEnv* ti);
+
+public:
+
+    static thread_top* get();
+
+    // restarts with the new interval if already running
+    thread_top_status start(std::chrono::milliseconds interval);
+    void stop();
+
+    // "id\tcpu percent\tcpu millis\tname" for the `limit` threads with the most
+    // CPU time in the last interval, each followed by its top frames as
+    // "\tframe" lines
+    std::string report(size_t limit);
+
+};
@@ -82,9 +82,16 @@ class method_info:
 
 
 class class_info:
-    def __init__(self, name: str, methods: list[method_info]) -> None:
+    def __init__(self, name: str, methods: list[method_info], supertypes: list[str], references: list[str]) -> None:
         self.methods: list[method_info] = methods
         self.name: str = name
+        # superclass and interfaces, these have to be defined before this class can be
+        self.supertypes: list[str] = supertypes
+        # every other CONSTANT_Class, only resolved once the code actually runs
+        self.references: list[str] = references
+        # set by order_classes
+        self.dependencies: list[int] = []
+        self.level: int = 0
 
     @override
     def __str__(self) -> str:
@@ -121,7 +128,7 @@ class buffer:
         self.pos += count
 
 
-def parse_constant_pool(buf: buffer) -> list:  # pyright: ignore[reportMissingTypeArgument, reportUnknownParameterType]
+def parse_constant_pool(buf: buffer, class_entries: list[int]) -> list:  # pyright: ignore[reportMissingTypeArgument, reportUnknownParameterType]
     constant_pool_count = buf.read_u2()
 
     constant_pool: list = [None]  # pyright: ignore[reportMissingTypeArgument]
@@ -135,6 +142,8 @@ def parse_constant_pool(buf: buffer) -> list:  # pyright: ignore[reportMissingTy
         elif tag in (7, 8):
             index = buf.read_u2()
             constant_pool.append(index)
+            if tag == 7:
+                class_entries.append(i)
         elif tag in (3, 4):
             buf.skip(4)
             constant_pool.append(None)
@@ -188,17 +197,27 @@ def extract_class_information(class_file: str) -> class_info:
     _ = buf.read_u2()  # major version
     _ = buf.read_u2()  # minor version
 
-    constant_pool = parse_constant_pool(buf)
+    class_entries: list[int] = []
+    constant_pool = parse_constant_pool(buf, class_entries)
 
     _ = buf.read_u2()  # access
     this_class_index = buf.read_u2()
     class_name_index = constant_pool[this_class_index]
     class_name = constant_pool[class_name_index]
 
-    _ = buf.read_u2()  # super_class
+    super_class_index = buf.read_u2()
+    supertype_indices = [super_class_index] if super_class_index != 0 else []
 
     interfaces_count = buf.read_u2()
-    buf.skip(interfaces_count * 2)  # u2 = 2 * 1 byte
+    for _ in range(interfaces_count):
+        supertype_indices.append(buf.read_u2())
+
+    supertypes = [constant_pool[constant_pool[index]] for index in supertype_indices]
+    references = [
+        class_entry_name(constant_pool[constant_pool[index]])
+        for index in class_entries
+        if index != this_class_index and index not in supertype_indices
+    ]
 
     fields_count = buf.read_u2()
     for _ in range(fields_count):
@@ -213,7 +232,239 @@ def extract_class_information(class_file: str) -> class_info:
     for m in methods:
         print(m)
 
-    return class_info(class_name.replace("/", "."), methods)
+    return class_info(class_name.replace("/", "."), methods, supertypes, references)
+
+
+def class_entry_name(name: str) -> str:
+    # array classes ("[[Lcom/acme/Foo;") depend on their element class
+    name = name.lstrip("[")
+    if name.startswith("L") and name.endswith(";"):
+        name = name[1:-1]
+    return name
+
+
+def order_classes(infos: list[class_info]) -> list[class_info]:
+    """
+    Sorts the classes so every class comes after the ones it depends on and
+    assigns levels, where a class only depends on classes of lower levels and
+    everything within one level can be defined in parallel. Constant pool
+    references may well be cyclic (Utility <-> its listeners), so inside a
+    cycle only the superclass and interfaces count, those never are.
+    """
+    by_name = {info.name.replace(".", "/"): i for i, info in enumerate(infos)}
+
+    # only classes that are embedded themselves, the JDK is always there already
+    hard = [[by_name[n] for n in info.supertypes if n in by_name] for info in infos]
+    soft = [[by_name[n] for n in info.references if n in by_name] for info in infos]
+
+    # tarjan, for the strongly connected components of the full graph
+    component = [-1] * len(infos)
+    lowlink = [0] * len(infos)
+    visit = [-1] * len(infos)
+    stack: list[int] = []
+    counter = 0
+    components = 0
+
+    def connect(node: int) -> None:
+        nonlocal counter, components
+        visit[node] = lowlink[node] = counter
+        counter += 1
+        stack.append(node)
+
+        for edge in hard[node] + soft[node]:
+            if visit[edge] == -1:
+                connect(edge)
+                lowlink[node] = min(lowlink[node], lowlink[edge])
+            elif component[edge] == -1:
+                lowlink[node] = min(lowlink[node], visit[edge])
+
+        if lowlink[node] == visit[node]:
+            while True:
+                member = stack.pop()
+                component[member] = components
+                if member == node:
+                    break
+            components += 1
+
+    for node in range(len(infos)):
+        if visit[node] == -1:
+            connect(node)
+
+    edges = [
+        sorted(set(hard[node] + [edge for edge in soft[node] if component[edge] != component[node]]) - {node})
+        for node in range(len(infos))
+    ]
+
+    # longest path from a class without dependencies, the graph is acyclic now
+    levels: list[int | None] = [None] * len(infos)
+
+    def level_of(node: int) -> int:
+        level = levels[node]
+        if level is None:
+            level = max((level_of(edge) + 1 for edge in edges[node]), default=0)
+            levels[node] = level
+        return level
+
+    order = sorted(range(len(infos)), key=lambda node: (level_of(node), infos[node].name))
+    position = {node: i for i, node in enumerate(order)}
+
+    for node in order:
+        infos[node].level = level_of(node)
+        infos[node].dependencies = sorted(position[edge] for edge in edges[node])
+
+    return [infos[node] for node in order]
+
+
+def write_length(out: bytearray, length: int) -> None:
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def compress(data: bytes) -> bytes:
+    """
+    LZ4 style block, decoded by src/java/codec.cpp. A sequence is a token
+    (literal count in the high nibble, match length - 4 in the low one, 15
+    meaning more length bytes follow), the literals, then the little endian
+    offset of the match. The last sequence only has literals.
+    """
+    out = bytearray()
+    table: dict[bytes, int] = {}
+    anchor = 0
+    pos = 0
+
+    def emit(literals: bytes, offset: int, length: int) -> None:
+        token_literals = min(len(literals), 15)
+        token_match = min(length - 4, 15) if length else 0
+        out.append(token_literals << 4 | token_match)
+        if token_literals == 15:
+            write_length(out, len(literals) - 15)
+        out.extend(literals)
+
+        if length:
+            out.extend(struct.pack("<H", offset))
+            if token_match == 15:
+                write_length(out, length - 4 - 15)
+
+    while pos + 4 <= len(data):
+        key = data[pos : pos + 4]
+        candidate = table.get(key)
+        table[key] = pos
+
+        if candidate is None or pos - candidate > 0xFFFF:
+            pos += 1
+            continue
+
+        length = 4
+        while pos + length < len(data) and data[candidate + length] == data[pos + length]:
+            length += 1
+
+        emit(data[anchor:pos], pos - candidate, length)
+
+        for inner in range(pos + 1, min(pos + length, len(data) - 3)):
+            table[data[inner : inner + 4]] = inner
+
+        pos += length
+        anchor = pos
+
+    emit(data[anchor:], 0, 0)
+    return bytes(out)
+
+
+def write_embedded(output_dir: str, cpp_output: str) -> None:
+    class_files: list[str] = []
+    for dirpath, _, filenames in os.walk(output_dir):
+        for f in filenames:
+            if f.endswith(".class"):
+                class_files.append(os.path.join(dirpath, f))
+
+    paths: dict[str, str] = {}
+    infos: list[class_info] = []
+    for cf in class_files:
+        info = extract_class_information(cf)
+        paths[info.name] = cf
+        infos.append(info)
+
+    # everything is constexpr, so the class files stay in .rodata of the library
+    # and nothing runs or gets allocated when it's loaded
+    lines = [
+        "// Auto-generated C++ embedded Java classes\n",
+        "#include <cstdint>\n",
+        "#include <span>\n",
+        "\n",
+        "namespace embedded {\n",
+        "\n",
+        "struct method_info {\n",
+        "    const char* name;\n",
+        "    const char* desc;\n",
+        "    uint16_t access;\n",
+        "};\n",
+        "\n",
+        "struct class_info {\n",
+        "    const char* name;\n",
+        "    // compressed, see codec::decompress\n",
+        "    std::span<const unsigned char> bytes;\n",
+        "    // of the class file once decompressed\n",
+        "    uint32_t size;\n",
+        "    std::span<const method_info> methods;\n",
+        "    // indices of the embedded classes this one references, all of them earlier in the list\n",
+        "    std::span<const uint16_t> dependencies;\n",
+        "    // classes only depend on lower levels, the list is sorted by it\n",
+        "    uint16_t level;\n",
+        "};\n",
+        "\n",
+    ]
+
+    ordered = order_classes(infos)
+    entries: list[str] = []
+
+    for info in ordered:
+        cf = paths[info.name]
+        var_name = "".join(c if c.isalnum() else "_" for c in info.name)
+
+        with open(cf, "rb") as f:
+            bytes_data = f.read()
+        byte_str = ", ".join(f"0x{b:02x}" for b in compress(bytes_data))
+
+        lines.append(f"// Auto-generated from {cf}\n")
+        lines.append(f"// Class: {info.name}\n")
+        lines.append(f"static constexpr unsigned char {var_name}_bytes[] = {{ {byte_str} }};\n")
+
+        # zero-length arrays aren't a thing, empty lists are just empty spans
+        if info.methods:
+            lines.append(f"static constexpr method_info {var_name}_methods[] = {{\n")
+            for method in info.methods:
+                lines.append("    method_info {\n")
+                lines.append(f'        .name = "{method.name}",\n')
+                lines.append(f'        .desc = "{method.desc}",\n')
+                lines.append(f"        .access = {hex(method.access)},\n")
+                lines.append("    },\n")
+            lines.append("};\n")
+
+        if info.dependencies:
+            dependencies = ", ".join(str(d) for d in info.dependencies)
+            lines.append(f"static constexpr uint16_t {var_name}_dependencies[] = {{ {dependencies} }};\n")
+
+        lines.append("\n")
+
+        entries.append("    class_info {\n")
+        entries.append(f'        .name = "{info.name.replace(".", "/")}",\n')
+        entries.append(f"        .bytes = {var_name}_bytes,\n")
+        entries.append(f"        .size = {len(bytes_data)},\n")
+        entries.append(f"        .methods = {var_name + '_methods' if info.methods else '{}'},\n")
+        entries.append(f"        .dependencies = {var_name + '_dependencies' if info.dependencies else '{}'},\n")
+        entries.append(f"        .level = {info.level}\n")
+        entries.append("    },\n")
+
+    lines.append("static constexpr class_info class_table[] = {\n")
+    lines.extend(entries)
+    lines.append("};\n\n")
+    lines.append("constexpr std::span<const class_info> classes = class_table;\n\n")
+    lines.append("}\n")
+
+    with open(cpp_output, "w") as f:
+        f.writelines(lines)
 
 
 def compile_java(
@@ -252,66 +503,7 @@ def compile_java(
             return ret
 
     if cpp_output is not None:
-        class_files: list[str] = []
-        for dirpath, _, filenames in os.walk(output_dir):
-            for f in filenames:
-                if f.endswith(".class"):
-                    class_files.append(os.path.join(dirpath, f))
-
-        lines = [
-            "// Auto-generated C++ embedded Java classes\n",
-            "#include <cstdint> \n",
-            "#include <vector>\n",
-            "\n",
-            "namespace embedded {\n",
-            "\n",
-            "struct method_info {\n",
-            "    const char* name;\n",
-            "    const char* desc;\n",
-            "    uint16_t access;\n",
-            "};\n",
-            "\n",
-            "struct class_info {\n",
-            "    const char* name;\n",
-            "    std::vector<unsigned char> bytes;\n",
-            "    std::vector<method_info> methods;\n",
-            "};\n",
-            "\n",
-            "std::vector<class_info> classes = {\n",
-        ]
-        class_names: list[str] = []
-
-        for cf in class_files:
-            info = extract_class_information(cf)
-            var_name = info.name.replace(".", "_")
-            class_names.append(var_name)
-
-            with open(cf, "rb") as f:
-                bytes_data = f.read()
-            byte_str = ", ".join(f"0x{b:02x}" for b in bytes_data)
-
-            lines.append("    class_info {\n")
-            lines.append(f"        // Auto-generated from {cf}\n")
-            lines.append(f"        // Class: {info.name}\n")
-            lines.append(f'        .name = "{info.name.replace(".", "/")}",\n')
-            lines.append(f"        .bytes = {{ {byte_str} }},\n")
-            lines.append("        .methods = {\n")
-
-            for method in info.methods:
-                lines.append("            method_info {\n")
-                lines.append(f'                .name = "{method.name}",\n')
-                lines.append(f'                .desc = "{method.desc}",\n')
-                lines.append(f"                .access = {hex(method.access)},\n")
-                lines.append("            },\n")
-
-            lines.append("        }\n")
-            lines.append("    },\n")
-
-        lines.append("};\n\n")
-        lines.append("}\n")
-
-        with open(cpp_output, "w") as f:
-            f.writelines(lines)
+        write_embedded(output_dir, cpp_output)
 
     return 0
 